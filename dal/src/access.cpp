@@ -29,8 +29,16 @@
 
 #include "access.hpp"
 #include "define.hpp"
+#include "globdef.hpp" // fnv_hash
 #include "mread.hpp" // matrix_separators
 #include <stdio.h>
+#include <limits.h> // INT_MAX
+#include <ctype.h> // isspace
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#include <sys/stat.h> // fstat
+#include <sys/mman.h> // mmap
+#include <errno.h> // EINTR
 
 /** \namespace Data_Access_Library
     \brief Low-Level ASCII Datenfile-Zugriff. */
@@ -538,10 +546,13 @@ Writer::Writer(
     , mp_input_key(ap_input_key)
     , mp_required_key(ap_required_key)
 {
+    if (os!=NULL) 
+	Metrics::enlist(&m_metrics,Metrics::WRITER,ap_context->name(),ap_context->outfile());
 }
 
 Writer::~Writer()
 {
+    Metrics::remove(&m_metrics);
 }
 
 bool
@@ -550,6 +561,13 @@ Writer::init()
     LOG_METHOD("Access","Writer","init",context()->name());
     if (!IOBase::init()) return false;
     INFO("writing <"<<context()->name()<<"> to '"<<context()->outfile()<<"'");
+
+    // m_fieldbegin einmal zerlegen statt fuer jedes Feld jedes Records
+    string::size_type pos = m_fieldbegin.find("%s"); 
+    m_fieldtag = (pos!=string::npos);
+    m_fieldprefix = m_fieldbegin.substr(0,pos);
+    m_fieldsuffix = (m_fieldtag) ? m_fieldbegin.substr(pos+2) : string();
+
     m_done = !fetch();
     return !m_done;
 }
@@ -578,6 +596,7 @@ Writer::setpos(const marker_type& mark)
     // stream::seek() aufrufen)
     m_next_loc = mark.m_spos;
     m_next_key = mark.m_key;
+    ++m_metrics.m_seeks;
     m_done=!fetch(); 
 }
 
@@ -608,6 +627,11 @@ Writer::operate()
     m_done = !fetch();
     TRACE("write next: key="<<m_next_key<<", ref="<<m_next_ref
 	  <<", loc="<<m_next_loc);
+
+    // der Record wird erst nach Writer::operate() geschrieben, die
+    // Positionsdifferenz ist die Laenge des vorherigen Records
+    ++m_metrics.m_records;
+    if (m_next_loc>m_curr_loc) m_metrics.m_bytes += (long)(m_next_loc-m_curr_loc);
     
     // Rueckgabewert: Operation (=Schreiben) erfolgreich
     return !m_done;
@@ -673,11 +697,18 @@ Reader::Reader(
     , mp_ref(ap_ref)
     , mp_required_key(ap_required_key)
     , mp_required_ref(ap_required_ref)
+    , m_index_state(INDEX_NONE)
+    , m_index_sorted(false)
+    , m_planned(false)
+    , mp_predecoded(NULL)
 {
+    if (is!=NULL) 
+	Metrics::enlist(&m_metrics,Metrics::READER,ap_context->name(),ap_context->infile());
 }
 
 Reader::~Reader()
 {
+    Metrics::remove(&m_metrics);
 }
 
 bool
@@ -690,6 +721,17 @@ Reader::init()
     // schon gelesen, tell() liefert Position nach dem Header (wichtig
     // bei CSV, da dort der Header kein Kommentar ist)
     m_curr_loc = m_next_loc = (mp_stream==NULL)?0:tell();
+
+    // Index der Recordpositionen laden oder beim Lesen aufbauen
+    m_index.clear();
+    m_index_state = INDEX_NONE;
+    m_index_start = m_curr_loc;
+    if ((mp_context->is_indexed())&&(!path().empty())) load_index();
+
+    // Dateigroesse fuer die Restzeit (siehe Metrics)
+    struct stat st;
+    if ((!path().empty())&&(stat(path().c_str(),&st)==0)) 
+	m_metrics.m_size = st.st_size;
     
     m_done = !fetch();
     return !m_done;
@@ -725,6 +767,13 @@ Reader::setpos(const marker_type& mark)
     }
     else
     {
+	// Index nur bei fortlaufendem Lesen ab dem ersten Record
+	if ((m_index_state==INDEX_COLLECT)||(m_index_state==INDEX_BROKEN))
+	{
+	    m_index.clear();
+	    m_index_state = (mark.m_spos==m_index_start) ? INDEX_COLLECT : INDEX_BROKEN;
+	}
+
 	// keine aktuelle Position mehr
 	m_curr_key = g_illegal_ix;
 	m_curr_ref = g_illegal_ix;
@@ -733,10 +782,52 @@ Reader::setpos(const marker_type& mark)
 	m_lookahead.erase(); 
 	m_next_loc = mark.m_spos;
 	m_next_key = mark.m_key;
+	++m_metrics.m_seeks;
 	m_done=!fetch(); 
     }
 }
 
+/** Liest den Text des naechsten Records aus dem Eingabestrom nach
+    \c a_text (ohne m_recbegin/m_recend), \c a_loc erhaelt die
+    Position des Records. Kommentarzeilen werden ueberlesen. Rueckgabe
+    false bei Dateiende. Die Methode wertet den Record nicht aus und
+    veraendert ausser dem Strom keine Attribute (siehe Prefetch<T>). */
+
+bool
+Reader::read_record(string& a_text,streampos& a_loc)
+{
+    return scan_record(*mp_stream,a_text,a_loc);
+}
+
+/** Wie read_record(), aber aus einem beliebigen Strom \c is. Es
+    werden nur m_recbegin/m_recend gelesen, daher duerfen mehrere
+    Threads gleichzeitig (auf verschiedenen Stroemen) lesen (siehe
+    Chunked<T>). */
+
+bool
+Reader::scan_record(istream& is,string& a_text,streampos& a_loc) const
+{
+    a_text.erase();
+
+    // Kommentare ueberlesen
+    read_white(is);
+    while (is_followed_by(is,g_char_comment,false)) 
+	read_line(is);
+    if ((is.eof())||(!is.good())) { return false; }
+    
+    // lesen, bis wir am Zeilenanfang m_recbegin finden
+    a_loc = (&is==&cin) ? streampos(0) : is.tellg();
+    if (!m_recbegin.empty())
+    {
+	while ((!is.eof())&&(is.good())&&
+	       (!is_followed_by(is,m_recbegin.c_str(),false))) 
+	{ read_line(is); a_loc = (&is==&cin) ? streampos(0) : is.tellg(); }
+    }
+    if ((is.eof())||(!is.good())) { return false; }
+    read_until(is,m_recend.c_str(),a_text);
+    return true;
+}
+
 /** Variablen werden geladen, lookahead wird geloescht. */
 
 bool
@@ -754,11 +845,11 @@ Reader::operate()
     // Hauptdatensatz noch nicht geladen war.
     if ((mp_required_key!=NULL)&&(mp_required_key->val()!=m_curr_key)) fetch();
 
-    // Zeile wurde schon bei fetch() in m_lookahead ausgelesen...
-    istrstream is(m_lookahead.c_str());
-    load(is);
-    // lookahead verbraucht
-    m_lookahead.erase();
+    // Zeile wurde schon bei fetch() in den lookahead geladen...
+    double t = Metrics::clock();
+    load_lookahead();
+    t = Metrics::lap(m_metrics.m_parse,t);
+    ++m_metrics.m_records;
     
     // aktuellen Key setzen, falls nicht ausgelesen
     bool autokey = (mp_key==NULL)||(mp_key->val()==g_illegal_ix);
@@ -783,11 +874,13 @@ Reader::operate()
 
     // aktuelle Position setzen
     m_curr_loc = m_next_loc; 
+    m_metrics.m_pos = (long)m_curr_loc;
 
     TRACE("read curr: key="<<m_curr_key<<", ref="<<m_curr_ref<<", loc="<<m_curr_loc);
     
     // Vorschau auf naechste Position
     m_done = !fetch();
+    Metrics::lap(m_metrics.m_io,t);
     TRACE("read next: key="<<m_next_key<<
 	  ", ref="<<m_next_ref<<", loc="<<m_next_loc);
     
@@ -806,6 +899,9 @@ Reader::fetch()
     ix_type required_key = (mp_required_key==NULL) 
 	? g_illegal_ix 
 	: mp_required_key->val(); 
+
+    // Detailrecords zu frueheren Schluesseln ggf. per Index ueberspringen
+    index_skip(required_key,!m_lookahead.empty());
 //// WIR SIND HIER IN EINER FETCH OPERATION, LADEN ALSO IN DEN LOOKAHEAD WAS ALS NAECHSTES RELEVANT WIRD. BEI SUBREADERN ENTSPRICHT DAS DEM RECORD, DER MIT DEM NEXT_KEY DES VATERRECORDS ZUSAMMENHAENGT, ALSO MUESSTE REQUIRED KEY NICHT INPUT_KEY SONDER NEXT_INPUT_KEY SEIN! ***
 
     // Solange weiterlesen bis ein Detailrecord gefunden wurde, der
@@ -816,24 +912,8 @@ Reader::fetch()
 		   ((m_next_key==g_illegal_ix)||(required_key>m_next_key)) )
         )
     {
-	m_lookahead.erase();
-	
-	// Kommentare ueberlesen
-	read_white(*mp_stream);
-	while (is_followed_by(*mp_stream,g_char_comment,false)) 
-	    read_line(*mp_stream);
-	if ((mp_stream->eof())||(!mp_stream->good())) { return false; }
-	
-	// lesen, bis wir am Zeilenanfang m_recbegin finden
-	m_next_loc = (mp_stream==NULL)?m_next_loc+1:tell();
-	if (!m_recbegin.empty())
-	{
-	    while ((!mp_stream->eof())&&(mp_stream->good())&&
-		   (!is_followed_by(*mp_stream,m_recbegin.c_str(),false))) 
-	    { read_line(*mp_stream); m_next_loc=tell(); }
-	}
-	if ((mp_stream->eof())||(!mp_stream->good())) { return false; }
-	read_until(*mp_stream,m_recend.c_str(),m_lookahead);
+	// naechsten Record-Text lesen
+	if (!read_record(m_lookahead,m_next_loc)) { index_eof(); return false; }
 	
 	// wenn zeilenanfang eindeutig identifizierbar ist, dann
 	// akzeptieren wir auch leere Eintraege (wie in
@@ -846,6 +926,7 @@ Reader::fetch()
 	    //m_next_key = g_illegal_ix; Vorbed. fuer sneak: alter next_key!
 	    m_next_ref = g_illegal_ix;
 	    sneak(is);
+	    index_record();
 	}
 	TRACE_VAR(m_lookahead);
 	TRACE("nextkey="<<m_next_key<<" reqkey="<<required_key);
@@ -873,6 +954,525 @@ Reader::fetch()
     return true;
 }
 
+/** Felder aus dem lookahead laden, der dadurch verbraucht wird. */
+
+void
+Reader::load_lookahead()
+{
+    const char *p = m_lookahead.c_str();
+    load_range(p,p+strlen(p));
+    m_metrics.m_bytes += m_lookahead.length();
+    m_lookahead.erase();
+}
+
+/** Wie sneak(istream&), aber der Record liegt als Zeigerbereich
+    [ap_begin,ap_end) vor (siehe Mapped<T>). Der Bereich ist nicht
+    nullterminiert und darf nicht leer sein. Spezialisierungen koennen
+    key/ref direkt im Speicher suchen, ohne einen Stream anzulegen. */
+
+void
+Reader::sneak_range(const char *ap_begin,const char *ap_end)
+{
+    istrstream is(ap_begin,ap_end-ap_begin);
+    sneak(is);
+}
+
+/** Wie load(istream&), aber der Record liegt als Zeigerbereich
+    [ap_begin,ap_end) vor (aus load_lookahead()). Spezialisierungen
+    koennen ihren Parse-Plan direkt im Speicher ausfuehren (siehe
+    load_plan()). */
+
+void
+Reader::load_range(const char *ap_begin,const char *ap_end)
+{
+    istrstream is(ap_begin,ap_end-ap_begin);
+    load(is);
+}
+
+/** Index der Recordpositionen ***********************************/
+
+/** Mindestanzahl zu ueberspringender Records, ab der sich in fetch()
+    ein Sprung ueber den Index lohnt. */
+static const long g_index_skip = 16;
+
+/** Name der Eingabedatei fuer den Index. Leer, wenn die Eingabe keine
+    (einzelne) Datei ist, dann wird kein Index verwendet. */
+
+const string&
+Reader::path()
+{
+    static const string empty;
+    return empty;
+}
+
+/** Anzahl der Records der Eingabedatei, -1 wenn (noch) kein
+    vollstaendiger Index vorliegt. */
+
+long
+Reader::index_size() const
+{
+    return (m_index_state==INDEX_VALID) ? (long)m_index.size() : -1;
+}
+
+/** Liefert in \c mark die Position des Records \c a_no (gezaehlt ab
+    0), wie sie getpos() vor dem Lesen dieses Records geliefert
+    haette. Rueckgabe false, wenn kein Index vorliegt oder \c a_no
+    ungueltig ist. */
+
+bool
+Reader::index_pos(long a_no,marker_type& mark) const
+{
+    if ((m_index_state!=INDEX_VALID)||(a_no<0)||(a_no>=(long)m_index.size())) 
+	return false;
+    mark.m_file = -1;
+    // sneak() zaehlt fehlende keys vom Vorgaenger aus weiter
+    mark.m_key = (a_no>0) ? m_index[a_no-1].m_key : g_illegal_ix;
+    mark.m_spos = m_index[a_no].m_loc;
+    return true;
+}
+
+/** Laedt den Index \c path().idx. Er ist nur gueltig, wenn Groesse und
+    Aenderungszeit der Datei sowie die Position des ersten Records mit
+    den gespeicherten Werten uebereinstimmen. Andernfalls wird der
+    Index beim folgenden Lesen neu aufgebaut. */
+
+void
+Reader::load_index()
+{
+    LOG_METHOD("Access","Reader","load_index",path());
+
+    struct stat st;
+    if (stat(path().c_str(),&st)!=0) { m_index_state = INDEX_NONE; return; }
+    m_index_state = INDEX_COLLECT;
+
+    string fname = path()+".idx";
+    ifstream is(fname.c_str(),ios::in|ios::binary);
+    if (!is.good()) return;
+
+    string word,kind;
+    int version = 0, longsize = 0;
+    long size = -1, mtime = -1, start = -1, records = -1;
+    is >> word >> kind >> version >> longsize;
+    if ((word!="format")||(kind!="idx")||(version!=1)||(longsize!=sizeof(long)))
+    { WARNING("ignoring index '"<<fname<<"' (unknown format)"); return; }
+    is >> word >> size >> word >> mtime >> word >> start >> word >> records;
+    is >> word; is.get();
+    if ((!is.good())||(word!="data")||(records<0))
+    { WARNING("ignoring corrupt index '"<<fname<<"'"); return; }
+    if ((size!=(long)st.st_size)||(mtime!=(long)st.st_mtime)||(start!=(long)m_index_start))
+    { INFO("index '"<<fname<<"' out of date"); return; }
+
+    m_index.resize(records);
+    if (records>0) is.read((char*)&m_index[0],records*sizeof(index_entry));
+    if ((records>0)&&(is.gcount()!=(streamsize)(records*sizeof(index_entry))))
+    { WARNING("ignoring truncated index '"<<fname<<"'"); m_index.clear(); return; }
+
+    m_index_sorted = true;
+    for (long i=1;(i<records)&&(m_index_sorted);++i)
+	m_index_sorted = (m_index[i-1].m_key<=m_index[i].m_key);
+    m_index_state = INDEX_VALID;
+    INFO("using index '"<<fname<<"' ("<<records<<" records)");
+}
+
+/** Speichert den (vollstaendig aufgebauten) Index nach \c path().idx
+    (Header in Textform wie bei COL_Writer, dann die Eintraege
+    binaer). Geschrieben wird in eine temporaere Datei, die danach
+    umbenannt wird, so dass parallel laufende Programme nie einen
+    halben Index sehen. */
+
+void
+Reader::save_index()
+{
+    LOG_METHOD("Access","Reader","save_index",path());
+
+    m_index_state = INDEX_VALID;
+    m_index_sorted = true;
+    for (long i=1;(i<(long)m_index.size())&&(m_index_sorted);++i)
+	m_index_sorted = (m_index[i-1].m_key<=m_index[i].m_key);
+
+    struct stat st;
+    if (stat(path().c_str(),&st)!=0) return;
+    string fname = path()+".idx";
+    string temp = fname+".tmp";
+    ofstream os(temp.c_str(),ios::out|ios::binary|ios::trunc);
+    os << "format idx 1 " << sizeof(long) << endl;
+    os << "size " << (long)st.st_size << " mtime " << (long)st.st_mtime 
+       << " start " << (long)m_index_start << " records " << m_index.size() << endl;
+    os << "data" << endl;
+    if (!m_index.empty()) 
+	os.write((const char*)&m_index[0],m_index.size()*sizeof(index_entry));
+    os.close();
+    if ((!os.good())||(rename(temp.c_str(),fname.c_str())!=0))
+    { WARNING("cannot write index '"<<fname<<"'"); unlink(temp.c_str()); return; }
+    INFO("index '"<<fname<<"' written ("<<m_index.size()<<" records)");
+}
+
+/** Ein Detail-Reader (mit required key) liest in fetch() alle Records
+    mit kleinerem key, um sie zu verwerfen. Mit gueltigem Index und
+    aufsteigenden keys springen wir stattdessen direkt (per setpos())
+    zum ersten Record mit \c a_key, sofern dabei mehr als
+    g_index_skip Records uebersprungen werden. \c a_ahead gibt an, ob
+    ein Record im lookahead steht (nur dann kennen wir die aktuelle
+    Position). Der Sprung versetzt nur den Strom (reposition()) und
+    verwirft den lookahead, die Schleife in fetch() liest dann den
+    Zielrecord; die aktuellen Werte (m_curr_*) bleiben erhalten. */
+
+bool
+Reader::index_skip(ix_type a_key,bool a_ahead)
+{
+    if ((m_index_state!=INDEX_VALID)||(!m_index_sorted)) return false;
+    if ((a_key==g_illegal_ix)||(!a_ahead)||(m_next_key==g_illegal_ix)
+	||(m_next_key>=a_key)) return false;
+
+    long lo = 0, hi = m_index.size(), next = -1;
+    // erster Record mit key >= m_next_key (aktueller lookahead) ...
+    while (lo<hi) 
+    { long m=(lo+hi)/2; if (m_index[m].m_key<m_next_key) lo=m+1; else hi=m; }
+    next = lo; hi = m_index.size();
+    // ... und erster Record mit key >= a_key
+    while (lo<hi) 
+    { long m=(lo+hi)/2; if (m_index[m].m_key<a_key) lo=m+1; else hi=m; }
+    if ((lo>=(long)m_index.size())||(lo-next<=g_index_skip)) return false;
+
+    marker_type mark;
+    index_pos(lo,mark);
+    if (!reposition(mark.m_spos)) return false;
+    TRACE("index skip from record "<<next<<" to "<<lo);
+
+    // wie in setpos(), aber ohne fetch(): den Zielrecord liest die
+    // Schleife des Aufrufers
+    m_lookahead.erase();
+    m_next_loc = mark.m_spos;
+    m_next_key = mark.m_key;
+    ++m_metrics.m_seeks;
+    return true;
+}
+
+/** Versetzt nur den Eingabestrom auf \c a_loc, ohne einen Record zu
+    lesen oder m_curr_* und m_next_* zu veraendern (fuer
+    index_skip(), das mitten in fetch() springt). Rueckgabe false,
+    wenn der Reader nicht positionieren kann. */
+
+bool
+Reader::reposition(streampos)
+{
+    return false;
+}
+
+/** Liest eine nicht-negative Ganzzahl aus [p,e), fuehrende Leerzeichen
+    werden ueberlesen. Wird keine Ziffer gefunden, bleibt \c a_value
+    unveraendert. Rueckgabe ist die Position hinter der Zahl. */
+
+static const char*
+scan_ix(const char *p,const char *e,ix_type& a_value)
+{
+    while ((p<e)&&(isspace(*p))) ++p;
+    if ((p<e)&&(isdigit(*p)))
+    {
+	a_value=0;
+	while ((p<e)&&(isdigit(*p))) { a_value = 10*a_value+(*p-'0'); ++p; }
+    }
+    return p;
+}
+
+/** Sucht die Zeichenkette \c a_find in [p,e). Rueckgabe ist der
+    Anfang des Fundes oder \c e, falls nicht gefunden. */
+
+static const char*
+scan_text(const char *p,const char *e,const string& a_find)
+{
+    const size_t n = a_find.length();
+    if (n==0) return p;
+    const char c = a_find[0];
+    while ((p!=NULL)&&(p+n<=e))
+    {
+	p = (const char*)memchr(p,c,e-p-n+1);
+	if ((p!=NULL)&&(memcmp(p,a_find.data(),n)==0)) return p;
+	if (p!=NULL) ++p;
+    }
+    return e;
+}
+
+/** Parse-Plan ***************************************************/
+
+/** Darf eine Zahl ohne Suche in der Domain gelesen werden (wie in
+    SymbolicIO<T>::read())? */
+
+static inline bool
+plain_numbers(const abstract_data_type *ap_field)
+{
+    const Domain *d = ap_field->context()->domain();
+    return (d==NULL)||((d->mixed_mode())&&(!d->numeric_labels()));
+}
+
+/** Leerraum am Ende von [p,e) abschneiden; true, wenn dann eine Zahl
+    beginnt (Ziffer, Punkt oder Minus, siehe number_follows()). */
+
+static inline bool
+trim_number(const char *p,const char*& e)
+{
+    while ((e>p)&&(isspace(e[-1]))) --e;
+    return (p<e)&&((isdigit(*p))||(*p=='.')||(*p=='-'));
+}
+
+/** Ganze Zahl aus [p,e), die den ganzen Bereich ausfuellt. */
+
+static inline bool
+parse_integer(const char *p,const char *e,long& a_value,bool a_signed)
+{
+    const bool neg = (a_signed)&&(p<e)&&(*p=='-');
+    if (neg) ++p;
+    if ((p==e)||(e-p>18)) return false;
+    long x = 0;
+    for (;p<e;++p) 
+    { if (!isdigit(*p)) return false; x = 10*x+(*p-'0'); }
+    a_value = (neg) ? -x : x;
+    return true;
+}
+
+static bool
+decode_real(const char *p,const char *e,abstract_data_type **ap_fields,int n)
+{
+    double x;
+    if ((!trim_number(p,e))||(!plain_numbers(ap_fields[0]))
+	||(parse_number(p,e,x)!=e)) return false;
+    for (int i=0;i<n;++i) ((real_type*)ap_fields[i])->var() = x;
+    return true;
+}
+
+static bool
+decode_int(const char *p,const char *e,abstract_data_type **ap_fields,int n)
+{
+    long x;
+    if ((!trim_number(p,e))||(!plain_numbers(ap_fields[0]))
+	||(!parse_integer(p,e,x,true))) return false;
+    for (int i=0;i<n;++i) ((int_type*)ap_fields[i])->var() = x;
+    return true;
+}
+
+static bool
+decode_index(const char *p,const char *e,abstract_data_type **ap_fields,int n)
+{
+    long x;
+    if ((!trim_number(p,e))||(!plain_numbers(ap_fields[0]))
+	||(!parse_integer(p,e,x,false))) return false;
+    for (int i=0;i<n;++i) ((index_type*)ap_fields[i])->var() = x;
+    return true;
+}
+
+/** Strings ohne Anfuehrungszeichen reichen bis zum Spaltenende (wie
+    in field_type<string>::read()). */
+
+static bool
+decode_string(const char *p,const char *e,abstract_data_type **ap_fields,int n)
+{
+    if ((p<e)&&(*p=='\"')) return false;
+    for (int i=0;i<n;++i) ((string_type*)ap_fields[i])->var().assign(p,e);
+    return true;
+}
+
+/** Ende der Spalte ab \c p: das naechste Trennzeichen \c a_sep
+    ausserhalb von ".." (darin maskiert \\ das folgende Zeichen, siehe
+    SymbolicIO<T>::read()), \c e falls keines folgt. Ohne " in der
+    Spalte genuegt memchr(). */
+
+static inline const char*
+column_end(const char *p,const char *e,char a_sep)
+{
+    const char *c = (const char*)memchr(p,a_sep,e-p);
+    if (c==NULL) c = e;
+    if (memchr(p,'\"',c-p)==NULL) return c;
+    bool quoted = false;
+    for (;p<e;++p)
+    {
+	if (*p=='\"') quoted = !quoted;
+	else if ((quoted)&&(*p=='\\')&&(p+1<e)) ++p;
+	else if ((!quoted)&&(*p==a_sep)) return p;
+    }
+    return e;
+}
+
+/** Uebersetzt die (nach offset sortierte) Feldliste in den flachen
+    Parse-Plan m_plan, der von load_plan() ohne virtuelle Aufrufe pro
+    Feld ausgefuehrt wird (Aufruf am Ende von init() der
+    Spalten-Reader). Skalare Felder ohne Selektor vom Typ double, int,
+    ix_type und string erhalten eine typisierte Dekodierung, alle
+    anderen werden weiterhin ueber read() gelesen. Aufeinanderfolgende
+    Felder derselben Spalte mit derselben Dekodierung und Domain werden
+    zu einem Schritt zusammengefasst, die Spalte wird dann nur einmal
+    dekodiert. Mit \c a_rows wird wie in .tab Dateien die Anzahl Werte
+    (Context::rows()) an read() uebergeben. Bei verzoegertem Dekodieren
+    (Modifier :l) wird kein Plan benutzt. */
+
+void
+Reader::compile_plan(bool a_rows)
+{
+    m_plan.clear();
+    m_plan_fields.clear();
+    m_planned = !context()->is_lazy();
+    if (!m_planned) return;
+
+    for (adtp_list::iterator f=m_fields.begin();f!=m_fields.end();++f)
+    {
+	// load() kommt ueber Felder ohne gueltige Spalte nicht hinaus
+	const Context *p_context = (*f)->context();
+	if ((p_context->offset()<1)||(p_context->offset()==g_illegal_ix)) break;
+
+	plan_step step;
+	step.m_column = p_context->offset();
+	step.m_rows = (a_rows) ? p_context->rows() : -1;
+	step.mp_decode = NULL;
+	if ((p_context->select().size()==0)&&((step.m_rows<0)||(step.m_rows==1)))
+	{
+	    if (dynamic_cast<real_type*>(*f)!=NULL) step.mp_decode = &decode_real;
+	    else if (dynamic_cast<int_type*>(*f)!=NULL) step.mp_decode = &decode_int;
+	    else if (dynamic_cast<index_type*>(*f)!=NULL) step.mp_decode = &decode_index;
+	    else if ((dynamic_cast<string_type*>(*f)!=NULL)
+		     &&(mp_matsep->m_field_sep==m_fieldend[0])) step.mp_decode = &decode_string;
+	}
+	step.m_first = m_plan_fields.size();
+	step.m_count = 1;
+	m_plan_fields.push_back(*f);
+	
+	// gleiche Spalte, gleicher Typ und Domain wie der Vorgaenger?
+	if ((!m_plan.empty())&&(step.mp_decode!=NULL))
+	{
+	    plan_step& last = m_plan.back();
+	    if ((last.m_column==step.m_column)&&(last.mp_decode==step.mp_decode)
+		&&(m_plan_fields[last.m_first]->context()->domain()==p_context->domain()))
+	    { ++last.m_count; continue; }
+	}
+	m_plan.push_back(step);
+    }
+    TRACE("parse plan <"<<context()->name()<<">: "<<m_plan.size()<<" steps, "
+	  <<m_plan_fields.size()<<" fields");
+}
+
+/** Fuehrt m_plan auf dem Record [p,e) aus, mit demselben Ergebnis wie
+    load() der Spalten-Reader. Spalten enden am Zeichen \c a_sep, eine
+    Spalte ist leer, wenn sie (nach Leerraum) mit \c a_empty
+    beginnt. Ein Schritt ohne passende Dekodierung liest mit read() ab
+    dem Spaltenanfang; die naechste Spalte beginnt dann hinter dem
+    Text, den das letzte Feld gelesen hat, bei \c a_rewind (.tab) aber
+    wie sonst hinter dem naechsten \c a_sep. */
+
+void
+Reader::load_plan(const char *p,const char *e,char a_empty,bool a_rewind)
+{
+    const char sep = m_fieldend[0];
+    const char *b = p;
+    vector<plan_step>::const_iterator s = m_plan.begin();
+    ix_type column = 1;
+    while (s!=m_plan.end())
+    {
+	while ((p<e)&&(isspace(*p))) ++p;
+	if (p>=e) break;
+	// vorab zerlegte Spalte nur, solange sie hier beginnt
+	const column_value *v = NULL;
+	if ((mp_predecoded!=NULL)&&(column<=(ix_type)mp_predecoded->size())
+	    &&((*mp_predecoded)[column-1].m_begin==p-b))
+	    v = &(*mp_predecoded)[column-1];
+	const char *c = (v!=NULL) ? b+v->m_end : column_end(p,e,sep);
+	
+	if (column==(*s).m_column)
+	{ // relevante Spalte, alle Schritte dieser Spalte ausfuehren
+	    const bool empty = (*p==a_empty);
+	    const char *next = c;
+	    for (;(s!=m_plan.end())&&((*s).m_column==column);++s)
+	    {
+		if (empty) continue;
+		abstract_data_type **f = &m_plan_fields[(*s).m_first];
+		next = c;
+		if ((v!=NULL)&&(load_predecoded(*v,*s,f))) continue;
+		if (((*s).mp_decode==NULL)||(!(*(*s).mp_decode)(p,c,f,(*s).m_count)))
+		{
+		    istrstream is(p,e-p);
+		    for (int i=0;i<(*s).m_count;++i)
+		    {
+			is.clear(); is.seekg(0);
+			if ((*s).m_rows<0) f[i]->read(is,mp_matsep);
+			else f[i]->read(is,(*s).m_rows,mp_matsep);
+		    }
+		    if (!a_rewind)
+		    {
+			const char *q = (is.good()) ? p+(long)is.tellg() : e;
+			next = column_end(q,e,sep);
+		    }
+		}
+		for (int i=0;i<(*s).m_count;++i)
+		{
+		    TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
+			     <<f[i]->context()->name()<<':'<<(*f[i])); 
+		}
+	    }
+	    c = next;
+	}
+	p = (c<e) ? c+1 : e;
+	++column;
+    }
+}
+
+/** Zerlegt den Record [p,e) wie load_plan() in Spalten (bis zur
+    letzten Spalte des Plans) und dekodiert die Zahlen der Spalten,
+    die der Plan typisiert liest. Haengt nur von m_plan und dem
+    Trennzeichen ab und schreibt in keine Felder, kann also in einem
+    Worker-Thread laufen (siehe Chunked<T>). load_plan() verwendet das
+    Ergebnis, wenn mp_predecoded darauf zeigt. */
+
+void
+Reader::predecode(const char *p,const char *e,predecoded_type& a_values) const
+{
+    a_values.clear();
+    if (!m_planned) return;
+    const char sep = m_fieldend[0];
+    const char *b = p;
+    vector<plan_step>::const_iterator s = m_plan.begin();
+    ix_type column = 1;
+    while (s!=m_plan.end())
+    {
+	while ((p<e)&&(isspace(*p))) ++p;
+	if (p>=e) break;
+	const char *c = column_end(p,e,sep);
+
+	column_value v;
+	v.m_begin = p-b; v.m_end = c-b;
+	v.m_is_real = v.m_is_int = v.m_is_index = false;
+	for (;(s!=m_plan.end())&&((*s).m_column==column);++s)
+	{
+	    const char *q = c;
+	    if (!trim_number(p,q)) continue;
+	    if ((*s).mp_decode==&decode_real)
+		v.m_is_real = (parse_number(p,q,v.m_real)==q);
+	    else if (((*s).mp_decode==&decode_int)||((*s).mp_decode==&decode_index))
+	    {
+		v.m_is_int = parse_integer(p,q,v.m_int,true);
+		v.m_is_index = (v.m_is_int)&&(*p!='-');
+	    }
+	}
+	a_values.push_back(v);
+	p = (c<e) ? c+1 : e;
+	++column;
+    }
+}
+
+/** Weist den Feldern des Schritts \c a_step den vorab dekodierten
+    Wert zu, mit demselben Ergebnis wie seine Dekodierung. Rueckgabe
+    false, wenn das nicht geht (dann wird wie sonst dekodiert). */
+
+bool
+Reader::load_predecoded(const column_value& v,const plan_step& a_step,
+			abstract_data_type **f)
+{
+    const int n = a_step.m_count;
+    if ((a_step.mp_decode==&decode_real)&&(v.m_is_real)&&(plain_numbers(f[0])))
+    { for (int i=0;i<n;++i) ((real_type*)f[i])->var() = v.m_real; return true; }
+    if ((a_step.mp_decode==&decode_int)&&(v.m_is_int)&&(plain_numbers(f[0])))
+    { for (int i=0;i<n;++i) ((int_type*)f[i])->var() = v.m_int; return true; }
+    if ((a_step.mp_decode==&decode_index)&&(v.m_is_index)&&(plain_numbers(f[0])))
+    { for (int i=0;i<n;++i) ((index_type*)f[i])->var() = v.m_int; return true; }
+    return false;
+}
+
 /** Klasse NULL_Writer *******************************************/
 
 NULL_Writer::NULL_Writer(
@@ -936,17 +1536,14 @@ TAG_Writer::operate()
 
     (*mp_stream) << m_recbegin;
     
-    size_t pos = m_fieldbegin.find("%s"); 
-    
     for (adtp_list::const_iterator f=m_fields.begin();f!=m_fields.end();++f)
     { 
 	if ((!(*f)->is_default())&&
 	    ((!mp_context->is_flat())||(!(*f)->context()->is_keyref())))
 	{
-	    (*mp_stream) << m_fieldbegin.substr(0,pos);
-	    if (pos!=string::npos) 
-		(*mp_stream) << (*f)->context()->outtag() 
-			     << m_fieldbegin.substr(pos+2);
+	    (*mp_stream) << m_fieldprefix;
+	    if (m_fieldtag) 
+		(*mp_stream) << (*f)->context()->outtag() << m_fieldsuffix;
 	    (*f)->write(*mp_stream,mp_matsep); 
 	    TRACE_ID("writefield","write <"<<mp_context->name()<<">: "
 		     <<(*f)->context()->name()<<':'<<(**f)); 
@@ -954,7 +1551,7 @@ TAG_Writer::operate()
 	}
     }
     
-    (*mp_stream) << m_recend << endl; mp_stream->flush();
+    (*mp_stream) << m_recend << '\n'; end_record();
     
     return mp_stream->good();
 }
@@ -1019,10 +1616,11 @@ TAG_Reader::TAG_Reader(
     istream *ap_is 
     )
     : Reader(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,ap_is)
-    , mp_keywords(NULL)
-    , mp_text(NULL)
     , m_key_index(-2)
     , m_ref_index(-2)
+    , m_size(0)
+    , mp_span_begin(NULL)
+    , mp_span_end(NULL)
 {
     set_xml_separators(m_recbegin,m_recend,m_fieldbegin,m_fieldend);
     mp_matsep = &g_matrix_ddl_separators;
@@ -1030,8 +1628,6 @@ TAG_Reader::TAG_Reader(
 
 TAG_Reader::~TAG_Reader()
 {
-    if (mp_keywords!=NULL) delete[] mp_keywords;
-    if (mp_text!=NULL) delete[] mp_text;
 }
 
 bool
@@ -1039,38 +1635,157 @@ TAG_Reader::init()
 {
     LOG_METHOD("Access","TAG_Reader","init",context()->name());
     
-    /** Wir bestimmen die Anzahl der Felder und ihre intag() Laenge */
-    m_size = 0; m_length = 0;
-    for (adtp_list::iterator f = m_fields.begin();f!=m_fields.end();++f)
-    { ++m_size; m_length += (*f)->context()->intag().length(); }
-    
-    /** Alle angemeldeten Felder werden nach ihrem intag() sortiert. */
+    /** Alle angemeldeten Felder werden nach ihrem intag() sortiert,
+	Felder mit gleichem intag() liegen danach nebeneinander. */
     sort_fields_by_intag();
-    
-    /** Das mp_keywords Feld wird mit den sortieren intags()
-	gefuellt. */
-    mp_text = new char[m_size*m_fieldbegin.length()+m_length];
-    mp_keywords = new keyword_entry[m_size+1];
-    
-    word x=0,n=0;
+    m_sorted.clear();
     for (adtp_list::iterator f=m_fields.begin();f!=m_fields.end();++f)
     {
-	if ((*f)==mp_key) m_key_index=x;
-	if ((*f)==mp_ref) m_ref_index=x;
-	mp_keywords[x].name = mp_text+n;
-	mp_keywords[x].identifier = x;
-	++x;
-	
-	sprintf(mp_text+n,m_fieldbegin.c_str(),(*f)->context()->intag().c_str());
-	n += m_fieldbegin.length()-2 + ((*f)->context()->intag().length())+1;
+	if ((*f)==mp_key) m_key_index=m_sorted.size();
+	if ((*f)==mp_ref) m_ref_index=m_sorted.size();
+	m_sorted.push_back(*f);
     }
-    mp_keywords[x].name=NULL;
-    mp_keywords[x].identifier=-1;
-    //for (x=0;x<n;++x) mp_text[x]=toupper(mp_text[x]);
+    m_size = m_sorted.size();
+
+    /** m_fieldbegin ("<%s ") wird in den Teil vor und nach dem
+	Tag-Namen zerlegt. */
+    string::size_type pos = m_fieldbegin.find("%s");
+    INVARIANT(pos!=string::npos,"field begin "<<m_fieldbegin);
+    m_tag_prefix = m_fieldbegin.substr(0,pos);
+    m_tag_suffix = m_fieldbegin.substr(pos+2);
+
+    /** Die Hashtabelle (Groesse: Zweierpotenz, hoechstens halb
+	gefuellt) bildet jedes intag() direkt auf die Gruppe der
+	zugehoerigen Felder in m_sorted ab. */
+    int n = 8; 
+    while (n<2*m_size) n*=2;
+    tag_entry empty; empty.m_index = -1; empty.m_count = 0;
+    m_tags.assign(n,empty);
+    for (int i=0;i<m_size;)
+    {
+	const string& name = m_sorted[i]->context()->intag();
+	int ctr = 1;
+	while ((i+ctr<m_size) && (m_sorted[i+ctr]->context()->intag()==name)) ++ctr;
+	unsigned int h = fnv_hash(name.data(),name.length()) & (n-1);
+	while (m_tags[h].m_count>0) h = (h+1) & (n-1);
+	m_tags[h].m_name = name;
+	m_tags[h].m_index = i;
+	m_tags[h].m_count = ctr;
+	i += ctr;
+    }
+
+    /** Skalare Felder ohne Selektor werden aus dem eingeblendeten
+	Record direkt dekodiert (siehe load_range(), wie im
+	Parse-Plan der Spalten-Reader). */
+    m_decode.assign(m_size,(decode_type)NULL);
+    for (int i=0;i<m_size;++i)
+    {
+	abstract_data_type *f = m_sorted[i];
+	if (f->context()->select().size()>0) continue;
+	if (dynamic_cast<real_type*>(f)!=NULL) m_decode[i] = &decode_real;
+	else if (dynamic_cast<int_type*>(f)!=NULL) m_decode[i] = &decode_int;
+	else if (dynamic_cast<index_type*>(f)!=NULL) m_decode[i] = &decode_index;
+	else if ((dynamic_cast<string_type*>(f)!=NULL)
+		 &&(mp_matsep->m_field_sep==m_fieldend[0])) m_decode[i] = &decode_string;
+    }
+    mp_span_begin = mp_span_end = NULL;
     
     return Reader::init();
 }
 
+/** Sucht den Tag-Namen [ap_name,ap_name+a_len) in der Hashtabelle.
+    Rueckgabe ist der Index des ersten zugehoerigen Feldes in m_sorted
+    (und deren Anzahl in \c a_count) bzw. -1, falls kein Feld diesen
+    intag() hat. */
+
+int
+TAG_Reader::find_tag(const char *ap_name,int a_len,int& a_count) const
+{
+    const unsigned int mask = m_tags.size()-1;
+    unsigned int h = fnv_hash(ap_name,a_len) & mask;
+    while (m_tags[h].m_count>0)
+    {
+	const tag_entry& t = m_tags[h];
+	if (((int)t.m_name.length()==a_len) && (memcmp(t.m_name.data(),ap_name,a_len)==0))
+	    { a_count = t.m_count; return t.m_index; }
+	h = (h+1) & mask;
+    }
+    a_count = 0;
+    return -1;
+}
+
+/** Liest den naechsten Tag-Anfang (bspw. "<value ") aus dem Strom und
+    liefert wie find_tag() die zugehoerige Feldgruppe. Die Zeichen
+    werden direkt aus dem streambuf gelesen; bei einem unbekannten Tag
+    bleibt der Rest des Feldes im Strom (siehe skip_field()). */
+
+int
+TAG_Reader::read_tag(istream& is,int& a_count)
+{
+    a_count = 0;
+    if (!is.good()) return -1;
+    streambuf *sb = is.rdbuf();
+    int c = sb->sgetc();
+    while ((c!=EOF) && (isspace(c))) c = sb->snextc();
+    for (string::size_type i=0;(c!=EOF)&&(i<m_tag_prefix.length());++i)
+    {
+	if (c!=m_tag_prefix[i]) return -1;
+	c = sb->snextc();
+    }
+    m_name.resize(0);
+    while ((c!=EOF) && (is_name_char(c))) { m_name += (char)c; c = sb->snextc(); }
+    for (string::size_type i=0;(c!=EOF)&&(i<m_tag_suffix.length());++i)
+    {
+	if (c!=m_tag_suffix[i]) return -1;
+	c = sb->snextc();
+    }
+    if (c==EOF) { is.clear(is.rdstate()|ios::eofbit); return -1; }
+    return find_tag(m_name.data(),m_name.length(),a_count);
+}
+
+/** Haengt den Text eines Feldes bis (ausschliesslich) zum Endezeichen
+    \c a_end an \c a_raw an (fuer verzoegertes Dekodieren, siehe
+    abstract_data_type::defer()). Ein Endezeichen in ".." zaehlt
+    nicht (auch kein mit \\ maskiertes "); ist \c a_end ein Leerzeichen, so beendet jedes
+    Leerzeichen das Feld. */
+
+static void
+read_raw(istream& is,char a_end,string& a_raw)
+{
+    streambuf *sb = is.rdbuf();
+    bool quoted = false;
+    int c = sb->sgetc();
+    while (c!=EOF)
+    {
+	if (c=='\"') 
+	    quoted = !quoted;
+	else if ((quoted)&&(c=='\\'))
+	{ // maskiertes Zeichen unveraendert uebernehmen
+	    a_raw += (char)c;
+	    c = sb->snextc();
+	    if (c==EOF) break;
+	}
+	else if ((!quoted)&&((c==a_end)||((a_end==' ')&&isspace(c)))) 
+	    break;
+	a_raw += (char)c;
+	c = sb->snextc();
+    }
+    if (c==EOF) is.clear(is.rdstate()|ios::eofbit);
+}
+
+/** Ueberliest den Rest des aktuellen Feldes einschliesslich
+    m_fieldend. Ein einzelnes Endezeichen wird per ignore() gesucht,
+    das direkt im Puffer des Stroms sucht. */
+
+void
+TAG_Reader::skip_field(istream& is) const
+{
+    if (m_fieldend.length()==1) 
+	is.ignore(INT_MAX,m_fieldend[0]);
+    else
+	read_until(is,m_fieldend.c_str());
+}
+
 void
 TAG_Reader::sneak(istream& is)
 {
@@ -1079,89 +1794,213 @@ TAG_Reader::sneak(istream& is)
     bool foundkey = false, foundref = false;
     while ((is.good()) && ((!foundkey)||(!foundref)))
     {
-	int index = is_followed_by(is,mp_keywords,false,false);
+	int ctr;
+	int index = read_tag(is,ctr);
 	if (index!=-1)
 	{
-	    if (index==m_key_index)
+	    if ((index<=m_key_index)&&(m_key_index<index+ctr))
 	    { 
 		is >> m_next_key; // BAUSTELLE: sollte m_io & Context benutzen!
 		foundkey=true;
 		TRACE_ID("readfield","sneak key<"<<mp_context->name()<<">="<<m_next_key);
 	    }
-	    else if (index==m_ref_index)
+	    else if ((index<=m_ref_index)&&(m_ref_index<index+ctr))
 	    { 
 		is >> m_next_ref; 
 		foundref=true;
 		TRACE_ID("readfield","sneak ref<"<<mp_context->name()<<">="<<m_next_ref);
 	    }
 	}
-	read_until(is,m_fieldend.c_str());
+	skip_field(is);
     }
 
     if (!foundkey) 
 	if (m_next_key==g_illegal_ix) m_next_key=0; else ++m_next_key;
 }
 
+/** Sucht alle Felder des Records [p,e) in einem Durchgang und merkt
+    sich den Text der bekannten Felder in m_spans (fuer
+    load_range()). Ein Feld endet am ersten m_fieldend ausserhalb von
+    "..", wie beim Lesen ueber read_raw(). */
+
 void
-TAG_Reader::load(istream& is)
+TAG_Reader::scan_spans(const char *p,const char *e)
 {
-    LOG_METHOD("Access","TAG_Reader","load",context()->name());
-    
-    while (is.good())
+    const size_t np = m_tag_prefix.length(), ns = m_tag_suffix.length();
+    const size_t nf = m_fieldend.length();
+    m_spans.clear();
+    mp_span_begin = p; mp_span_end = e;
+    while (p<e)
     {
-	int index = is_followed_by(is,mp_keywords,false,false);
-	if (index!=-1)
-	{ // relevantes Feld, auslesen
-	    
-	    // wieviele Felder erhalten ihren Wert aus dieser Eingabe?
-	    int ctr = 1;
-	    while ((index+ctr<m_size)&&
-		   (strcmp(mp_keywords[index].name,mp_keywords[index+ctr].name)==0))
-		++ctr;
-	    
-	    // diese Felder in der Liste ausfinding machen (ab Position index)
-	    adtp_list::iterator f = m_fields.begin(); 
-	    while (index>0) { ++f; --index; }
-	    
-	    // und auslesen
-	    streampos p = is.tellg();
-	    for (;ctr>0;--ctr) 
-	    { 
-		is.seekg(p); (*f)->read(is,mp_matsep); 
-		TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
-			 <<(*f)->context()->name()<<':'<<(**f)); 
-		++f; 
+	while ((p<e)&&(isspace(*p))) ++p;
+	span_type span; span.m_index = -1; span.m_count = 0;
+	if ((p+np<=e) && (memcmp(p,m_tag_prefix.data(),np)==0))
+	{
+	    const char *name = p+np, *q = name;
+	    while ((q<e) && (is_name_char((unsigned char)*q))) ++q;
+	    if ((q+ns<=e) && (memcmp(q,m_tag_suffix.data(),ns)==0))
+	    {
+		span.m_index = find_tag(name,q-name,span.m_count);
+		p = q+ns;
 	    }
 	}
-	read_until(is,m_fieldend.c_str());
+	span.mp_begin = p;
+	bool quoted = false;
+	while ((p<e) && ((quoted)||(p+nf>e)||(memcmp(p,m_fieldend.data(),nf)!=0)))
+	{ 
+	    if (*p=='\"') quoted = !quoted; 
+	    else if ((quoted)&&(*p=='\\')&&(p+1<e)) ++p;
+	    ++p; 
+	}
+	span.mp_end = p;
+	if (span.m_index!=-1) m_spans.push_back(span);
+	if (p<e) p += nf;
     }
 }
 
-/** Klasse CSV_Reader ******************************************/
+/** key/ref werden aus den von scan_spans() gefundenen Feldern
+    gelesen; load_range() dekodiert danach die uebrigen Felder ohne
+    den Record erneut abzusuchen. */
 
-CSV_Reader::CSV_Reader(
-  Context *ap_context,
-  index_type *ap_key,
-  index_type *ap_ref,
-  index_type *ap_required_key,
-  index_type *ap_required_ref,
-  istream *ap_is 
-  )
-  : Reader(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,ap_is)
-  , m_key_index(-2)
-  , m_ref_index(-2)
-  {
-  set_comma_separators(m_recbegin,m_recend,m_fieldbegin,m_fieldend);
-  mp_matsep = &g_matrix_csv_separators;
-  }
+void
+TAG_Reader::sneak_range(const char *p,const char *e)
+{
+    LOG_METHOD("Access","TAG_Reader","sneak_range",context()->name());
 
-CSV_Reader::~CSV_Reader
-  (
-  )
-  {
-  }
+    scan_spans(p,e);
+    bool foundkey = false;
+    for (vector<span_type>::const_iterator s=m_spans.begin();s!=m_spans.end();++s)
+    {
+	if (((*s).m_index<=m_key_index)&&(m_key_index<(*s).m_index+(*s).m_count))
+	    { scan_ix((*s).mp_begin,(*s).mp_end,m_next_key); foundkey=true; }
+	else if (((*s).m_index<=m_ref_index)&&(m_ref_index<(*s).m_index+(*s).m_count))
+	    scan_ix((*s).mp_begin,(*s).mp_end,m_next_ref);
+    }
 
-bool
+    if (!foundkey) 
+	if (m_next_key==g_illegal_ix) m_next_key=0; else ++m_next_key;
+}
+
+/** Feld \c i aus dem Text [p,e) laden: skalare Felder direkt, alle
+    anderen ueber read() auf einem Strom nur ueber diesem Text. */
+
+void
+TAG_Reader::load_field(int i,const char *p,const char *e)
+{
+    abstract_data_type **f = &m_sorted[i];
+    while ((p<e)&&(isspace(*p))) ++p;
+    if ((m_decode[i]==NULL)||(!(*m_decode[i])(p,e,f,1)))
+    {
+	// Laenge 0 bedeutet bei istrstream "nullterminiert"
+	istrstream is((p<e)?p:"",e-p);
+	(*f)->read(is,mp_matsep);
+    }
+    TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
+	     <<(*f)->context()->name()<<':'<<(**f)); 
+}
+
+/** Wurde der Record [ap_begin,ap_end) gerade von sneak_range()
+    abgesucht (Mapped<T>), so werden die Felder direkt aus m_spans
+    geladen, sonst wie bisher ueber load(). */
+
+void
+TAG_Reader::load_range(const char *ap_begin,const char *ap_end)
+{
+    LOG_METHOD("Access","TAG_Reader","load_range",context()->name());
+
+    if ((ap_begin!=mp_span_begin)||(ap_end!=mp_span_end))
+    {
+	Reader::load_range(ap_begin,ap_end);
+	return;
+    }
+    mp_span_begin = mp_span_end = NULL;
+
+    for (vector<span_type>::const_iterator s=m_spans.begin();s!=m_spans.end();++s)
+    {
+	const int first = (*s).m_index, last = first+(*s).m_count;
+	if ((context()->is_lazy())&&(m_fieldend.length()==1))
+	{ // nur den Text merken, dekodiert wird beim ersten Zugriff
+	    m_raw.assign((*s).mp_begin,(*s).mp_end);
+	    for (int i=first;i<last;++i) 
+	    { 
+		m_sorted[i]->defer(m_raw,mp_matsep); 
+		TRACE_ID("readfield","defer <"<<mp_context->name()<<">: "
+			 <<m_sorted[i]->context()->name()<<':'<<m_raw); 
+	    }
+	}
+	else
+	    for (int i=first;i<last;++i) load_field(i,(*s).mp_begin,(*s).mp_end);
+    }
+}
+
+void
+TAG_Reader::load(istream& is)
+{
+    LOG_METHOD("Access","TAG_Reader","load",context()->name());
+    
+    while (is.good())
+    {
+	int ctr;
+	int index = read_tag(is,ctr);
+	if (index!=-1)
+	{ // relevantes Feld, auslesen
+	    if ((context()->is_lazy())&&(m_fieldend.length()==1))
+	    { // nur den Text merken, dekodiert wird beim ersten Zugriff
+		m_raw.resize(0);
+		read_raw(is,m_fieldend[0],m_raw);
+		for (int i=index;i<index+ctr;++i) 
+		{ 
+		    m_sorted[i]->defer(m_raw,mp_matsep); 
+		    TRACE_ID("readfield","defer <"<<mp_context->name()<<">: "
+			     <<m_sorted[i]->context()->name()<<':'<<m_raw); 
+		}
+	    }
+	    else if (ctr==1)
+	    {
+		m_sorted[index]->read(is,mp_matsep);
+		TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
+			 <<m_sorted[index]->context()->name()<<':'<<(*m_sorted[index])); 
+	    }
+	    else
+	    { // mehrere Felder erhalten ihren Wert aus dieser Eingabe
+		streampos p = is.tellg();
+		for (int i=index;i<index+ctr;++i) 
+		{ 
+		    is.seekg(p); m_sorted[i]->read(is,mp_matsep); 
+		    TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
+			     <<m_sorted[i]->context()->name()<<':'<<(*m_sorted[i])); 
+		}
+	    }
+	}
+	skip_field(is);
+    }
+}
+
+/** Klasse CSV_Reader ******************************************/
+
+CSV_Reader::CSV_Reader(
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref,
+  istream *ap_is 
+  )
+  : Reader(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,ap_is)
+  , m_key_index(-2)
+  , m_ref_index(-2)
+  {
+  set_comma_separators(m_recbegin,m_recend,m_fieldbegin,m_fieldend);
+  mp_matsep = &g_matrix_csv_separators;
+  }
+
+CSV_Reader::~CSV_Reader
+  (
+  )
+  {
+  }
+
+bool
 CSV_Reader::init
   (
   ) 
@@ -1231,6 +2070,7 @@ CSV_Reader::init
 
   // Reihenfolge nach offset sortieren
   sort_fields_by_offset();
+  compile_plan(false);
 
   return Reader::init();
   } // Ende der init Methode
@@ -1255,6 +2095,28 @@ CSV_Reader::sneak(istream& is)
     }
   }
 
+/** Spalten bis key/ref direkt im Speicher abzaehlen. */
+
+void
+CSV_Reader::sneak_range(const char *p,const char *e)
+{
+    LOG_METHOD("Access","CSV_Reader","sneak_range",context()->name());
+
+  int index = 1;
+  int stop_index = max(m_key_index,m_ref_index);
+  while ((p<e)&&(index<=stop_index))
+    {
+    while ((p<e)&&(isspace(*p))) ++p;
+    bool empty = (p<e)&&(*p==m_fieldend[0]);
+    if ((index==m_key_index)&&(!empty))
+      { p = scan_ix(p,e,m_next_key); }
+    else if ((index==m_ref_index)&&(!empty))
+      { p = scan_ix(p,e,m_next_ref); }
+    p = scan_text(p,e,m_fieldend); if (p<e) ++p;
+    ++index;
+    }
+  }
+
 void
 CSV_Reader::load
   (
@@ -1281,6 +2143,17 @@ CSV_Reader::load
       bool empty = is_followed_by(is,m_fieldend.c_str(),true);
       if (empty) 
         f=g;
+      else if ((context()->is_lazy())&&(m_fieldend.length()==1))
+        { // nur den Text merken, dekodiert wird beim ersten Zugriff
+        m_raw.resize(0);
+        read_raw(is,m_fieldend[0],m_raw);
+        for (;f!=g;++f) 
+          {
+          (*f)->defer(m_raw,mp_matsep); 
+          TRACE_ID("readfield","defer <"<<mp_context->name()<<">: "
+                  <<(*f)->context()->name()<<':'<<m_raw); 
+          }
+        }
       else
         { // auslesen 
         streampos p = is.tellg();
@@ -1297,6 +2170,23 @@ CSV_Reader::load
     }
   }
 
+/** Felder ueber den Parse-Plan laden (siehe Reader::load_plan()). */
+
+void
+CSV_Reader::load_range
+  (
+  const char *ap_begin,
+  const char *ap_end
+  )
+  {
+  LOG_METHOD("Access","CSV_Reader","load_range",context()->name());
+
+  if (m_planned) 
+    load_plan(ap_begin,ap_end,m_fieldend[0],false);
+  else
+    Reader::load_range(ap_begin,ap_end);
+  }
+
 /** Klasse CSV_Writer *******************************************/
 
 CSV_Writer::CSV_Writer
@@ -1363,17 +2253,14 @@ CSV_Writer::operate
 
   (*mp_stream) << m_recbegin;
 
-  size_t pos = m_fieldbegin.find("%s"); 
-
   bool first = true;
   for (adtp_list::const_iterator f=m_fields.begin();f!=m_fields.end();++f)
     // keine Ausgabe wenn Table-Context=FLAT und Field-Context=KEYREF
     if ((!mp_context->is_flat())||(!(*f)->context()->is_keyref()))
     { 
-    (*mp_stream) << m_fieldbegin.substr(0,pos);
-    if (pos!=string::npos)
-      (*mp_stream) << (*f)->context()->outtag()
-                   << m_fieldbegin.substr(pos+2);
+    (*mp_stream) << m_fieldprefix;
+    if (m_fieldtag)
+      (*mp_stream) << (*f)->context()->outtag() << m_fieldsuffix;
 
     if (!first) (*mp_stream) << m_fieldend; 
     first = false;
@@ -1384,7 +2271,7 @@ CSV_Writer::operate
              <<(*f)->context()->name()<<':'<<(**f)); 
     }
 
-  (*mp_stream) << m_recend; mp_stream->flush();
+  (*mp_stream) << m_recend; end_record();
 
   return mp_stream->good();
   }
@@ -1506,6 +2393,7 @@ TAB_Reader::init
   // Schliesslich sortieren wir m_fields so um, dass die Reihenfolge
   // durch die offsets gegeben ist (vereinfacht pop()).
   sort_fields_by_offset();
+  compile_plan(true);
 
   return Reader::init();
   } // Ende der init Methode
@@ -1529,6 +2417,28 @@ TAB_Reader::sneak(istream& is)
     }
 }
 
+/** Spalten bis key/ref direkt im Speicher abzaehlen. */
+
+void
+TAB_Reader::sneak_range(const char *p,const char *e)
+{
+    LOG_METHOD("Access","TAB_Reader","sneak_range",context()->name());
+
+    int index = 1;
+    int stop_index = max(m_key_index,m_ref_index);
+    while ((p<e)&&(index<=stop_index))
+    {
+	while ((p<e)&&(isspace(*p))) ++p;
+	bool empty = (p<e)&&(*p==g_char_emptyfield);
+	if ((index==m_key_index)&&(!empty))
+	{ p = scan_ix(p,e,m_next_key); }
+	else if ((index==m_ref_index)&&(!empty))
+	{ p = scan_ix(p,e,m_next_ref); }
+	while ((p<e)&&(!isspace(*p))) ++p;
+	++index;
+    }
+}
+
 void
 TAB_Reader::load
   (
@@ -1555,6 +2465,24 @@ TAB_Reader::load
       bool empty = is_followed_by(is,g_char_emptyfield,false);
       if (empty) 
         f=g;
+      else if (context()->is_lazy())
+        { // nur den Text der Werte merken, dekodiert wird beim ersten Zugriff
+        streampos p = is.tellg(); 
+        for (;f!=g;++f) 
+          { 
+          const int rows = (*f)->context()->rows();
+          m_raw.resize(0);
+          for (int i=0;i<rows;++i)
+            {
+            if (i>0) { read_white(is); m_raw += ' '; }
+            read_raw(is,' ',m_raw);
+            }
+          (*f)->defer(m_raw,mp_matsep,rows);
+          TRACE_ID("readfield","defer <"<<mp_context->name()<<">: "
+                  <<(*f)->context()->name()<<':'<<m_raw); 
+          is.seekg(p);
+          }
+        }
       else
         { // auslesen 
         streampos p = is.tellg(); 
@@ -1578,6 +2506,23 @@ TAB_Reader::load
     }
   }
 
+/** Felder ueber den Parse-Plan laden (siehe Reader::load_plan()). */
+
+void
+TAB_Reader::load_range
+  (
+  const char *ap_begin,
+  const char *ap_end
+  )
+  {
+  LOG_METHOD("Access","TAB_Reader","load_range",context()->name());
+
+  if (m_planned) 
+    load_plan(ap_begin,ap_end,g_char_emptyfield,true);
+  else
+    Reader::load_range(ap_begin,ap_end);
+  }
+
 /** Klasse TAB_Writer *******************************************/
 
 TAB_Writer::TAB_Writer
@@ -1644,16 +2589,13 @@ TAB_Writer::operate
 
   (*mp_stream) << m_recbegin;
 
-  size_t pos = m_fieldbegin.find("%s"); 
-
   for (adtp_list::const_iterator f=m_fields.begin();f!=m_fields.end();++f)
     // keine Ausgabe wenn Table-Context=FLAT und Field-Context=KEYREF
     if ((!mp_context->is_flat())||(!(*f)->context()->is_keyref()))
     { 
-    (*mp_stream) << m_fieldbegin.substr(0,pos);
-    if (pos!=string::npos)
-      (*mp_stream) << (*f)->context()->outtag()
-                   << m_fieldbegin.substr(pos+2);
+    (*mp_stream) << m_fieldprefix;
+    if (m_fieldtag)
+      (*mp_stream) << (*f)->context()->outtag() << m_fieldsuffix;
 
     // gleichbleibende Groesse garantieren, keine Default-*-Ausgabe bei Feldern
     if ((*f)->context()->type()==Context::FIELD)
@@ -1673,260 +2615,2062 @@ TAB_Writer::operate
     (*mp_stream) << m_fieldend;
     }
 
-  (*mp_stream) << m_recend; mp_stream->flush();
+  (*mp_stream) << m_recend; end_record();
 
   return mp_stream->good();
   }
 
-/** Klasse File ********************************************/
+/** Klasse COL_Writer *******************************************/
+
+/** \class COL_Writer
+
+    Binaeres Spaltenformat (.col). Die Datei beginnt mit einem
+    Text-Header, der das Schema beschreibt:
+
+\code
+    format col 1 <sizeof(long)>
+    table <name>
+    rows <n>
+    columns <k>
+    field <tag> <kind> <bytes> <labels>
+    <value> <length> <label>      (je Label der Domain des Feldes)
+    ...
+    data
+\endcode
+
+    Hinter der Zeile \c data folgen die \c k Spalten in der
+    Reihenfolge des Headers, jeweils \c bytes lang. Eine Spalte
+    besteht aus einer Offsettabelle (n+1 Eintraege vom Typ long) und
+    den Werten (siehe abstract_data_type::write_binary). Hat eine
+    Zeile keinen Wert (Default), sind beide Offsets gleich. Die
+    Domain-Label werden mitgespeichert, damit symbolische Werte beim
+    Einlesen in die Numerierung der dann aktuellen Domain umgesetzt
+    werden koennen.
+
+    Da die Spalten erst am Ende geschrieben werden koennen, sammelt
+    der Writer alle Records im Speicher. */
+
+COL_Writer::COL_Writer(
+    Context *ap_context,
+    index_type *ap_output_key,
+    index_type *ap_output_ref,
+    index_type *ap_input_key,
+    index_type *ap_required_key,
+    ostream *ap_os
+    )
+    : Writer(ap_context,ap_output_key,ap_output_ref,ap_input_key,ap_required_key,ap_os)
+    , m_rows(0)
+{
+    mp_matsep = &g_matrix_ddl_separators;
+}
 
-template <class T>
-File<T>::File
-  (
-  Context *ap_context,
-  index_type *ap_key,
-  index_type *ap_ref,
-  index_type *ap_required_key,
-  index_type *ap_required_ref
-  )
-  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,new typename T::file_type)  
-  {
-  }
+bool
+COL_Writer::init() 
+{
+    LOG_METHOD("Access","COL_Writer","init",context()->name());
 
-template <class T>
-File<T>::~File
-  (
-  )
-  {
-  close_file_stream();
-  delete mp_stream;
-  }
+    // keine Ausgabe wenn Table-Context=FLAT und Field-Context=KEYREF
+    m_columns.clear();
+    for (adtp_list::const_iterator f=m_fields.begin();f!=m_fields.end();++f)
+	if ((!mp_context->is_flat())||(!(*f)->context()->is_keyref()))
+	    m_columns.push_back(*f);
+    m_data.clear(); m_data.resize(m_columns.size());
+    m_offsets.clear(); m_offsets.resize(m_columns.size());
+    m_rows = 0;
+
+    return (Writer::init()) && (mp_stream->good());
+}
+
+/** Positionen sind Zeilennummern. */
 
-template <class T>
 bool
-File<T>::init()
-  {
-  LOG_METHOD("Access","File<T>","init",context()->name());
+COL_Writer::fetch()
+{
+    Writer::fetch();
+    m_ahead_loc = m_next_loc = m_rows;
+    return true;
+}
 
-  m_fname = name();
-  open_file_stream(m_fname.c_str());
-  if (!mp_stream->good()) 
-    {
-      /** Versuchen wir es im DATAPATH. */
-      char *p_path( getenv("DAL_DATAPATH") );
-      if (p_path!=NULL)
-        {
-        m_fname = p_path; m_fname += '/'; m_fname += name();
-        open_file_stream(m_fname.c_str());
-        }
-    }
-  if (!mp_stream->good())
-    {
-    ERROR("file '" << m_fname << "' not found"); exit(-1);
-    return false; 
-    }
-  else
+/** Zuruecksetzen auf eine fruehere Zeile verwirft alle folgenden
+    Zeilen. */
+
+void
+COL_Writer::setpos(const marker_type& mark) 
+{
+    LOG_METHOD("Access","COL_Writer","setpos",mark);
+
+    ix_type row = (long)mark.m_spos;
+    if (row<m_rows)
     {
-    return T::init();
+	for (word c=0;c<m_columns.size();++c)
+	{
+	    m_data[c].resize(m_offsets[c][row]);
+	    m_offsets[c].resize(row);
+	}
+	m_rows = row;
     }
-  }
+    Writer::setpos(mark);
+}
 
-template <class T>
-void
-File<T>::setpos(const marker_type& mark)
+bool
+COL_Writer::operate()
 {
-    LOG_METHOD("Access","File<T>","reset",context()->name());
-    
-    // selbe Position, lookahead gelesen, aber noch nicht ausgewertet?
-    bool sameposition = ( (m_curr_loc == mark.m_spos) && 
-			  (m_ahead_loc == mark.m_spos) );
-    
-    // Scheusslich, aber manchmal passiert ein Beschaedigen des Stream
-    // am Ende des Auslesens eines TABLEs, weil es kein eindeutiges
-    // Endsymbol gibt (sondern man laeuft ins !good).
-    if (!mp_stream->good())
+    LOG_METHOD("Access","COL_Writer","operate",context()->name());
+
+    Writer::operate();
+
+    word c = 0;
+    for (adtp_list::const_iterator f=m_columns.begin();f!=m_columns.end();++f,++c)
     { 
-	close_file_stream(); 
-	open_file_stream(m_fname.c_str()); 
-	mp_stream->clear(); 
+	m_offsets[c].push_back(m_data[c].length());
+	if (!(*f)->is_default()) (*f)->write_binary(m_data[c]);
+	TRACE_ID("writefield","write <"<<mp_context->name()<<">: "
+		 <<(*f)->context()->name()<<':'<<(**f)); 
     }
-    
-    // Repositionierung, aber nur wenn noetig (um konsistent mit
-    // T::setpos zu bleiben)
-    if (!sameposition) seek(mark.m_spos); 
-    T::setpos(mark);
+    ++m_rows;
+    // Writer::operate() hat die Folgeposition vor dem Anhaengen bestimmt
+    m_ahead_loc = m_next_loc = m_rows;
 
-    INVARIANT(mp_stream->good(),"ok after seek");
+    return true;
 }
 
-template File<TAG_Reader>;
-template File<TAG_Writer>;
-template File<CSV_Reader>;
-template File<CSV_Writer>;
-
-#ifdef XXX
-/** Klasse File_List<T> **************************************/
+/** Header und Spalten in den Stream schreiben. */
 
-/** Theoretisch ist es moeglich, dass die Position der Felder von
-    Datei zu Datei unterschiedlich ist. Diese Position wird in den
-    cells gespeichert, daher koennen wir nur einen Reader fuer ein
-    Feld initialisieren, andernfalls wuerden die Reader das
-    Positionsfeld in der cell mehrfach ueberschreiben. */
-
-    File_List(ix_type a_ix,const string& a_name);
-    virtual ~File_List();
-    virtual void init();
-    virtual bool operate(const id_type&,field_list_type&);
-    virtual void getpos(marker_type&);
-    virtual void setpos(const marker_type&);
+void
+COL_Writer::write_columns()
+{
+    LOG_METHOD("Access","COL_Writer","write_columns",context()->name());
 
-template <class T>
-File_List<T>::File_List
-  (
-  Context *ap_context,
-  index_type *ap_key,
-  index_type *ap_ref,
-  index_type *ap_required_key,
-  index_type *ap_required_ref
-  )
-  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,new typename T::file_type)  
-  , m_filename(this,cREADOUT|cSHARED,"file")
-  , mp_reader(NULL)
-  {
+    ostream& os = *mp_stream;
+    seek(0);
+    os << "format col 1 " << sizeof(long) << endl;
+    os << "table " << mp_context->outtag() << endl;
+    os << "rows " << m_rows << endl;
+    os << "columns " << m_columns.size() << endl;
 
-  /** Wir lesen die Daten gleich aus, damit wir vor- und zuruecklaufen
-      koennen. Weil wir nur an einem String je Record interessiert
-      ist, gehen wir davon aus, dass dies nicht viel Speicher
-      kostet. */
-  while (!done())
+    word c = 0;
+    for (adtp_list::const_iterator f=m_columns.begin();f!=m_columns.end();++f,++c)
     {
-    pop();
-    m_filenames.push_back(m_filename);
-    push();
+	const Domain *p_domain = (*f)->context()->domain();
+	long bytes = (m_rows+1)*sizeof(long) + m_data[c].length();
+	os << "field " << (*f)->context()->outtag() << ' ' 
+	   << (*f)->binary_kind() << ' ' << bytes << ' ' 
+	   << ((p_domain==NULL)?0:p_domain->size()) << endl;
+	if (p_domain!=NULL)
+	    for (Domain::const_iterator i=p_domain->begin();i!=p_domain->end();++i)
+		os << (*i).second << ' ' << (*(*i).first).length() << ' ' 
+		   << *(*i).first << endl;
     }
-  close();
-  mi_file = m_filenames.begin();
-  }
+    os << "data" << endl;
 
-template <class T>
-File_List<T>::~File_List
-  (
-  )
-  {
-  m_filenames.clear();
-  }
+    c = 0;
+    for (adtp_list::const_iterator f=m_columns.begin();f!=m_columns.end();++f,++c)
+    {
+	m_offsets[c].push_back(m_data[c].length());
+	os.write((const char*)&m_offsets[c][0],m_offsets[c].size()*sizeof(long));
+	os.write(m_data[c].data(),m_data[c].length());
+    }
+    os.flush();
+}
 
-/** Attach-Kommandos werden nicht an diesen Reader gegeben, sondern
-    fuer die noch zu erzeugenden Reader gepuffert. */
+/** Wird von File<COL_Writer> beim Schliessen aufgerufen (statt
+    Writer::close_file_stream), erst dann stehen alle Spalten fest. */
 
-template <class T>
 void
-FileList<T>::attach
-  (
-  abstract_data_type *ap_field
+COL_Writer::close_file_stream()
+{
+    write_columns();
+    dynamic_cast<file_type*>(mp_stream)->close();
+}
+
+/** Klasse COL_Reader *******************************************/
+
+/** \class COL_Reader
+
+    Liest das binaere Spaltenformat (siehe COL_Writer). Die Spalten
+    werden in init() komplett in den Speicher geladen, Positionen in
+    marker_type sind Zeilennummern. */
+
+COL_Reader::COL_Reader(
+    Context *ap_context,
+    index_type *ap_key,
+    index_type *ap_ref,
+    index_type *ap_required_key,
+    index_type *ap_required_ref,
+    istream *ap_is 
+    )
+    : Reader(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,ap_is)
+    , mp_key_column(NULL)
+    , mp_ref_column(NULL)
+    , m_rows(0)
+    , m_row(0)
+    , m_ahead(false)
+{
+    mp_matsep = &g_matrix_ddl_separators;
+}
+
+bool
+COL_Reader::init() 
+{
+    LOG_METHOD("Access","COL_Reader","init",context()->name());
+
+    istream& is = *mp_stream;
+    string word,kind,tag;
+    int version = 0, longsize = 0, columns = 0;
+
+    is >> word >> kind >> version >> longsize;
+    if ((word!="format")||(kind!="col")||(version!=1))
+    { ERROR("'"<<name()<<"' is not a column file"); exit(-1); }
+    if (longsize!=sizeof(long))
+    { ERROR("'"<<name()<<"' written on incompatible architecture"); exit(-1); }
+    is >> word >> tag; 
+    if (tag!=mp_context->intag())
+	WARNING("reading <"<<mp_context->intag()<<"> from table <"<<tag<<">");
+    is >> word >> m_rows;
+    is >> word >> columns;
+
+    // Schema lesen, Felder den Spalten zuordnen
+    vector<long> start(columns+1,0);
+    m_columns.clear();
+    for (int c=0;c<columns;++c)
+    {
+	long bytes; int labels;
+	is >> word >> tag >> kind >> bytes >> labels;
+	start[c+1] = start[c]+bytes;
+
+	column_list matched;
+	for (adtp_list::iterator f=m_fields.begin();f!=m_fields.end();++f)
+	    if ((*f)->context()->intag()==tag)
+	    {
+		if ((*f)->binary_kind()!=kind)
+		{ 
+		    ERROR("field <"<<tag<<"> has type "<<kind<<" in '"<<name()
+			  <<"', expected "<<(*f)->binary_kind()); 
+		    exit(-1); 
+		}
+		column_type col;
+		col.mp_field = *f;
+		col.m_column = c;
+		col.mp_offsets = NULL;
+		col.mp_values = NULL;
+		matched.push_back(col);
+	    }
+
+	// Label der Domain umsetzen
+	for (int l=0;l<labels;++l)
+	{
+	    int value,length; 
+	    is >> value >> length; is.get();
+	    string label(length,' ');
+	    if (length>0) is.read(&label[0],length);
+	    for (column_list::iterator i=matched.begin();i!=matched.end();++i)
+	    {
+		Domain *p_domain = (*i).mp_field->context()->domain();
+		if (p_domain==NULL) continue;
+		int local;
+		if (!p_domain->find(label,local))
+		{
+		    if (p_domain->is_fixed()) continue;
+		    local = p_domain->add(label);
+		}
+		if (local!=value) (*i).m_labels.insert(label_map_type::value_type(value,local));
+	    }
+	}
+	m_columns.splice(m_columns.end(),matched);
+    }
+    is >> word; is.get();
+    if (word!="data") { ERROR("corrupt header in '"<<name()<<"'"); exit(-1); }
+
+    // Spaltendaten komplett laden
+    m_buffer.resize(start[columns]+1);
+    is.read(&m_buffer[0],start[columns]);
+    if (is.gcount()!=start[columns]) 
+    { ERROR("truncated column file '"<<name()<<"'"); exit(-1); }
+
+    // Spaltennummern durch Zeiger in den Buffer ersetzen
+    mp_key_column = mp_ref_column = NULL;
+    for (column_list::iterator i=m_columns.begin();i!=m_columns.end();++i)
+    {
+	int c = (*i).m_column;
+	(*i).mp_offsets = (const long*)(&m_buffer[start[c]]);
+	(*i).mp_values = &m_buffer[start[c]] + (m_rows+1)*sizeof(long);
+	if ((*i).mp_field==mp_key) mp_key_column = &(*i);
+	if ((*i).mp_field==mp_ref) mp_ref_column = &(*i);
+    }
+
+    m_row = 0; m_ahead = false;
+    bool ok = Reader::init();
+    // erste Position ist Zeile 0, nicht die Dateiposition
+    m_curr_loc = 0;
+    // alle Zeilen liegen im Speicher, ein Index ist ueberfluessig
+    m_index.clear(); m_index_state = INDEX_NONE;
+    return ok;
+}
+
+/** Liefert den Wert der Zeile \c a_row in der Spalte, \c a_empty wird
+    wahr, wenn die Zeile dort keinen Wert hat (Default). */
+
+const char*
+COL_Reader::cell(const column_type& a_col,ix_type a_row,bool& a_empty) const
+{
+    long begin,end;
+    memcpy(&begin,a_col.mp_offsets+a_row,sizeof(long));
+    memcpy(&end,a_col.mp_offsets+a_row+1,sizeof(long));
+    a_empty = (begin==end);
+    return a_col.mp_values+begin;
+}
+
+/** key/ref direkt aus ihren Spalten lesen (kein Parsen), ohne key
+    wird wie bei TAG_Reader::sneak() inkrementiert. */
+
+void
+COL_Reader::sneak_row(ix_type a_row)
+{
+    bool empty = true;
+    if (mp_key_column!=NULL)
+    {
+	const char *p = cell(*mp_key_column,a_row,empty);
+	if (!empty) memcpy(&m_next_key,p,sizeof(ix_type));
+    }
+    if (empty) 
+	if (m_next_key==g_illegal_ix) m_next_key=0; else ++m_next_key;
+
+    if (mp_ref_column!=NULL)
+    {
+	const char *p = cell(*mp_ref_column,a_row,empty);
+	if (!empty) memcpy(&m_next_ref,p,sizeof(ix_type));
+    }
+}
+
+/** Wie Reader::fetch(), aber zeilenweise in den Spalten. */
+
+bool
+COL_Reader::fetch()
+{
+    LOG_METHOD("Access","COL_Reader","fetch","");
+
+    ix_type required_key = (mp_required_key==NULL) 
+	? g_illegal_ix 
+	: mp_required_key->val(); 
+
+    while (   (!m_ahead)
+	   || ( (required_key!=g_illegal_ix)&&
+		((m_next_key==g_illegal_ix)||(required_key>m_next_key)) )
+	)
+    {
+	m_ahead = false;
+	if (m_row>=m_rows) { return false; }
+	m_next_loc = m_row; 
+	m_next_ref = g_illegal_ix;
+	sneak_row(m_row);
+	++m_row;
+	m_ahead = true;
+	TRACE("nextkey="<<m_next_key<<" reqkey="<<required_key);
+    }
+    m_ahead_loc = m_next_loc;
+
+    if (required_key<m_curr_key) { return false; }
+
+    return true;
+}
+
+void
+COL_Reader::load_lookahead()
+{
+    if (!m_ahead) return;
+    ix_type row = (long)m_next_loc;
+    bool empty;
+    for (column_list::iterator i=m_columns.begin();i!=m_columns.end();++i)
+    {
+	const char *p = cell(*i,row,empty);
+	if (!empty) 
+	    (*i).mp_field->read_binary(p,((*i).m_labels.empty())?NULL:&(*i).m_labels);
+	TRACE_ID("readfield","read <"<<mp_context->name()<<">: "
+		 <<(*i).mp_field->context()->name()<<':'<<(*(*i).mp_field)); 
+    }
+    m_ahead = false;
+}
+
+/** Wird nicht benutzt, die Felder werden in load_lookahead() direkt
+    aus den Spalten geladen. */
+
+void
+COL_Reader::load(istream&)
+{
+    DO_NOT_PASS;
+}
+
+void
+COL_Reader::sneak(istream&)
+{
+    DO_NOT_PASS;
+}
+
+void
+COL_Reader::setpos(const marker_type& mark)
+{
+    LOG_METHOD("Access","COL_Reader","setpos",mark);
+
+    bool sameposition = ( (m_curr_loc == mark.m_spos) && 
+			  (m_ahead_loc == mark.m_spos) );
+    if (!sameposition)
+    {
+	m_row = (long)mark.m_spos;
+	m_ahead = false;
+    }
+    Reader::setpos(mark);
+}
+
+/** Klasse File ********************************************/
+
+template <class T>
+File<T>::File
+  (
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref
+  )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,new typename T::file_type)  
+  {
+  }
+
+template <class T>
+File<T>::~File
+  (
+  )
+  {
+  close_file_stream();
+  delete mp_stream;
+  }
+
+template <class T>
+bool
+File<T>::init()
+  {
+  LOG_METHOD("Access","File<T>","init",context()->name());
+
+  m_fname = name();
+  open_file_stream(m_fname.c_str());
+  if (!mp_stream->good()) 
+    {
+      /** Versuchen wir es im DATAPATH. */
+      char *p_path( getenv("DAL_DATAPATH") );
+      if (p_path!=NULL)
+        {
+        m_fname = p_path; m_fname += '/'; m_fname += name();
+        open_file_stream(m_fname.c_str());
+        }
+    }
+  if (!mp_stream->good())
+    {
+    ERROR("file '" << m_fname << "' not found"); exit(-1);
+    return false; 
+    }
+  else
+    {
+    return T::init();
+    }
+  }
+
+template <class T>
+void
+File<T>::setpos(const marker_type& mark)
+{
+    LOG_METHOD("Access","File<T>","reset",context()->name());
+    
+    // selbe Position, lookahead gelesen, aber noch nicht ausgewertet?
+    bool sameposition = ( (m_curr_loc == mark.m_spos) && 
+			  (m_ahead_loc == mark.m_spos) );
+    
+    // Scheusslich, aber manchmal passiert ein Beschaedigen des Stream
+    // am Ende des Auslesens eines TABLEs, weil es kein eindeutiges
+    // Endsymbol gibt (sondern man laeuft ins !good).
+    if (!mp_stream->good())
+    { 
+	close_file_stream(); 
+	open_file_stream(m_fname.c_str()); 
+	mp_stream->clear(); 
+    }
+    
+    // Repositionierung, aber nur wenn noetig (um konsistent mit
+    // T::setpos zu bleiben)
+    if (!sameposition) seek(mark.m_spos); 
+    T::setpos(mark);
+
+    INVARIANT(mp_stream->good(),"ok after seek");
+}
+
+template <class T>
+bool
+File<T>::reposition(streampos a_loc)
+{
+    if (!mp_stream->good())
+    { 
+	close_file_stream(); 
+	open_file_stream(m_fname.c_str()); 
+	mp_stream->clear(); 
+    }
+    seek(a_loc);
+    return mp_stream->good();
+}
+
+template File<TAG_Reader>;
+template File<TAG_Writer>;
+template File<CSV_Reader>;
+template File<CSV_Writer>;
+template File<COL_Reader>;
+template File<COL_Writer>;
+
+/** Klasse Mapped<T> ***************************************/
+
+/** Der istream wird erst in init() angelegt, wenn die Datei
+    eingeblendet ist (als istrstream ueber dem eingeblendeten Inhalt,
+    so dass die Header-Auswertung in T::init unveraendert bleibt). */
+
+template <class T>
+Mapped<T>::Mapped
+  (
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref
+  )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,NULL)  
+  , mp_begin(NULL)
+  , mp_end(NULL)
+  , mp_cursor(NULL)
+  , mp_ahead_begin(NULL)
+  , mp_ahead_end(NULL)
+  {
+  }
+
+template <class T>
+Mapped<T>::~Mapped
+  (
+  )
+  {
+  unmap();
+  }
+
+template <class T>
+void
+Mapped<T>::unmap()
+  {
+  if (mp_stream!=NULL) { delete mp_stream; mp_stream=NULL; }
+  if (mp_begin!=NULL) { munmap(mp_begin,mp_end-mp_begin); mp_begin=NULL; }
+  mp_end = mp_cursor = mp_ahead_begin = mp_ahead_end = NULL;
+  }
+
+template <class T>
+bool
+Mapped<T>::init()
+  {
+  LOG_METHOD("Access","Mapped<T>","init",context()->name());
+
+  m_fname = name();
+  int fd = open(m_fname.c_str(),O_RDONLY);
+  if (fd<0)
+    {
+      /** Versuchen wir es im DATAPATH. */
+      char *p_path( getenv("DAL_DATAPATH") );
+      if (p_path!=NULL)
+        {
+        m_fname = p_path; m_fname += '/'; m_fname += name();
+        fd = open(m_fname.c_str(),O_RDONLY);
+        }
+    }
+  if (fd<0)
+    {
+    ERROR("file '" << m_fname << "' not found"); exit(-1);
+    return false; 
+    }
+
+  struct stat st;
+  if (fstat(fd,&st)!=0) { ERROR("cannot stat '"<<m_fname<<"'"); exit(-1); }
+  size_t size = st.st_size;
+  if (size>0)
+    {
+    void *p = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+    if (p==MAP_FAILED) { ERROR("cannot map '"<<m_fname<<"'"); exit(-1); }
+    mp_begin = (char*)p; mp_end = mp_begin+size;
+    madvise(mp_begin,size,MADV_SEQUENTIAL);
+    // Laenge 0 bedeutet bei istrstream "nullterminiert", daher
+    // leere Dateien gesondert
+    mp_stream = new istrstream(mp_begin,size);
+    }
+  else
+    mp_stream = new istrstream("");
+  close(fd);
+
+  // erster fetch() beginnt hinter dem Header, siehe Mapped<T>::fetch
+  mp_cursor = NULL;
+  return T::init();
+  }
+
+/** Wie Reader::fetch(), aber ohne den Record zu kopieren: Anfang und
+    Ende des Records werden als Zeiger in den eingeblendeten Inhalt
+    gemerkt, key/ref werden direkt dort gesucht (sneak_range). Der
+    TAG_Reader merkt sich dabei alle Felder, so dass load_lookahead()
+    den Record nicht ein zweites Mal absucht; die Spalten-Reader
+    dekodieren ueber ihren Parse-Plan direkt im Speicher. */
+
+template <class T>
+bool
+Mapped<T>::fetch()
+  {
+  LOG_METHOD("Access","Mapped<T>","fetch","");
+
+  // Erster Aufruf (aus Reader::init): Header ist gelesen, der Stream
+  // steht am Anfang der Daten
+  if (mp_cursor==NULL) 
+    mp_cursor = (mp_begin==NULL) ? NULL : mp_begin + (mp_stream->good()?(long)tell():(long)(mp_end-mp_begin));
+  if (mp_cursor==NULL) return false;
+
+  ix_type required_key = (mp_required_key==NULL) 
+    ? g_illegal_ix 
+    : mp_required_key->val(); 
+
+  // siehe Reader::fetch
+  index_skip(required_key,mp_ahead_begin!=NULL);
+  while (   (mp_ahead_begin==NULL)
+	 || ( (required_key!=g_illegal_ix)&&
+	      ((m_next_key==g_illegal_ix)||(required_key>m_next_key)) )
+	)
+    {
+    mp_ahead_begin = NULL;
+    const char *p = mp_cursor;
+
+    // Leerraum und Kommentare ueberlesen
+    while ((p<mp_end)&&((isspace(*p))||(*p==g_char_comment)))
+      {
+      if (*p==g_char_comment)
+        { p = (const char*)memchr(p,'\n',mp_end-p); if (p==NULL) p=mp_end; }
+      else
+        ++p;
+      }
+    if (p>=mp_end) { mp_cursor=mp_end; index_eof(); return false; }
+
+    // zeilenweise weiter, bis wir am Zeilenanfang m_recbegin finden
+    m_next_loc = p-mp_begin;
+    if (!m_recbegin.empty())
+      {
+      while ((p<mp_end)&&
+             ((p+m_recbegin.length()>mp_end)||
+              (memcmp(p,m_recbegin.data(),m_recbegin.length())!=0)))
+        { 
+        p = (const char*)memchr(p,'\n',mp_end-p); 
+        if (p==NULL) p=mp_end; else ++p;
+        m_next_loc = p-mp_begin; 
+        while ((p<mp_end)&&(isspace(*p))) ++p;
+        }
+      if (p>=mp_end) { mp_cursor=mp_end; index_eof(); return false; }
+      p += m_recbegin.length();
+      }
+
+    // Record reicht bis m_recend (oder bis Dateiende)
+    const char *q = scan_text(p,mp_end,m_recend);
+    mp_cursor = (q<mp_end) ? q+m_recend.length() : mp_end;
+
+    // leere Eintraege werden wie in Reader::fetch ueberlesen
+    if (q>p)
+      {
+      mp_ahead_begin = p; mp_ahead_end = q;
+      m_next_ref = g_illegal_ix;
+      sneak_range(mp_ahead_begin,mp_ahead_end);
+      index_record();
+      }
+    TRACE("nextkey="<<m_next_key<<" reqkey="<<required_key);
+    }
+  m_ahead_loc = m_next_loc;
+
+  if (required_key<m_curr_key) { return false; }
+
+  return true;
+  }
+
+/** Felder direkt aus dem eingeblendeten Record laden. */
+
+template <class T>
+void
+Mapped<T>::load_lookahead()
+  {
+  if (mp_ahead_begin!=NULL)
+    {
+    load_range(mp_ahead_begin,mp_ahead_end);
+    m_metrics.m_bytes += mp_ahead_end-mp_ahead_begin;
+    }
+  mp_ahead_begin = mp_ahead_end = NULL;
+  }
+
+/** Neupositionierung ist nur ein Versetzen des Lesezeigers. */
+
+template <class T>
+void
+Mapped<T>::setpos(const marker_type& mark)
+{
+    LOG_METHOD("Access","Mapped<T>","setpos",mark);
+
+    // selbe Position, lookahead gelesen, aber noch nicht ausgewertet?
+    bool sameposition = ( (m_curr_loc == mark.m_spos) && 
+			  (m_ahead_loc == mark.m_spos) );
+
+    if ((!sameposition)&&(mp_begin!=NULL))
+    {
+	INVARIANT(mp_begin+(long)mark.m_spos<=mp_end,"position within file");
+	mp_cursor = mp_begin+(long)mark.m_spos;
+	mp_ahead_begin = mp_ahead_end = NULL;
+    }
+    T::setpos(mark);
+}
+
+template <class T>
+bool
+Mapped<T>::reposition(streampos a_loc)
+{
+    if (mp_begin==NULL) return false;
+    INVARIANT(mp_begin+(long)a_loc<=mp_end,"position within file");
+    mp_cursor = mp_begin+(long)a_loc;
+    mp_ahead_begin = mp_ahead_end = NULL;
+    return true;
+}
+
+template Mapped<TAG_Reader>;
+template Mapped<CSV_Reader>;
+template Mapped<TAB_Reader>;
+
+#ifdef HAVE_LIBPTHREAD
+/** Klasse Prefetch<T> ********************************************/
+
+/// Anzahl der Records, die der Erzeuger-Thread vorausliest
+static const int g_prefetch_slots = 256;
+
+template <class T>
+Prefetch<T>::Prefetch
+  (
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref
+  )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref)  
+  , m_ring(g_prefetch_slots)
+  , m_head(0)
+  , m_count(0)
+  , m_running(false)
+  , m_finished(false)
+  , m_stop(false)
+  {
+  pthread_mutex_init(&m_mutex,NULL);
+  pthread_cond_init(&m_filled,NULL);
+  pthread_cond_init(&m_emptied,NULL);
+  }
+
+/** Der Thread muss beendet sein, bevor File<T> den Strom schliesst. */
+
+template <class T>
+Prefetch<T>::~Prefetch
+  (
+  )
+  {
+  stop();
+  pthread_cond_destroy(&m_emptied);
+  pthread_cond_destroy(&m_filled);
+  pthread_mutex_destroy(&m_mutex);
+  }
+
+/** Startet den Erzeuger-Thread ab der aktuellen Stream-Position. Ab
+    jetzt darf nur noch der Erzeuger auf mp_stream zugreifen. */
+
+template <class T>
+void
+Prefetch<T>::start(streampos a_loc)
+  {
+  LOG_METHOD("Access","Prefetch<T>","start",context()->name());
+  m_head = m_count = 0;
+  m_loc = a_loc;
+  m_stop = m_finished = false;
+  if (pthread_create(&m_thread,NULL,&Prefetch<T>::produce,this)!=0)
+    { ERROR("cannot start prefetch thread for '"<<name()<<"'"); exit(-1); }
+  m_running = true;
+  }
+
+/** Haelt den Erzeuger-Thread an und verwirft alle vorausgelesenen
+    Records. Danach gehoert mp_stream wieder dem Aufrufer. */
+
+template <class T>
+void
+Prefetch<T>::stop()
+  {
+  if (!m_running) return;
+  LOG_METHOD("Access","Prefetch<T>","stop",context()->name());
+  pthread_mutex_lock(&m_mutex);
+  m_stop = true;
+  pthread_cond_signal(&m_emptied);
+  pthread_mutex_unlock(&m_mutex);
+  pthread_join(m_thread,NULL);
+  m_running = false;
+  m_head = m_count = 0;
+  }
+
+/** Rumpf des Erzeuger-Threads: liest mit T::read_record() so lange
+    Records in freie Eintraege des Ringpuffers, bis das Dateiende
+    erreicht ist oder stop() aufgerufen wird. Der gerade gefuellte
+    Eintrag liegt ausserhalb von [m_head,m_head+m_count) und wird vom
+    Verbraucher nicht beruehrt, daher wird ohne Sperre gelesen. */
+
+template <class T>
+void*
+Prefetch<T>::produce(void *ap_this)
+  {
+  Prefetch<T> *p = (Prefetch<T>*)ap_this;
+  const int n = p->m_ring.size();
+
+  pthread_mutex_lock(&p->m_mutex);
+  while (!p->m_stop)
+    {
+    if (p->m_count==n) 
+      { pthread_cond_wait(&p->m_emptied,&p->m_mutex); continue; }
+    slot_type& slot = p->m_ring[(p->m_head+p->m_count)%n];
+    pthread_mutex_unlock(&p->m_mutex);
+
+    slot.m_valid = p->T::read_record(slot.m_text,p->m_loc);
+    slot.m_loc = p->m_loc;
+
+    pthread_mutex_lock(&p->m_mutex);
+    ++p->m_count;
+    pthread_cond_signal(&p->m_filled);
+    if (!slot.m_valid) break;
+    }
+  p->m_finished = true;
+  pthread_cond_signal(&p->m_filled);
+  pthread_mutex_unlock(&p->m_mutex);
+  return NULL;
+  }
+
+/** Uebernimmt den naechsten vorausgelesenen Record (der Text wird nur
+    getauscht, nicht kopiert). Beim ersten Aufruf nach init() oder
+    setpos() wird der Erzeuger gestartet. */
+
+template <class T>
+bool
+Prefetch<T>::read_record(string& a_text,streampos& a_loc)
+  {
+  if (!m_running) start(a_loc);
+
+  bool valid = false;
+  pthread_mutex_lock(&m_mutex);
+  while ((m_count==0)&&(!m_finished)) pthread_cond_wait(&m_filled,&m_mutex);
+  if (m_count>0)
+    {
+    slot_type& slot = m_ring[m_head];
+    a_text.swap(slot.m_text);
+    a_loc = slot.m_loc;
+    valid = slot.m_valid;
+    m_head = (m_head+1)%m_ring.size(); --m_count;
+    pthread_cond_signal(&m_emptied);
+    }
+  pthread_mutex_unlock(&m_mutex);
+  if (!valid) a_text.erase();
+  return valid;
+  }
+
+/** Bei unveraenderter Position bleibt der Erzeuger aktiv (vgl.
+    Reader::setpos()), ansonsten wird er angehalten und T::setpos()
+    positioniert den Strom neu; das folgende fetch() startet ihn
+    wieder. */
+
+template <class T>
+void
+Prefetch<T>::setpos(const marker_type& mark)
+  {
+  LOG_METHOD("Access","Prefetch<T>","setpos",mark);
+
+  bool sameposition = ( (m_curr_loc == mark.m_spos) && 
+			(m_ahead_loc == mark.m_spos) );
+  if (sameposition) { TRACE("same position"); return; }
+
+  stop();
+  T::setpos(mark);
+  }
+
+/** Der Erzeuger wird angehalten, das folgende read_record() startet
+    ihn an der neuen Position. */
+
+template <class T>
+bool
+Prefetch<T>::reposition(streampos a_loc)
+  {
+  stop();
+  return T::reposition(a_loc);
+  }
+
+template Prefetch<TAG_File_Reader>;
+template Prefetch<CSV_File_Reader>;
+template Prefetch<TAB_File_Reader>;
+
+/** Klasse Chunked<T> *********************************************/
+
+/** Groesse eines Abschnitts in Bytes: 4 MB oder der Wert der
+    Umgebungsvariablen DAL_CHUNK_BYTES. Ein kleiner Wert zerlegt auch
+    kleine Dateien in mehrere Abschnitte (fuer die Tests). */
+
+static long
+chunk_size()
+{
+    const char *p_bytes = getenv("DAL_CHUNK_BYTES");
+    if (p_bytes!=NULL) 
+    {
+	long bytes = atol(p_bytes);
+	if (bytes>0) return bytes;
+    }
+    return 4L<<20;
+}
+
+template <class T>
+Chunked<T>::Chunked
+  (
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref
+  )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref)  
+  , m_chunk_size(0)
+  , m_chunks(0)
+  , m_assign(0)
+  , m_consume(0)
+  , m_pos(0)
+  , m_ahead_valid(false)
+  , m_running(false)
+  , m_sequential(false)
+  , m_stop(false)
+  {
+  pthread_mutex_init(&m_mutex,NULL);
+  pthread_cond_init(&m_filled,NULL);
+  pthread_cond_init(&m_emptied,NULL);
+  }
+
+template <class T>
+Chunked<T>::~Chunked
+  (
+  )
+  {
+  stop();
+  pthread_cond_destroy(&m_emptied);
+  pthread_cond_destroy(&m_filled);
+  pthread_mutex_destroy(&m_mutex);
+  }
+
+/** Teilt die Datei ab a_loc in Abschnitte und startet die Worker.
+    Lohnt sich das nicht (kleine Datei, ein Prozessor), wird gleich
+    sequentiell gelesen. Mit DAL_CHUNK_BYTES laufen auch auf einem
+    Prozessor zwei Worker, damit die Tests sie ueberall erreichen. */
+
+template <class T>
+void
+Chunked<T>::start(streampos a_loc)
+  {
+  LOG_METHOD("Access","Chunked<T>","start",context()->name());
+  m_sequential = true;
+
+  struct stat st;
+  if (stat(m_fname.c_str(),&st)!=0) return;
+  long start = a_loc;
+  long size = st.st_size - start;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if ((threads<2)&&(getenv("DAL_CHUNK_BYTES")!=NULL)) threads = 2;
+  m_chunk_size = chunk_size();
+  if ((size<2*m_chunk_size)||(threads<2)) return;
+
+  m_start = a_loc;
+  m_chunks = (size+m_chunk_size-1)/m_chunk_size;
+  if (threads>m_chunks) threads = m_chunks;
+  m_window.clear(); m_window.resize(2*threads);
+  m_assign = m_consume = 0; m_pos = 0;
+  m_stop = false;
+
+  m_workers.resize(threads);
+  for (size_t i=0;i<m_workers.size();++i)
+    if (pthread_create(&m_workers[i],NULL,&Chunked<T>::work,this)!=0)
+      { ERROR("cannot start worker thread for '"<<name()<<"'"); exit(-1); }
+  m_running = true;
+  m_sequential = false;
+  TRACE(m_chunks<<" chunks, "<<threads<<" threads");
+  }
+
+/** Haelt alle Worker an und verwirft die zerlegten Abschnitte. */
+
+template <class T>
+void
+Chunked<T>::stop()
+  {
+  if (!m_running) return;
+  LOG_METHOD("Access","Chunked<T>","stop",context()->name());
+  pthread_mutex_lock(&m_mutex);
+  m_stop = true;
+  pthread_cond_broadcast(&m_emptied);
+  pthread_mutex_unlock(&m_mutex);
+  for (size_t i=0;i<m_workers.size();++i) pthread_join(m_workers[i],NULL);
+  m_workers.clear();
+  m_window.clear();
+  m_running = false;
+  }
+
+/** Wechselt auf sequentielles Lesen ab a_loc (-1: Dateiende). */
+
+template <class T>
+bool
+Chunked<T>::sequential(streampos a_loc)
+  {
+  stop();
+  m_sequential = true;
+  mp_stream->clear();
+  if (a_loc==streampos(-1)) { mp_stream->seekg(0,ios::end); return false; }
+  mp_stream->seekg(a_loc);
+  return true;
+  }
+
+/** Beginn des Abschnitts a_chunk: der erste Zeilenanfang ab der
+    nominellen Position (Vielfaches der Abschnittsgroesse). */
+
+template <class T>
+streampos
+Chunked<T>::boundary(istream& is,long a_chunk) const
+  {
+  if (a_chunk==0) return m_start;
+  is.clear();
+  is.seekg(streampos(long(m_start)+a_chunk*m_chunk_size-1));
+  char c;
+  while (is.get(c)) if (c=='\n') break;
+  if (!is.good()) { is.clear(); is.seekg(0,ios::end); }
+  return is.tellg();
+  }
+
+/** Zerlegt Abschnitt a_chunk in seinen Eintrag im Fenster. Es werden
+    alle Records uebernommen, die vor dem Beginn des folgenden
+    Abschnitts beginnen. */
+
+template <class T>
+void
+Chunked<T>::scan_chunk(istream& is,long a_chunk)
+  {
+  chunk_type& chunk = m_window[a_chunk%m_window.size()];
+  streampos end = boundary(is,a_chunk+1);
+  if (a_chunk+1==m_chunks) { is.clear(); is.seekg(0,ios::end); end = is.tellg(); }
+  is.clear();
+  is.seekg(boundary(is,a_chunk));
+
+  string text;
+  streampos loc;
+  chunk.m_first = chunk.m_next = streampos(-1);
+  while (scan_record(is,text,loc))
+    {
+    if (chunk.m_first==streampos(-1)) chunk.m_first = loc;
+    if (loc>=end) { chunk.m_next = loc; break; }
+    chunk.m_values.push_back(predecoded_type());
+    predecode(text.data(),text.data()+text.size(),chunk.m_values.back());
+    chunk.m_text.push_back(string());
+    chunk.m_text.back().swap(text);
+    chunk.m_loc.push_back(loc);
+    }
+  }
+
+/** Rumpf eines Worker-Threads: holt sich den naechsten freien
+    Abschnitt, solange er ins Fenster passt, und zerlegt ihn auf einem
+    eigenen Strom. */
+
+template <class T>
+void*
+Chunked<T>::work(void *ap_this)
+  {
+  Chunked<T> *p = (Chunked<T>*)ap_this;
+  const long n = p->m_window.size();
+  ifstream is(p->m_fname.c_str());
+
+  pthread_mutex_lock(&p->m_mutex);
+  while ((!p->m_stop)&&(p->m_assign<p->m_chunks))
+    {
+    if (p->m_assign>=p->m_consume+n)
+      { pthread_cond_wait(&p->m_emptied,&p->m_mutex); continue; }
+    long chunk = p->m_assign++;
+    pthread_mutex_unlock(&p->m_mutex);
+
+    p->scan_chunk(is,chunk);
+
+    pthread_mutex_lock(&p->m_mutex);
+    p->m_window[chunk%n].m_ready = true;
+    pthread_cond_broadcast(&p->m_filled);
+    }
+  pthread_mutex_unlock(&p->m_mutex);
+  return NULL;
+  }
+
+/** Uebernimmt den naechsten Record in Dateireihenfolge (der Text
+    wird nur getauscht). Beim Wechsel in den naechsten Abschnitt wird
+    geprueft, ob dessen erster Record an den Vorgaenger anschliesst;
+    sonst wird ab dort sequentiell gelesen. */
+
+template <class T>
+bool
+Chunked<T>::read_record(string& a_text,streampos& a_loc)
+  {
+  if ((!m_running)&&(!m_sequential)) start(a_loc);
+  m_ahead_valid = false;
+  if (m_sequential) return T::read_record(a_text,a_loc);
+
+  const long n = m_window.size();
+  pthread_mutex_lock(&m_mutex);
+  chunk_type *p_chunk = &m_window[m_consume%n];
+  while (!p_chunk->m_ready) pthread_cond_wait(&m_filled,&m_mutex);
+  while (m_pos==p_chunk->m_text.size())
+    {
+    // Abschnitt erschoepft: Anschluss pruefen und freigeben
+    streampos next = p_chunk->m_next;
+    bool last = (next==streampos(-1))||(m_consume+1==m_chunks);
+    if (!last)
+      {
+      chunk_type& succ = m_window[(m_consume+1)%n];
+      while (!succ.m_ready) pthread_cond_wait(&m_filled,&m_mutex);
+      last = (succ.m_first!=next);
+      if (last) ++m_metrics.m_mismatches;
+      }
+    ++m_metrics.m_chunks;
+    if (last)
+      {
+      pthread_mutex_unlock(&m_mutex);
+      TRACE("sequential from "<<next);
+      if (!sequential(next)) { a_text.erase(); return false; }
+      return T::read_record(a_text,a_loc);
+      }
+    p_chunk->m_text.clear(); p_chunk->m_loc.clear(); p_chunk->m_values.clear();
+    p_chunk->m_ready = false;
+    ++m_consume; m_pos = 0;
+    pthread_cond_broadcast(&m_emptied);
+    p_chunk = &m_window[m_consume%n];
+    }
+  pthread_mutex_unlock(&m_mutex);
+
+  a_text.swap(p_chunk->m_text[m_pos]);
+  a_loc = p_chunk->m_loc[m_pos];
+  m_ahead_values.swap(p_chunk->m_values[m_pos]);
+  m_ahead_valid = true;
+  ++m_pos;
+  return true;
+  }
+
+/** Laedt den lookahead, mit den vom Worker zerlegten Spalten, falls
+    er aus einem Abschnitt stammt. */
+
+template <class T>
+void
+Chunked<T>::load_lookahead()
+  {
+  mp_predecoded = (m_ahead_valid) ? &m_ahead_values : NULL;
+  T::load_lookahead();
+  mp_predecoded = NULL;
+  m_ahead_valid = false;
+  }
+
+/** Bei unveraenderter Position bleibt alles wie es ist (vgl.
+    Reader::setpos()), ansonsten wird ab der neuen Position
+    sequentiell gelesen. */
+
+template <class T>
+void
+Chunked<T>::setpos(const marker_type& mark)
+  {
+  LOG_METHOD("Access","Chunked<T>","setpos",mark);
+
+  bool sameposition = ( (m_curr_loc == mark.m_spos) && 
+			(m_ahead_loc == mark.m_spos) );
+  if (sameposition) { TRACE("same position"); return; }
+
+  stop();
+  m_sequential = true;
+  T::setpos(mark);
+  }
+
+template <class T>
+bool
+Chunked<T>::reposition(streampos a_loc)
+  {
+  stop();
+  m_sequential = true;
+  return T::reposition(a_loc);
+  }
+
+template Chunked<TAG_File_Reader>;
+template Chunked<CSV_File_Reader>;
+template Chunked<TAB_File_Reader>;
+#endif
+
+/** Endet der Dateiname auf \c .gz? */
+
+static bool
+is_compressed(const string& a_name)
+{
+    string::size_type n = a_name.length();
+    return (n>3) && (a_name.compare(n-3,3,".gz")==0);
+}
+
+/** Endet der Dateiname auf \c .col (Spaltenformat)? */
+
+static bool
+is_column_file(const string& a_name)
+{
+    string::size_type n = a_name.length();
+    return (n>4) && (a_name.compare(n-4,4,".col")==0);
+}
+
+/** Klasse AsyncFileBuffer ****************************************/
+
+AsyncFileBuffer::AsyncFileBuffer
+  (
+  size_t a_size ///< Groesse jedes der beiden Puffer
+  )
+  : m_fd(-1)
+  , m_size(a_size)
+  , m_active(0)
+  , m_offset(0)
+  , m_error(false)
+#ifdef HAVE_LIBZ
+  , m_gz(NULL)
+#endif
+#ifdef HAVE_LIBPTHREAD
+  , m_pending(false)
+  , m_pending_size(0)
+  , m_stop(false)
+#endif
+  {
+  mp_buffer[0] = new char[m_size];
+  mp_buffer[1] = new char[m_size];
+  setp(mp_buffer[0],mp_buffer[0]+m_size);
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_init(&m_mutex,NULL);
+  pthread_cond_init(&m_work,NULL);
+  pthread_cond_init(&m_done,NULL);
+#endif
+  }
+
+AsyncFileBuffer::~AsyncFileBuffer
+  (
+  )
+  {
+  close();
+#ifdef HAVE_LIBPTHREAD
+  pthread_cond_destroy(&m_done);
+  pthread_cond_destroy(&m_work);
+  pthread_mutex_destroy(&m_mutex);
+#endif
+  delete[] mp_buffer[1];
+  delete[] mp_buffer[0];
+  }
+
+AsyncFileBuffer*
+AsyncFileBuffer::open
+  (
+  const char *ap_name
+  )
+  {
+  if (is_open()) return NULL;
+  m_fd = ::open(ap_name,O_WRONLY|O_CREAT|O_TRUNC,0666);
+  if (m_fd<0) return NULL;
+#ifdef HAVE_LIBZ
+  if (is_compressed(ap_name))
+    {
+    m_gz = gzdopen(m_fd,"wb");
+    if (m_gz==NULL) { ::close(m_fd); m_fd = -1; return NULL; }
+    }
+#endif
+  m_active = 0;
+  m_offset = 0;
+  m_error = false;
+  setp(mp_buffer[0],mp_buffer[0]+m_size);
+#ifdef HAVE_LIBPTHREAD
+  m_pending = m_stop = false;
+  if (pthread_create(&m_thread,NULL,&AsyncFileBuffer::consume,this)!=0)
+    { ERROR("cannot start writer thread for '"<<ap_name<<"'"); exit(-1); }
+#endif
+  return this;
+  }
+
+/** Schreibt alle Puffer, beendet den Schreib-Thread und schliesst
+    die Datei. */
+
+AsyncFileBuffer*
+AsyncFileBuffer::close
+  (
+  )
+  {
+  if (!is_open()) return NULL;
+  submit();
+  wait();
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  m_stop = true;
+  pthread_cond_signal(&m_work);
+  pthread_mutex_unlock(&m_mutex);
+  pthread_join(m_thread,NULL);
+#endif
+#ifdef HAVE_LIBZ
+  if (m_gz!=NULL) 
+    { if (gzclose(m_gz)!=Z_OK) set_error(); m_gz = NULL; }
+  else
+#endif
+  ::close(m_fd);
+  m_fd = -1;
+  return (failed()) ? NULL : this;
+  }
+
+/** Schreibt einen Block vollstaendig in die Datei (ggf.
+    komprimiert). */
+
+void
+AsyncFileBuffer::write_block
+  (
+  const char *p,
+  size_t n
+  )
+  {
+  if (failed()) return;
+#ifdef HAVE_LIBZ
+  if (m_gz!=NULL)
+    {
+    if ((n>0)&&(gzwrite(m_gz,p,n)!=(int)n)) set_error();
+    return;
+    }
+#endif
+  while (n>0)
+    {
+    ssize_t k = ::write(m_fd,p,n);
+    if (k<0) { if (errno!=EINTR) { set_error(); return; } }
+    else { p += k; n -= k; }
+    }
+  }
+
+/** m_error wird vom Schreib-Thread gesetzt und vom Aufrufer
+    gelesen, daher nur unter m_mutex. */
+
+void
+AsyncFileBuffer::set_error
+  (
+  )
+  {
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  m_error = true;
+  pthread_mutex_unlock(&m_mutex);
+#else
+  m_error = true;
+#endif
+  }
+
+bool
+AsyncFileBuffer::failed
+  (
+  )
+  {
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  bool error = m_error;
+  pthread_mutex_unlock(&m_mutex);
+  return error;
+#else
+  return m_error;
+#endif
+  }
+
+/** Uebergibt den gerade gefuellten Puffer zur Ausgabe und setzt das
+    Fuellen im anderen Puffer fort. Ohne pthreads wird direkt
+    geschrieben. */
+
+void
+AsyncFileBuffer::submit
+  (
+  )
+  {
+  size_t n = pptr()-pbase();
+  if ((n==0)||(!is_open())) return;
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  while (m_pending) pthread_cond_wait(&m_done,&m_mutex);
+  m_pending = true;
+  m_pending_size = n;
+  m_active = 1-m_active;
+  pthread_cond_signal(&m_work);
+  pthread_mutex_unlock(&m_mutex);
+#else
+  write_block(mp_buffer[m_active],n);
+#endif
+  m_offset += n;
+  setp(mp_buffer[m_active],mp_buffer[m_active]+m_size);
+  }
+
+/** Wartet, bis alle uebergebenen Puffer geschrieben sind. */
+
+void
+AsyncFileBuffer::wait
+  (
+  )
+  {
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  while (m_pending) pthread_cond_wait(&m_done,&m_mutex);
+  pthread_mutex_unlock(&m_mutex);
+#endif
+  }
+
+#ifdef HAVE_LIBPTHREAD
+/** Rumpf des Schreib-Threads: schreibt jeweils den nicht aktiven
+    Puffer, sobald er per submit() uebergeben wurde. */
+
+void*
+AsyncFileBuffer::consume
+  (
+  void *ap_this
+  )
+  {
+  AsyncFileBuffer *p = (AsyncFileBuffer*)ap_this;
+  pthread_mutex_lock(&p->m_mutex);
+  while (true)
+    {
+    while ((!p->m_pending)&&(!p->m_stop)) pthread_cond_wait(&p->m_work,&p->m_mutex);
+    if (!p->m_pending) break;
+    const char *block = p->mp_buffer[1-p->m_active];
+    size_t n = p->m_pending_size;
+    pthread_mutex_unlock(&p->m_mutex);
+    p->write_block(block,n);
+    pthread_mutex_lock(&p->m_mutex);
+    p->m_pending = false;
+    pthread_cond_signal(&p->m_done);
+    }
+  pthread_mutex_unlock(&p->m_mutex);
+  return NULL;
+  }
+#endif
+
+/** Puffer voll: uebergeben und das Zeichen in den neuen Puffer
+    schreiben. */
+
+int
+AsyncFileBuffer::overflow
+  (
+  int c
   )
   {
-  m_indirect_fields.push_back(ap_field);
+  if ((!is_open())||(failed())) return EOF;
+  submit();
+  if (c!=EOF) { *pptr() = c; pbump(1); }
+  return (c==EOF) ? 0 : c;
   }
 
-/** Nach dem Auslesen neue Datei oeffnen, wenn Dateiende erreicht
-    wurde. */
+/** flush() uebergibt den Puffer nur, es wird nicht auf das Schreiben
+    gewartet. */
 
-template <class T> void
-File_List<T>::operate
+int
+AsyncFileBuffer::sync
   (
-  const id_type& a_collection_id,
-  field_list_type& a_fields
   )
   {
-  LOG_METHOD("Access","File_List<T>","operate",a_collection_id.no);
+  submit();
+  return (failed()) ? -1 : 0;
+  }
 
-  if ((p_reader==NULL) || (m_delayed_reset)) // neue Datei?
-    {
-    // Filename suchen
-    int n = 0; mi_file = m_filenames.begin();
-    while (n!=m_delayed_pos.m_file) { ++n; ++mi_file; }
+/** Die aktuelle Position (tellp) ergibt sich ohne Schreiben aus
+    m_offset und dem Fuellstand, jede andere Positionierung wartet
+    erst auf die Ausgabe aller Puffer. */
 
-    if (n!=m_curr_file)
-      { // neuen Reader oeffnen 
-      if (mp_reader!=NULL) delete mp_reader;
-      mp_context->infile() = *mi_file;
-      mp_reader = get_reader(mp_context,...);
-      bool ok = mp_reader->init(a_indirect_fields);
-      }
+streampos
+AsyncFileBuffer::seekoff
+  (
+  streamoff a_off,
+  ios::seekdir a_dir,
+  ios::openmode a_mode
+  )
+  {
+  streamoff curr = m_offset + (pptr()-pbase());
+  if (a_dir==ios::beg) return seekpos(a_off,a_mode);
+  if (a_dir==ios::cur) return (a_off==0) ? streampos(curr) : seekpos(curr+a_off,a_mode);
+  return streampos(-1);
+  }
+
+streampos
+AsyncFileBuffer::seekpos
+  (
+  streampos a_pos,
+  ios::openmode
+  )
+  {
+  if (!is_open()) return streampos(-1);
+  submit();
+  wait();
+#ifdef HAVE_LIBZ
+  if (m_gz!=NULL) return (a_pos==streampos(m_offset)) ? a_pos : streampos(-1);
+#endif
+  if (lseek(m_fd,streamoff(a_pos),SEEK_SET)<0) return streampos(-1);
+  m_offset = a_pos;
+  return a_pos;
+  }
+
+/** Klasse AsyncFileStream ****************************************/
+
+void
+AsyncFileStream::open
+  (
+  const char *p,
+  ios::openmode
+  )
+  {
+  if (m_buffer.open(p)==NULL) setstate(ios::failbit); else clear();
+  }
+
+void
+AsyncFileStream::close
+  (
+  )
+  {
+  if (m_buffer.close()==NULL) setstate(ios::failbit);
+  }
+
+/** Klasse Buffered<T> ********************************************/
+
+template <class T>
+Buffered<T>::Buffered
+  (
+  Context *ap_context,
+  index_type *ap_output_key,
+  index_type *ap_output_ref,
+  index_type *ap_input_key,
+  index_type *ap_required_key,
+  ostream *ap_os
+  )
+  : T(ap_context,ap_output_key,ap_output_ref,ap_input_key,ap_required_key,ap_os)
+  {
+  }
+
+template Buffered<TAG_Writer>;
+template Buffered<CSV_Writer>;
+template Buffered<TAB_Writer>;
+template File< Buffered<TAG_Writer> >;
+template File< Buffered<CSV_Writer> >;
+template File< Buffered<TAB_Writer> >;
+
+#ifdef HAVE_LIBZ
+/** Klasse GzFileBuffer *******************************************/
+
+/// Anzahl Zeichen des vorigen Blocks, die fuer putback() erhalten bleiben
+static const size_t g_gz_putback = 256;
+
+GzFileBuffer::GzFileBuffer
+  (
+  size_t a_size ///< Groesse jedes der beiden Puffer
+  )
+  : m_gz(NULL)
+  , m_size(a_size)
+  , m_active(0)
+  , m_offset(0)
+  , m_eof(false)
+#ifdef HAVE_LIBPTHREAD
+  , m_running(false)
+  , m_ready(false)
+  , m_ready_size(0)
+  , m_stop(false)
+#endif
+  {
+  mp_buffer[0] = new char[g_gz_putback+m_size];
+  mp_buffer[1] = new char[g_gz_putback+m_size];
+  char *p = mp_buffer[0]+g_gz_putback;
+  setg(p,p,p);
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_init(&m_mutex,NULL);
+  pthread_cond_init(&m_work,NULL);
+  pthread_cond_init(&m_done,NULL);
+#endif
+  }
+
+GzFileBuffer::~GzFileBuffer
+  (
+  )
+  {
+  close();
+#ifdef HAVE_LIBPTHREAD
+  pthread_cond_destroy(&m_done);
+  pthread_cond_destroy(&m_work);
+  pthread_mutex_destroy(&m_mutex);
+#endif
+  delete[] mp_buffer[1];
+  delete[] mp_buffer[0];
+  }
+
+GzFileBuffer*
+GzFileBuffer::open
+  (
+  const char *ap_name
+  )
+  {
+  if (is_open()) return NULL;
+  m_gz = gzopen(ap_name,"rb");
+  if (m_gz==NULL) return NULL;
+  gzbuffer(m_gz,1<<17);
+  m_active = 0;
+  m_offset = 0;
+  m_eof = false;
+  char *p = mp_buffer[0]+g_gz_putback;
+  setg(p,p,p);
+  start();
+  return this;
+  }
+
+GzFileBuffer*
+GzFileBuffer::close
+  (
+  )
+  {
+  if (!is_open()) return NULL;
+  stop();
+  gzclose(m_gz);
+  m_gz = NULL;
+  return this;
+  }
 
-    // Reader positionieren
-    mp_reader->setpos(m_delayed_pos);
+/** Entpackt den naechsten Block nach \c p (hinter den
+    putback-Bereich). Rueckgabe ist die Anzahl Zeichen, 0 bei
+    Dateiende oder Fehler. */
 
-    m_delayed_reset=false;
+size_t
+GzFileBuffer::read_block
+  (
+  char *p
+  )
+  {
+  size_t n = 0;
+  while (n<m_size)
+    {
+    int k = gzread(m_gz,p+g_gz_putback+n,m_size-n);
+    if (k<=0) break;
+    n += k;
     }
+  return n;
+  }
+
+/** Startet den Entpack-Thread fuer den Puffer mp_buffer[1-m_active]
+    ab der aktuellen Position von m_gz. */
+
+void
+GzFileBuffer::start
+  (
+  )
+  {
+#ifdef HAVE_LIBPTHREAD
+  m_ready = m_stop = false;
+  if (pthread_create(&m_thread,NULL,&GzFileBuffer::produce,this)!=0)
+    { ERROR("cannot start decompression thread"); exit(-1); }
+  m_running = true;
+#endif
+  }
+
+/** Haelt den Entpack-Thread an, ein bereits entpackter Block wird
+    verworfen. Danach gehoert m_gz wieder dem Aufrufer. */
+
+void
+GzFileBuffer::stop
+  (
+  )
+  {
+#ifdef HAVE_LIBPTHREAD
+  if (!m_running) return;
+  pthread_mutex_lock(&m_mutex);
+  m_stop = true;
+  pthread_cond_signal(&m_work);
+  pthread_mutex_unlock(&m_mutex);
+  pthread_join(m_thread,NULL);
+  m_running = m_ready = false;
+#endif
+  }
+
+#ifdef HAVE_LIBPTHREAD
+/** Rumpf des Entpack-Threads: fuellt den nicht aktiven Puffer,
+    sobald underflow() ihn freigegeben hat, bis zum Dateiende. */
 
-  if (!mp_reader->done())
+void*
+GzFileBuffer::produce
+  (
+  void *ap_this
+  )
+  {
+  GzFileBuffer *p = (GzFileBuffer*)ap_this;
+  pthread_mutex_lock(&p->m_mutex);
+  while (true)
     {
-    mp_reader->operate(a_collection_id,a_fields);
+    while ((p->m_ready)&&(!p->m_stop)) pthread_cond_wait(&p->m_work,&p->m_mutex);
+    if (p->m_stop) break;
+    char *block = p->mp_buffer[1-p->m_active];
+    pthread_mutex_unlock(&p->m_mutex);
+    size_t n = p->read_block(block);
+    pthread_mutex_lock(&p->m_mutex);
+    p->m_ready = true;
+    p->m_ready_size = n;
+    pthread_cond_signal(&p->m_done);
+    if (n==0) break;
     }
-  else
+  pthread_mutex_unlock(&p->m_mutex);
+  return NULL;
+  }
+#endif
+
+/** Aktueller Block gelesen: auf den naechsten (bereits entpackten)
+    Block umschalten. Das Ende des alten Blocks wird als
+    putback-Bereich vor den neuen kopiert. Bei Dateiende bleibt der
+    alte Block erhalten (fuer seekg() in den Block). */
+
+int
+GzFileBuffer::underflow
+  (
+  )
+  {
+  if (gptr()<egptr()) return (unsigned char)*gptr();
+  if ((!is_open())||(m_eof)) return EOF;
+
+  int next = 1-m_active;
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  while (!m_ready) pthread_cond_wait(&m_done,&m_mutex);
+  size_t n = m_ready_size;
+  pthread_mutex_unlock(&m_mutex);
+#else
+  size_t n = read_block(mp_buffer[next]);
+#endif
+  if (n==0) { m_eof = true; return EOF; }
+
+  size_t keep = egptr()-eback();
+  if (keep>g_gz_putback) keep = g_gz_putback;
+  char *p = mp_buffer[next]+g_gz_putback;
+  memcpy(p-keep,egptr()-keep,keep);
+  m_offset += (egptr()-eback())-keep;
+  setg(p-keep,p,p+n);
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&m_mutex);
+  m_active = next;
+  m_ready = false;
+  pthread_cond_signal(&m_work);
+  pthread_mutex_unlock(&m_mutex);
+#else
+  m_active = next;
+#endif
+  return (unsigned char)*gptr();
+  }
+
+/** tellg() ergibt sich aus m_offset und der Leseposition im Block. */
+
+streampos
+GzFileBuffer::seekoff
+  (
+  streamoff a_off,
+  ios::seekdir a_dir,
+  ios::openmode a_mode
+  )
+  {
+  streamoff curr = m_offset + (gptr()-eback());
+  if (a_dir==ios::beg) return seekpos(a_off,a_mode);
+  if (a_dir==ios::cur) return (a_off==0) ? streampos(curr) : seekpos(curr+a_off,a_mode);
+  return streampos(-1);
+  }
+
+streampos
+GzFileBuffer::seekpos
+  (
+  streampos a_pos,
+  ios::openmode
+  )
+  {
+  if (!is_open()) return streampos(-1);
+  streamoff pos = a_pos;
+
+  // innerhalb des aktuellen Blocks (inkl. putback-Bereich)?
+  if ((pos>=m_offset)&&(pos<=m_offset+(egptr()-eback())))
     {
-    bool fileok = true;
-    while ((mi_file!=m_filenames.end()) && (fileok))
-      {
-      fileok=false;
-      ++mi_file;
-      ++m_curr_file; 
-      if (mi_file!=m_filenames.end())
-        {
-        TRACE_VAR(*mi_file);
-        delete mp_reader;
-        mp_context->infile() = *mi_file;
-        mp_reader = get_reader(mp_context,...);
-        fileok = mp_reader->init(a_fields);
-        } // if
-      }  // while
-    if (fileok) mp_reader->operate(a_collection_id,a_fields);
+    setg(eback(),eback()+(pos-m_offset),egptr());
+    return a_pos;
+    }
+
+  stop();
+  if (gzseek(m_gz,pos,SEEK_SET)<0) return streampos(-1);
+  m_offset = pos;
+  m_eof = false;
+  char *p = mp_buffer[m_active]+g_gz_putback;
+  setg(p,p,p);
+  start();
+  return a_pos;
   }
 
-/** Neupositionierung auf m_mark, wobei ggf. andere Datei als die
-    aktuelle geoffnet werden muss. Fuer das init() der neuen Datei
-    brauchen wir die field_list, die wir hier nicht haben. Muss eine
-    neue Datei geoeffnet werden, so verlagern wir dies in den
-    naechsten ::operate Aufruf (der bei rewind() auch immer erfolgt). */
+/** Klasse GzFileStream *******************************************/
+
+void
+GzFileStream::open
+  (
+  const char *p,
+  ios::openmode
+  )
+  {
+  if (m_buffer.open(p)==NULL) setstate(ios::failbit); else clear();
+  }
 
-template <class T> 
 void
-File_List<T>::reset
+GzFileStream::close
   (
   )
   {
-    m_delayed_reset = (m_old.m_file_no != m_mark.m_file_no);
-    if (!m_delayed_reset) T::reset(); else m_delayed_pos = m_mark;
+  if (m_buffer.close()==NULL) setstate(ios::failbit);
   }
 
-/** selbe Schwierigkeit wie bei reset(), ggf. muessen wir ein neues
-    File oeffnen. */
+/** Klasse Compressed<T> ******************************************/
 
 template <class T>
-void
-File_List<T>::set_position
+Compressed<T>::Compressed
+  (
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref,
+  istream *ap_is
+  )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,ap_is)
+  {
+  }
+
+template Compressed<TAG_Reader>;
+template Compressed<CSV_Reader>;
+template Compressed<TAB_Reader>;
+template File< Compressed<TAG_Reader> >;
+template File< Compressed<CSV_Reader> >;
+template File< Compressed<TAB_Reader> >;
+#endif
+
+/** Klasse File_List<T> *******************************************/
+
+/** Der Strom wird erst in init() angelegt, wenn die Liste gelesen
+    ist (File_List<T> verwaltet die Stroeme selbst). */
+
+template <class T>
+File_List<T>::File_List
   (
-  const marker_type &a_marker
+  Context *ap_context,
+  index_type *ap_key,
+  index_type *ap_ref,
+  index_type *ap_required_key,
+  index_type *ap_required_ref
   )
+  : T(ap_context,ap_key,ap_ref,ap_required_key,ap_required_ref,NULL)  
+  , m_file(-1)
+  , m_next_file(0)
+  , m_curr_file(0)
+  , mp_next(NULL)
+  , m_next_shard(-1)
+  , m_header_size(-1)
   {
-    m_delayed_reset = (m_old.m_file_no != a_marker.m_file_no);
-    if (!m_delayed_reset) T::set_position(a_marker); else m_delayed_pos=a_marker;
   }
 
-template <class T> 
-char_cpc
-File_List<T>::name
+template <class T>
+File_List<T>::~File_List
   (
   )
   {
-    return m_listname.c_str();
+  delete mp_stream;
+  delete mp_next;
+  }
+
+/** Liest die Dateinamen aus der Liste. Kommentarzeilen (\c #) werden
+    ueberlesen, relative Namen beziehen sich auf das Verzeichnis der
+    Liste. Wie bei File<T> wird die Liste notfalls im DAL_DATAPATH
+    gesucht. */
+
+template <class T>
+void
+File_List<T>::read_list()
+  {
+  string fname = name();
+  ifstream is(fname.c_str());
+  if (!is.good())
+    {
+    char *p_path( getenv("DAL_DATAPATH") );
+    if (p_path!=NULL)
+      {
+      fname = p_path; fname += '/'; fname += name();
+      is.clear(); is.open(fname.c_str());
+      }
+    }
+  if (!is.good()) { ERROR("file '" << fname << "' not found"); exit(-1); }
+
+  string::size_type pos = fname.rfind('/');
+  string dir = (pos==string::npos) ? string() : fname.substr(0,pos+1);
+  m_filenames.clear();
+  read_white(is);
+  while (is.good() && !is.eof())
+    {
+    if (is_followed_by(is,g_char_comment,false)) 
+      { read_line(is); }
+    else
+      {
+      string file; read_word(is,file);
+      if (!file.empty()) 
+	m_filenames.push_back( (file[0]=='/') ? file : dir+file );
+      }
+    read_white(is);
+    }
+  if (m_filenames.empty()) { ERROR("no files listed in '"<<fname<<"'"); exit(-1); }
+  TRACE("list of "<<m_filenames.size()<<" files");
   }
 
-template File_List<TAG_File_Mark_Reader>;
-template File_List<CSV_File_Mark_Reader>;
+/// Bytes am Anfang der naechsten Datei, die vorausgelesen werden
+static const off_t g_shard_readahead = 4*1024*1024;
+
+/** Oeffnet die Datei mit Index \c k. Ist \c a_ahead gesetzt (die
+    Datei wird erst nach der aktuellen gelesen), wird ihr Anfang beim
+    Betriebssystem zum Vorauslesen angemeldet, damit der Wechsel am
+    Dateiende nicht auf die Platte warten muss; danach liest der Kern
+    ohnehin sequentiell voraus. Der Hinweis gilt fuer die Datei, nicht
+    fuer den Deskriptor, der daher gleich wieder geschlossen wird. */
+
+template <class T>
+ifstream*
+File_List<T>::open_file(int k,bool a_ahead)
+  {
+  const string& fname = m_filenames[k];
+#ifdef POSIX_FADV_WILLNEED
+  if (a_ahead)
+    {
+    int fd = ::open(fname.c_str(),O_RDONLY);
+    if (fd>=0) { posix_fadvise(fd,0,g_shard_readahead,POSIX_FADV_WILLNEED); ::close(fd); }
+    }
 #endif
+  ifstream *p_is = new ifstream(fname.c_str());
+  if (!p_is->good()) { ERROR("file '" << fname << "' not found"); exit(-1); }
+  return p_is;
+  }
+
+/** Macht die Datei \c k zur aktuellen Datei (mp_stream steht danach
+    hinter dem Header) und oeffnet bereits die naechste. Der Header
+    jeder weiteren Datei muss dem der ersten Datei entsprechen. */
+
+template <class T>
+void
+File_List<T>::open_shard(int k)
+  {
+  LOG_METHOD("Access","File_List<T>","open_shard",m_filenames[k]);
+
+  delete mp_stream; mp_stream = NULL;
+  if ((mp_next!=NULL)&&(m_next_shard==k))
+    { mp_stream = mp_next; mp_next = NULL; }
+  else
+    { mp_stream = open_file(k,false); }
+  m_file = k;
+
+  if (m_header_size>0)
+    {
+    string header(m_header_size,' ');
+    mp_stream->read(&header[0],m_header_size);
+    if ((mp_stream->gcount()!=m_header_size)||(header!=m_header))
+      { ERROR("header of '"<<m_filenames[k]<<"' differs from '"<<m_filenames[0]<<"'"); exit(-1); }
+    }
+
+  if ((mp_next==NULL)||(m_next_shard!=k+1))
+    {
+    delete mp_next; mp_next = NULL;
+    if (k+1<(int)m_filenames.size()) mp_next = open_file(k+1,true);
+    m_next_shard = k+1;
+    }
+  }
+
+template <class T>
+bool
+File_List<T>::init()
+  {
+  LOG_METHOD("Access","File_List<T>","init",context()->name());
+
+  read_list();
+  open_shard(0);
+  m_next_file = m_curr_file = 0;
+  return T::init();
+  }
+
+/** Liest wie T::read_record(), schaltet aber am Dateiende auf die
+    naechste Datei der Liste um. Beim ersten Aufruf (aus T::init()) ist
+    der Header der ersten Datei gerade gelesen, er wird fuer den
+    Vergleich mit den folgenden Dateien gemerkt. */
+
+template <class T>
+bool
+File_List<T>::read_record(string& a_text,streampos& a_loc)
+  {
+  if (m_header_size<0)
+    {
+    m_header_size = tell();
+    m_header.resize(m_header_size);
+    seek(0);
+    if (m_header_size>0) mp_stream->read(&m_header[0],m_header_size);
+    seek(m_header_size);
+    }
+
+  while (!T::read_record(a_text,a_loc))
+    {
+    if (m_file+1>=(int)m_filenames.size()) return false;
+    open_shard(m_file+1);
+    }
+  m_next_file = m_file;
+  return true;
+  }
+
+template <class T>
+void
+File_List<T>::load_lookahead()
+  {
+  m_curr_file = m_next_file;
+  T::load_lookahead();
+  }
+
+template <class T>
+void
+File_List<T>::getpos(marker_type& mark)
+  {
+  T::getpos(mark);
+  mark.m_file = m_curr_file;
+  }
+
+/** Wie File<T>::setpos(), aber ggf. muss zuvor die Datei \c
+    mark.m_file geoeffnet werden. */
+
+template <class T>
+void
+File_List<T>::setpos(const marker_type& mark)
+  {
+  LOG_METHOD("Access","File_List<T>","setpos",mark);
+
+  bool sameposition = ( (mark.m_file == m_next_file) &&
+			(m_curr_loc == mark.m_spos) && 
+			(m_ahead_loc == mark.m_spos) );
+  if (sameposition) { TRACE("same position"); return; }
+
+  int file = (mark.m_file<0) ? 0 : mark.m_file;
+  INVARIANT(file<(int)m_filenames.size(),"file index "<<file);
+  if (file!=m_file) open_shard(file); else mp_stream->clear();
+  seek(mark.m_spos);
+  m_curr_file = m_next_file = file;
+
+  // T::setpos soll in jedem Fall neu lesen
+  m_ahead_loc = -1;
+  T::setpos(mark);
+  }
+
+template File_List<TAG_Reader>;
+template File_List<CSV_Reader>;
+template File_List<TAB_Reader>;
 
 const char* gp_console = "console";
 const char* gp_nulldev = "null";
@@ -1952,17 +4696,80 @@ get_reader(
 	*p_name = gp_console;
 	p_reader = new TAG_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref,&cin);
     }
+#ifndef HAVE_LIBZ
+    else if (is_compressed(*p_name))
+    {
+	ERROR("compressed file "<<*p_name<<" not supported (no zlib)"); exit(-1); 
+    }
+#endif
+    else if (p_name->find(".lst")!=string::npos) // z.B. "data.csv.lst"
+    {
+	if (p_name->find(".ddl")!=string::npos)
+	    p_reader = new TAG_File_List_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else if (p_name->find(".csv")!=string::npos)
+	    p_reader = new CSV_File_List_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else if (p_name->find(".tab")!=string::npos)
+	    p_reader = new TAB_File_List_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else
+	{ ERROR("unknown file type in list "<<*p_name); exit(-1); }
+    }
     else if (p_name->find(".ddl")!=string::npos)
     {
-	p_reader = new TAG_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBZ
+	if (is_compressed(*p_name))
+	    p_reader = new TAG_Compressed_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else
+#endif
+	if (ap_context->is_mapped())
+	    p_reader = new TAG_Mapped_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBPTHREAD
+	else if (ap_context->is_bulkread())
+	    p_reader = new TAG_Chunked_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else if (ap_context->is_prefetch())
+	    p_reader = new TAG_Prefetch_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#endif
+	else
+	    p_reader = new TAG_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
     }
     else if (p_name->find(".csv")!=string::npos)
     {
-	p_reader = new CSV_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBZ
+	if (is_compressed(*p_name))
+	    p_reader = new CSV_Compressed_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else
+#endif
+	if (ap_context->is_mapped())
+	    p_reader = new CSV_Mapped_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBPTHREAD
+	else if (ap_context->is_bulkread())
+	    p_reader = new CSV_Chunked_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else if (ap_context->is_prefetch())
+	    p_reader = new CSV_Prefetch_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#endif
+	else
+	    p_reader = new CSV_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
     }
     else if (p_name->find(".tab")!=string::npos)
     {
-	p_reader = new TAB_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBZ
+	if (is_compressed(*p_name))
+	    p_reader = new TAB_Compressed_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else
+#endif
+	if (ap_context->is_mapped())
+	    p_reader = new TAB_Mapped_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#ifdef HAVE_LIBPTHREAD
+	else if (ap_context->is_bulkread())
+	    p_reader = new TAB_Chunked_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+	else if (ap_context->is_prefetch())
+	    p_reader = new TAB_Prefetch_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+#endif
+	else
+	    p_reader = new TAB_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
+    }
+    else if (is_column_file(*p_name))
+    {
+	p_reader = new COL_File_Reader(ap_context,ap_key,ap_ref,ap_rkey,ap_rref);
     }
     else if ((p_name->empty())||(*p_name==gp_nulldev)) // null is default
     {
@@ -1996,17 +4803,36 @@ get_writer(
 	*p_name = gp_console;
 	p_writer = new TAG_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref,&cout);
     }
+#ifndef HAVE_LIBZ
+    else if (is_compressed(*p_name))
+    {
+	ERROR("compressed file "<<*p_name<<" not supported (no zlib)"); exit(-1); 
+    }
+#endif
     else if (p_name->find(".ddl")!=string::npos)
     {
-	p_writer = new TAG_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	if ((ap_context->is_buffered())||(is_compressed(*p_name)))
+	    p_writer = new TAG_Buffered_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	else
+	    p_writer = new TAG_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
     }
     else if (p_name->find(".csv")!=string::npos)
     {
-	p_writer = new CSV_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	if ((ap_context->is_buffered())||(is_compressed(*p_name)))
+	    p_writer = new CSV_Buffered_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	else
+	    p_writer = new CSV_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
     }
     else if (p_name->find(".tab")!=string::npos)
     {
-	p_writer = new TAB_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	if ((ap_context->is_buffered())||(is_compressed(*p_name)))
+	    p_writer = new TAB_Buffered_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+	else
+	    p_writer = new TAB_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
+    }
+    else if (is_column_file(*p_name))
+    {
+	p_writer = new COL_File_Writer(ap_context,ap_okey,ap_oref,ap_ikey,ap_iref);
     }
     else if (*p_name==gp_nulldev)
     {
@@ -6,7 +6,17 @@
 #define ACCESS_HEADER
 
 #include <strstream>
+#include <fstream>
+#include <vector>
+#include <ctype.h> // isspace
+#include <stdio.h> // EOF
 #include "dal.hpp"
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+#ifdef HAVE_LIBZ
+#  include <zlib.h>
+#endif
 
 namespace Data_Access_Library {
 
@@ -56,6 +66,7 @@ protected:
     bool m_done;
     string m_recbegin,m_recend;
     string m_fieldbegin,m_fieldend;
+    Metrics::counters m_metrics; ///< Records, Bytes, Zeiten (siehe Metrics)
 };
     
 class Writer
@@ -71,9 +82,11 @@ public:
     virtual void setpos(const marker_type&);
     virtual bool operate();
     virtual const string& name() { return mp_context->outfile(); }
+    inline void submit() { if (mp_stream!=NULL) mp_stream->flush(); }
 
 protected:
     virtual bool fetch();
+    virtual void end_record() { mp_stream->flush(); }
     
     inline streampos tell() {return (mp_stream==&cout)?0:mp_stream->tellp();}
     inline void seek(streampos p) {if (mp_stream!=&cout) mp_stream->seekp(p);}
@@ -86,6 +99,9 @@ protected:
 protected:
     ostream* mp_stream;
     index_type *mp_output_key,*mp_output_ref,*mp_input_key,*mp_required_key;
+    string m_fieldprefix; ///< m_fieldbegin vor dem Tag (bzw. ganz, ohne %s)
+    string m_fieldsuffix; ///< m_fieldbegin nach dem Tag
+    bool m_fieldtag; ///< enthaelt m_fieldbegin den Tag (%s)?
 };
 
 class Reader
@@ -101,11 +117,21 @@ public:
     virtual void setpos(const marker_type&);
     virtual bool operate();
     virtual const string& name() { return mp_context->infile(); }
+    long index_size() const;
+    bool index_pos(long,marker_type&) const;
+    inline streampos index_start() const { return m_index_start; }
 
 protected:
     virtual bool fetch();
+    virtual bool read_record(string&,streampos&);
+    bool scan_record(istream&,string&,streampos&) const;
     virtual void load(istream&) = 0;
     virtual void sneak(istream&) = 0;
+    virtual void sneak_range(const char*,const char*);
+    virtual void load_range(const char*,const char*);
+    virtual void load_lookahead();
+    void compile_plan(bool);
+    void load_plan(const char*,const char*,char,bool);
     
     inline streampos tell() {return (mp_stream==&cin)?0:mp_stream->tellg();}
     inline void seek(streampos p) {if (mp_stream!=&cin) mp_stream->seekg(p);}
@@ -115,10 +141,74 @@ protected:
     inline void close_file_stream()
 	{ dynamic_cast<file_type*>(mp_stream)->close(); }
 
+    virtual const string& path(); 
+    void load_index();
+    void save_index();
+    bool index_skip(ix_type,bool);
+    virtual bool reposition(streampos);
+    /// Record im lookahead in den Index aufnehmen (nach sneak)
+    inline void index_record()
+	{ 
+	    if (m_index_state!=INDEX_COLLECT) return;
+	    index_entry e; e.m_loc=m_next_loc; e.m_key=m_next_key; e.m_ref=m_next_ref;
+	    m_index.push_back(e); 
+	}
+    /// Dateiende erreicht, vollstaendigen Index speichern
+    inline void index_eof()
+	{ if (m_index_state==INDEX_COLLECT) save_index(); }
+
 protected:
     istream* mp_stream;
     string m_lookahead;
+    string m_raw; ///< Feldtext fuer verzoegertes Dekodieren (Modifier :l)
     index_type *mp_key,*mp_ref,*mp_required_key,*mp_required_ref;
+
+    /** Zustand des Index: keiner (Tabellen-Modifier \c :x fehlt oder
+	Eingabe ist keine Datei), im Aufbau (seit dem ersten Record
+	fortlaufend gelesen), unterbrochen (setpos() auf andere Position
+	als den Anfang) oder vollstaendig. */
+    enum index_state { INDEX_NONE, INDEX_COLLECT, INDEX_BROKEN, INDEX_VALID };
+    struct index_entry
+    {
+	long m_loc; ///< Position des Records
+	ix_type m_key;
+	ix_type m_ref;
+    };
+    vector<index_entry> m_index; ///< alle Records der Datei
+    index_state m_index_state;
+    streampos m_index_start; ///< Position des ersten Records (nach Header)
+    bool m_index_sorted; ///< keys im Index aufsteigend?
+
+    /** Typisierte Dekodierung des Textes einer Spalte in \c n Felder
+	gleichen Typs. Rueckgabe false, wenn der Text nicht in die
+	schnelle Form passt (dann wird ueber read() gelesen). */
+    typedef bool (*decode_type)(const char*,const char*,abstract_data_type**,int);
+    /// Schritt des Parse-Plans: eine Spalte in eines oder mehrere Felder
+    struct plan_step
+    {
+	ix_type m_column; ///< Spalte (Context::offset())
+	decode_type mp_decode; ///< NULL: immer read()
+	int m_rows; ///< Anzahl Werte fuer read() (.tab), -1: read() ohne Anzahl
+	int m_first; ///< erstes Feld in m_plan_fields
+	int m_count; ///< Anzahl Felder
+    };
+    vector<plan_step> m_plan; ///< Schritte nach Spalten sortiert (siehe compile_plan())
+    vector<abstract_data_type*> m_plan_fields; ///< Zielfelder der Schritte
+    bool m_planned; ///< load_range() fuehrt m_plan aus
+
+    /// Spalte eines Records, vorab zerlegt und dekodiert (predecode())
+    struct column_value
+    {
+	long m_begin; ///< Spaltenanfang (nach Leerraum) relativ zum Record
+	long m_end; ///< Spaltenende (Trennzeichen oder Recordende)
+	double m_real; 
+	long m_int;
+	bool m_is_real,m_is_int,m_is_index; ///< Spalte ist eine Zahl dieses Typs
+    };
+    typedef vector<column_value> predecoded_type;
+    void predecode(const char*,const char*,predecoded_type&) const;
+    bool load_predecoded(const column_value&,const plan_step&,abstract_data_type**);
+    const predecoded_type *mp_predecoded; ///< Spalten des Records fuer load_plan() (oder NULL)
 };
 
 class NULL_Writer
@@ -165,13 +255,43 @@ public:
 protected:
     virtual void load(istream&);
     virtual void sneak(istream&);
+    virtual void sneak_range(const char*,const char*);
+    virtual void load_range(const char*,const char*);
+    void scan_spans(const char*,const char*);
+    void load_field(int,const char*,const char*);
+    int find_tag(const char*,int,int&) const;
+    int read_tag(istream&,int&);
+    void skip_field(istream&) const;
+    inline bool is_name_char(int c) const
+      { return (!isspace(c)) && (c!=m_fieldend[0]) && 
+	  ((m_tag_suffix.empty())||(c!=m_tag_suffix[0])); }
 protected:
-    keyword_entry *mp_keywords; ///< sortierte intag()-Auflistung 
-    char *mp_text; ///< Buffer fuer sortierte intag()-Auflistung
-    int m_key_index; /// Index des Hauptschluessels in mp_keywords
-    int m_ref_index; /// Index des Elternschluessels in mp_keywords
+    /// Eintrag der Hashtabelle: alle Felder mit gleichem intag()
+    struct tag_entry
+    {
+	string m_name; ///< intag() der Feldgruppe
+	int m_index; ///< erstes Feld der Gruppe in m_sorted
+	int m_count; ///< Anzahl der Felder (0: freier Eintrag)
+    };
+    vector<tag_entry> m_tags; ///< Hashtabelle intag() -> Feldgruppe (offene Adressierung)
+    vector<abstract_data_type*> m_sorted; ///< nach intag() sortierte Felder
+    string m_tag_prefix; ///< m_fieldbegin vor dem Tag-Namen
+    string m_tag_suffix; ///< m_fieldbegin nach dem Tag-Namen
+    string m_name; ///< Puffer fuer den zuletzt gelesenen Tag-Namen
+    int m_key_index; /// Index des Hauptschluessels in m_sorted
+    int m_ref_index; /// Index des Elternschluessels in m_sorted
     int m_size; ///< Anzahl der Felder
-    int m_length; ///< Summe der intag()-Laengen der Felder
+
+    /// Text eines bekannten Feldes im Record (siehe scan_spans())
+    struct span_type
+    {
+	int m_index; ///< erstes Feld der Gruppe in m_sorted
+	int m_count; ///< Anzahl der Felder der Gruppe
+	const char *mp_begin,*mp_end; ///< Feldtext ohne Tag und m_fieldend
+    };
+    vector<span_type> m_spans; ///< Felder des zuletzt abgesuchten Records
+    const char *mp_span_begin,*mp_span_end; ///< Record zu m_spans (NULL: keiner)
+    vector<decode_type> m_decode; ///< schnelle Dekodierung je Feld in m_sorted (oder NULL)
 };
 
 class CSV_Reader
@@ -184,6 +304,8 @@ public:
 protected:
     virtual void load(istream&);
     virtual void sneak(istream&);
+    virtual void sneak_range(const char*,const char*);
+    virtual void load_range(const char*,const char*);
 protected:
     int m_key_index; /// Offset des Hauptschluessels in Tabelle
     int m_ref_index; /// Offset des Elternschluessels in Tabelle
@@ -210,6 +332,8 @@ public:
 protected:
     virtual void load(istream&);
     virtual void sneak(istream&);
+    virtual void sneak_range(const char*,const char*);
+    virtual void load_range(const char*,const char*);
 protected:
     int m_key_index; /// Offset des Hauptschluessels in Tabelle
     int m_ref_index; /// Offset des Elternschluessels in Tabelle
@@ -226,6 +350,65 @@ public:
     void write_header();
 };
 
+/** Binaeres Spaltenformat (.col). Jedes Feld wird als
+    zusammenhaengende Spalte abgelegt, die Spalten werden erst beim
+    Schliessen der Datei geschrieben. Siehe access.cpp fuer das
+    Dateiformat. */
+
+class COL_Writer
+    : public Writer
+{
+public:
+    COL_Writer(Context*,index_type*,index_type*,index_type*,index_type*,ostream*);
+    virtual ~COL_Writer() {}
+    virtual bool init();
+    virtual void setpos(const marker_type&);
+    virtual bool operate();
+protected:
+    virtual bool fetch();
+    void write_columns();
+    void close_file_stream();
+protected:
+    adtp_list m_columns; ///< Felder, die als Spalte ausgegeben werden
+    vector<string> m_data; ///< Spalteninhalt je Feld
+    vector< vector<long> > m_offsets; ///< Anfang jeder Zeile in m_data
+    ix_type m_rows; ///< Anzahl der geschriebenen Records
+};
+
+class COL_Reader
+    : public Reader
+{
+public:
+    COL_Reader(Context*,index_type*,index_type*,index_type*,index_type*,istream*);
+    virtual ~COL_Reader() {}
+    virtual bool init();
+    virtual void setpos(const marker_type&);
+protected:
+    struct column_type
+    {
+	abstract_data_type *mp_field; ///< Feld, das aus der Spalte gelesen wird
+	int m_column; ///< Nummer der Spalte in der Datei
+	const long *mp_offsets; ///< Offsettabelle der Spalte (rows+1 Eintraege)
+	const char *mp_values; ///< Anfang der Werte in der Spalte
+	label_map_type m_labels; ///< Umsetzung der Label-Werte
+    };
+    typedef list<column_type> column_list;
+
+    virtual bool fetch();
+    virtual void load(istream&);
+    virtual void sneak(istream&);
+    virtual void load_lookahead();
+    void sneak_row(ix_type);
+    const char* cell(const column_type&,ix_type,bool&) const;
+protected:
+    vector<char> m_buffer; ///< Spaltendaten der gesamten Datei
+    column_list m_columns; ///< angemeldete Felder mit ihrer Spalte
+    const column_type *mp_key_column,*mp_ref_column;
+    ix_type m_rows; ///< Anzahl der Records in der Datei
+    ix_type m_row; ///< naechste zu lesende Zeile
+    bool m_ahead; ///< Zeile im lookahead noch nicht ausgewertet
+};
+
 template <class T>
 class File
     : public T
@@ -236,6 +419,9 @@ public:
     virtual bool init();
     virtual void setpos(const marker_type&);
 //    virtual void rename(const string& a_name) { m_filename=a_name; }
+protected:
+    virtual const string& path() { return m_fname; }
+    virtual bool reposition(streampos);
 protected:
     string m_fname;
 };
@@ -246,46 +432,397 @@ typedef File<CSV_Reader> CSV_File_Reader;
 typedef File<CSV_Writer> CSV_File_Writer;
 typedef File<TAB_Reader> TAB_File_Reader;
 typedef File<TAB_Writer> TAB_File_Writer;
+typedef File<COL_Reader> COL_File_Reader;
+typedef File<COL_Writer> COL_File_Writer;
+
+/** Lesen aus einer in den Speicher eingeblendeten Datei (mmap). Die
+    Records werden direkt als Zeigerbereiche im eingeblendeten
+    Dateiinhalt gesucht, ohne Umweg ueber IOBase::m_lookahead. Die
+    Positionen in marker_type sind einfache Byte-Offsets vom
+    Dateianfang. Auswahl ueber den Tabellen-Modifier \c :m. */
+
+template <class T>
+class Mapped
+    : public T /* T muss ein Reader sein! */
+{
+public:
+    Mapped(Context*,index_type*,index_type*,index_type*,index_type*);
+    virtual ~Mapped();
+    virtual bool init();
+    virtual void setpos(const marker_type&);
+protected:
+    virtual bool fetch();
+    virtual void load_lookahead();
+    virtual const string& path() { return m_fname; }
+    virtual bool reposition(streampos);
+    void unmap();
+protected:
+    string m_fname;
+    char *mp_begin; ///< Anfang des eingeblendeten Dateiinhalts
+    const char *mp_end; ///< Ende des eingeblendeten Dateiinhalts
+    const char *mp_cursor; ///< Leseposition fuer naechstes fetch()
+    const char *mp_ahead_begin; ///< Anfang des Records im lookahead
+    const char *mp_ahead_end; ///< Ende des Records im lookahead
+};
+
+typedef Mapped<TAG_Reader> TAG_Mapped_Reader;
+typedef Mapped<CSV_Reader> CSV_Mapped_Reader;
+typedef Mapped<TAB_Reader> TAB_Mapped_Reader;
+
+#ifdef HAVE_LIBPTHREAD
+/** Lesen mit Vorausschau in einem eigenen Thread. Waehrend die
+    aktuellen Records ausgewertet werden, liest ein Erzeuger-Thread
+    die folgenden Records (als Text, noch nicht ausgewertet) in einen
+    Ringpuffer; read_record() uebernimmt nur noch den naechsten
+    Eintrag. Bei setpos() wird der Thread angehalten, der Ringpuffer
+    verworfen und ab der neuen Position neu gestartet. Auswahl ueber
+    den Tabellen-Modifier \c :p. */
+
+template <class T>
+class Prefetch
+    : public T /* T muss ein File<*_Reader> sein! */
+{
+public:
+    Prefetch(Context*,index_type*,index_type*,index_type*,index_type*);
+    virtual ~Prefetch();
+    virtual void setpos(const marker_type&);
+protected:
+    virtual bool read_record(string&,streampos&);
+    virtual bool reposition(streampos);
+    void start(streampos);
+    void stop();
+    static void* produce(void*);
+protected:
+    /// Eintrag im Ringpuffer
+    struct slot_type
+    {
+	string m_text; ///< Record-Text wie in IOBase::m_lookahead
+	streampos m_loc; ///< Position des Records
+	bool m_valid; ///< false: Dateiende erreicht
+    };
+    vector<slot_type> m_ring; ///< Ringpuffer der vorausgelesenen Records
+    int m_head; ///< naechster zu uebergebender Eintrag
+    int m_count; ///< Anzahl gefuellter Eintraege
+    streampos m_loc; ///< Leseposition des Erzeugers
+    bool m_running; ///< Erzeuger-Thread gestartet
+    bool m_finished; ///< Erzeuger hat das Dateiende erreicht
+    bool m_stop; ///< Anforderung an den Erzeuger, sich zu beenden
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_filled; ///< Signal: neuer Eintrag im Ringpuffer
+    pthread_cond_t m_emptied; ///< Signal: Eintrag wieder frei
+};
+
+typedef Prefetch<TAG_File_Reader> TAG_Prefetch_Reader;
+typedef Prefetch<CSV_File_Reader> CSV_Prefetch_Reader;
+typedef Prefetch<TAB_File_Reader> TAB_Prefetch_Reader;
+
+/** Paralleles Lesen grosser Dateien (fuer BufferedTable). Die Datei
+    wird ab dem Header in Abschnitte fester Groesse geteilt, die
+    Abschnittsgrenzen auf Zeilenanfaenge verschoben. Mehrere
+    Worker-Threads (einer je Prozessor) zerlegen je einen Abschnitt auf
+    einem eigenen Strom mit scan_record() in Records und, bei Lesern
+    mit Parse-Plan (CSV, TAB), mit predecode() in Spalten samt den
+    dekodierten Zahlen; read_record() reicht die Records der
+    Abschnitte in Dateireihenfolge weiter. Nur das Zuweisen an die
+    Felder (und sneak(), Domains, Strings) bleibt im aufrufenden
+    Thread, da die Felder in gemeinsame Repositories schreiben.
+
+    Ein Abschnitt gilt nur, wenn sein erster Record genau dort liegt,
+    wo der Vorgaenger-Abschnitt den naechsten Record gefunden hat (bei
+    DDL kann eine Zeile mit m_recbegin auch innerhalb eines Records
+    liegen). Andernfalls, und nach jedem setpos(), wird sequentiell
+    mit T::read_record() weitergelesen. */
+
+template <class T>
+class Chunked
+    : public T /* T muss ein File<*_Reader> sein! */
+{
+public:
+    Chunked(Context*,index_type*,index_type*,index_type*,index_type*);
+    virtual ~Chunked();
+    virtual void setpos(const marker_type&);
+protected:
+    virtual bool read_record(string&,streampos&);
+    virtual bool reposition(streampos);
+    void start(streampos);
+    void stop();
+    bool sequential(streampos);
+    streampos boundary(istream&,long) const;
+    void scan_chunk(istream&,long);
+    static void* work(void*);
+    virtual void load_lookahead();
+protected:
+    /// ein Abschnitt der Datei
+    struct chunk_type
+    {
+	vector<string> m_text; ///< Record-Texte
+	vector<streampos> m_loc; ///< Positionen der Records
+	vector<predecoded_type> m_values; ///< vorab dekodierte Spalten der Records
+	streampos m_first; ///< Position des ersten Records (-1: Dateiende)
+	streampos m_next; ///< erster Record hinter dem Abschnitt (-1: Dateiende)
+	bool m_ready; ///< Abschnitt fertig zerlegt
+	chunk_type() : m_ready(false) {}
+    };
+    vector<chunk_type> m_window; ///< Abschnitt i liegt in m_window[i%size]
+    vector<pthread_t> m_workers;
+    streampos m_start; ///< Position des ersten Records
+    long m_chunk_size; ///< Groesse eines Abschnitts (Bytes, siehe DAL_CHUNK_BYTES)
+    long m_chunks; ///< Anzahl der Abschnitte
+    long m_assign; ///< naechster an einen Worker zu vergebender Abschnitt
+    long m_consume; ///< Abschnitt, aus dem read_record() liest
+    size_t m_pos; ///< naechster Record in m_consume
+    predecoded_type m_ahead_values; ///< Spalten des Records im lookahead
+    bool m_ahead_valid; ///< m_ahead_values gehoert zum lookahead
+    bool m_running; ///< Worker gestartet
+    bool m_sequential; ///< Worker beendet, T::read_record() liest weiter
+    bool m_stop; ///< Anforderung an die Worker, sich zu beenden
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_filled; ///< Signal: Abschnitt fertig
+    pthread_cond_t m_emptied; ///< Signal: Platz im Fenster frei
+};
+
+typedef Chunked<TAG_File_Reader> TAG_Chunked_Reader;
+typedef Chunked<CSV_File_Reader> CSV_Chunked_Reader;
+typedef Chunked<TAB_File_Reader> TAB_Chunked_Reader;
+#endif
+
+/** Ausgabepuffer fuer Dateien, der die Daten blockweise
+    weitergibt. Geschrieben wird in einen von zwei grossen Puffern;
+    ist er voll (oder wird submit() bzw. flush() aufgerufen), geht er
+    an einen Schreib-Thread, waehrend der andere Puffer weiter
+    gefuellt wird. Ohne pthreads wird der volle Puffer direkt
+    geschrieben. tellp() liefert die Position ohne zu schreiben, ein
+    seekp() wartet, bis alle Puffer geschrieben sind. 
+
+    Endet der Dateiname auf \c .gz, wird (im Schreib-Thread) mit
+    gzip komprimiert. Positionen beziehen sich dann auf die
+    unkomprimierten Daten, und es kann nur fortlaufend geschrieben
+    werden (seekp() nur auf die aktuelle Position). */
+
+class AsyncFileBuffer
+    : public streambuf
+{
+public:
+    AsyncFileBuffer(size_t = 1<<20);
+    virtual ~AsyncFileBuffer();
+    AsyncFileBuffer* open(const char*);
+    AsyncFileBuffer* close();
+    inline bool is_open() const { return (m_fd>=0); }
+    void submit();
+    void wait();
+protected:
+    virtual int overflow(int = EOF);
+    virtual int sync();
+    virtual streampos seekoff(streamoff,ios::seekdir,ios::openmode);
+    virtual streampos seekpos(streampos,ios::openmode);
+    void write_block(const char*,size_t);
+    void set_error();
+    bool failed();
+#ifdef HAVE_LIBPTHREAD
+    static void* consume(void*);
+#endif
+private:
+    int m_fd; ///< Dateideskriptor (-1: nicht geoeffnet)
+    size_t m_size; ///< Groesse jedes der beiden Puffer
+    char *mp_buffer[2];
+    int m_active; ///< Puffer, der gerade gefuellt wird
+    streamoff m_offset; ///< Dateiposition des Anfangs von mp_buffer[m_active]
+    bool m_error; ///< Fehler beim Schreiben aufgetreten (nur ueber m_mutex)
+#ifdef HAVE_LIBZ
+    gzFile m_gz; ///< komprimierte Ausgabe (oder NULL)
+#endif
+#ifdef HAVE_LIBPTHREAD
+    bool m_pending; ///< Puffer mp_buffer[1-m_active] wartet auf Ausgabe
+    size_t m_pending_size;
+    bool m_stop;
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work; ///< Signal: Puffer zum Schreiben uebergeben
+    pthread_cond_t m_done; ///< Signal: Puffer geschrieben
+#endif
+};
+
+/** ostream auf einem AsyncFileBuffer, Ersatz fuer ofstream in
+    Buffered<T>. */
+
+class AsyncFileStream
+    : public ostream
+{
+public:
+    AsyncFileStream() : ostream(&m_buffer) {}
+    void open(const char*,ios::openmode = ios::out);
+    void close();
+    inline bool is_open() const { return m_buffer.is_open(); }
+private:
+    AsyncFileBuffer m_buffer;
+};
+
+/** Gepufferte Ausgabe: Records werden nicht einzeln geflusht,
+    sondern in grossen Bloecken (ggf. von einem eigenen Thread)
+    geschrieben. Ausgegeben wird beim Schliessen, wenn ein Puffer
+    voll ist oder bei Writer::submit(). Auswahl ueber den
+    Tabellen-Modifier \c :b. */
+
+template <class T>
+class Buffered
+    : public T /* T muss ein *_Writer sein! */
+{
+public:
+    typedef AsyncFileStream file_type;
+
+public:
+    Buffered(Context*,index_type*,index_type*,index_type*,index_type*,ostream*);
+protected:
+    virtual void end_record() {}
+    
+    inline void open_file_stream(const char* p) 
+	{ dynamic_cast<file_type*>(mp_stream)->open(p,ios::out); }
+    inline void close_file_stream()
+	{ (*mp_stream) << endl; dynamic_cast<file_type*>(mp_stream)->close(); }
+};
+
+typedef File< Buffered<TAG_Writer> > TAG_Buffered_Writer;
+typedef File< Buffered<CSV_Writer> > CSV_Buffered_Writer;
+typedef File< Buffered<TAB_Writer> > TAB_Buffered_Writer;
+
+#ifdef HAVE_LIBZ
+/** Eingabepuffer fuer gzip-komprimierte Dateien. Wie beim
+    AsyncFileBuffer gibt es zwei grosse Puffer: waehrend aus dem einen
+    gelesen wird, entpackt ein eigener Thread (ohne pthreads: erst bei
+    Bedarf) den naechsten Block in den anderen. 
+
+    Positionen (tellg/seekg) sind Offsets in den unkomprimierten
+    Daten, marker_type bleibt daher gueltig. Ein seekg() innerhalb des
+    aktuellen Blocks kostet nichts, sonst wird mit gzseek()
+    positioniert (rueckwaerts heisst das: erneutes Entpacken ab
+    Dateianfang bis zur Zielposition). Vor jedem Block bleiben die
+    letzten g_gz_putback Zeichen des vorigen Blocks fuer putback()
+    erhalten. */
+
+class GzFileBuffer
+    : public streambuf
+{
+public:
+    GzFileBuffer(size_t = 1<<20);
+    virtual ~GzFileBuffer();
+    GzFileBuffer* open(const char*);
+    GzFileBuffer* close();
+    inline bool is_open() const { return (m_gz!=NULL); }
+protected:
+    virtual int underflow();
+    virtual streampos seekoff(streamoff,ios::seekdir,ios::openmode);
+    virtual streampos seekpos(streampos,ios::openmode);
+    size_t read_block(char*);
+    void start();
+    void stop();
+#ifdef HAVE_LIBPTHREAD
+    static void* produce(void*);
+#endif
+private:
+    gzFile m_gz; ///< geoeffnete Datei (NULL: nicht geoeffnet)
+    size_t m_size; ///< Nutzgroesse jedes der beiden Puffer
+    char *mp_buffer[2];
+    int m_active; ///< Puffer, aus dem gerade gelesen wird
+    streamoff m_offset; ///< unkomprimierte Position von eback()
+    bool m_eof; ///< Dateiende erreicht
+#ifdef HAVE_LIBPTHREAD
+    bool m_running; ///< Entpack-Thread gestartet
+    bool m_ready; ///< mp_buffer[1-m_active] enthaelt den naechsten Block
+    size_t m_ready_size;
+    bool m_stop;
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_work; ///< Signal: Puffer wieder frei
+    pthread_cond_t m_done; ///< Signal: Block entpackt
+#endif
+};
+
+/** istream auf einem GzFileBuffer, Ersatz fuer ifstream in
+    Compressed<T>. */
+
+class GzFileStream
+    : public istream
+{
+public:
+    GzFileStream() : istream(&m_buffer) {}
+    void open(const char*,ios::openmode = ios::in);
+    void close();
+    inline bool is_open() const { return m_buffer.is_open(); }
+private:
+    GzFileBuffer m_buffer;
+};
+
+/** Lesen aus gzip-komprimierten Dateien (Endung \c .gz, z.B. \c
+    data.csv.gz). Geschrieben werden komprimierte Dateien ueber
+    Buffered<T> (siehe AsyncFileBuffer). */
+
+template <class T>
+class Compressed
+    : public T /* T muss ein *_Reader sein! */
+{
+public:
+    typedef GzFileStream file_type;
+
+public:
+    Compressed(Context*,index_type*,index_type*,index_type*,index_type*,istream*);
+protected:
+    inline void open_file_stream(const char* p) 
+	{ dynamic_cast<file_type*>(mp_stream)->open(p,ios::in); }
+    inline void close_file_stream()
+	{ dynamic_cast<file_type*>(mp_stream)->close(); }
+};
+
+typedef File< Compressed<TAG_Reader> > TAG_Compressed_Reader;
+typedef File< Compressed<CSV_Reader> > CSV_Compressed_Reader;
+typedef File< Compressed<TAB_Reader> > TAB_Compressed_Reader;
+#endif
 
 /** Diese Klasse erweitert die *_Reader Klassen um die
     Moeglichkeit mehrere Dateien nacheinander einzulesen, als wenn sie
-    eine einzige Datei waeren. Die angegebene Datei wird wortweise
-    ausgelesen, jedes Wort als Filename interpretiert und eine
-    *_Reader des Template-Typs T instanziiert. Beginnend mit dem
-    aktuelle Reader schalten wir am Dateiende auf den naechsten
-    Reader, Dateiende wird mit Dateiende der letzten Datei
-    gemeldet. */
-#ifdef XXX
-
- BAUSTELLE: muss fetch+load etc. implementieren, damit Vorausschau auf naechsten Eintrag (ggf. in anderer Datei) moeglich.
+    eine einzige Datei waeren. Die angegebene Datei (Endung \c .lst)
+    wird wortweise ausgelesen, jedes Wort als Filename interpretiert
+    (relativ zum Verzeichnis der Liste). Am Dateiende wird in
+    read_record() auf die naechste Datei umgeschaltet, so dass die
+    Vorausschau (fetch) ueber Dateigrenzen hinweg funktioniert;
+    Dateiende wird mit Dateiende der letzten Datei gemeldet. Alle
+    Dateien muessen denselben Header haben (wie die erste Datei). 
+
+    In marker_type::m_file steht der Index der Datei, m_spos ist die
+    Position innerhalb dieser Datei. Waehrend eine Datei gelesen wird,
+    ist die naechste bereits geoeffnet und ihr Inhalt beim
+    Betriebssystem zum Vorauslesen angemeldet. */
 
 template <class T>
 class File_List
-  : public T /* T muss ein Reader sein! */
-  {
-  public:
+    : public T /* T muss ein TAG/CSV/TAB_Reader sein! */
+{
+public:
     File_List(Context*,index_type*,index_type*,index_type*,index_type*);
     virtual ~File_List();
-    virtual void attach(abstract_data_type*);
     virtual bool init();
-    virtual bool operate();
     virtual void getpos(marker_type&);
     virtual void setpos(const marker_type&);
-  protected:
-    string_type m_filename;
-    list<string> m_filenames;
-    list<string>::iterator mi_file;
-    adtp_list m_indirect_fields;
-    bool m_delayed_reset;
-    marker_type m_delayed_pos;
-    int m_curr_file;
-    Reader *mp_reader;
-  };
-
-typedef File_List<TAG_File_Reader> TAG_File_List_Reader;
-typedef File_List<CSV_File_Reader> CSV_File_List_Reader;
-typedef File_List<TAB_File_Reader> TAB_File_List_Reader;
-#endif
+protected:
+    virtual bool read_record(string&,streampos&);
+    virtual void load_lookahead();
+    void read_list();
+    void open_shard(int);
+    ifstream* open_file(int,bool);
+protected:
+    vector<string> m_filenames; ///< Dateien in der Reihenfolge der Liste
+    int m_file; ///< Datei, aus der mp_stream gerade liest
+    int m_next_file; ///< Datei des Records im lookahead
+    int m_curr_file; ///< Datei des aktuellen Records
+    ifstream *mp_next; ///< bereits geoeffnete naechste Datei (oder NULL)
+    int m_next_shard; ///< Index von mp_next
+    string m_header; ///< Header der ersten Datei
+    long m_header_size; ///< Laenge des Headers (-1: noch unbekannt)
+};
+
+typedef File_List<TAG_Reader> TAG_File_List_Reader;
+typedef File_List<CSV_Reader> CSV_File_List_Reader;
+typedef File_List<TAB_Reader> TAB_File_List_Reader;
 
 /** Allokation von Readern */
 
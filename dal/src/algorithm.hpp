@@ -11,6 +11,10 @@
 #include "dal.hpp"
 #include "matvecop.hpp"
 #include "ttime.hpp"
+#include "kernel.hpp"
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
 
 using namespace Data_Access_Library;
 namespace Data_Analysis_Library {
@@ -391,6 +395,25 @@ fetch(BaseTable *t,int_type *c)
 
 ////////////////////////////////////////////////////////////////////
 
+class CountRecords
+    : public ReadRecord
+{
+public:
+    inline CountRecords(BaseTable *t,int_type *c) 
+	: ReadRecord(t,c), m_known(false) {}
+
+    virtual void init();
+    virtual term_type step();
+private:
+    bool m_known;
+};
+
+inline CountRecords* 
+count_records(BaseTable *t,int_type *c) 
+{ return new CountRecords(t,c); }
+
+////////////////////////////////////////////////////////////////////
+
 class ReadRecordSubSet
     : public ReadRecord
 {
@@ -424,7 +447,7 @@ public:
     virtual term_type step();
 
 protected:
-    T *mp_table; ///< T must be a BufferedTable<> type
+    T *mp_table; ///< T must be a BufferedTable<> or ColumnTable<> type
 };
 
 template <class T> inline SwapInputOutput<T>*
@@ -440,7 +463,7 @@ public:
     virtual term_type step();
 
 protected:
-    T *mp_table; ///< T must be a BufferedTable<> type
+    T *mp_table; ///< T must be a BufferedTable<> or ColumnTable<> type
 };
 
 template <class T> inline SubmitBuffered<T>*
@@ -489,9 +512,20 @@ private:
     tuple_type *mp_key,*mp_key2;
     Algorithm *mp_iter;
 
-    typedef multimap< tuple_type::value_type, marker_type > index_type;
-    index_type m_index;
-    index_type::const_iterator m_position;
+    typedef tuple_type::value_type key_type;
+
+    /// Compares the keys of two records (by their index in m_keys).
+    struct key_less
+    {
+	const deque< key_type > *mp_keys;
+	inline bool operator()(long a,long b) const
+	    { return (*mp_keys)[a] < (*mp_keys)[b]; }
+    };
+
+    deque< key_type > m_keys; ///< keys in reading order (taken over by swap())
+    vector< marker_type > m_marks; ///< table positions in reading order
+    vector< long > m_order; ///< sorted order (indices in m_keys/m_marks)
+    long m_position;
 };
 
 inline SortedTableIteration*
@@ -748,6 +782,7 @@ public:
     virtual term_type step();
 
 private:
+    Algorithm *mp_succ;
     real_type *mp_dist,*mp_output;
     tuple_type *mp_x,*mp_y;
     bool m_inc;
@@ -769,6 +804,7 @@ public:
     virtual term_type step();
 
 private:
+    Algorithm *mp_succ;
     real_type *mp_dist,*mp_yscale;
     tuple_type *mp_x,*mp_y;
 };
@@ -789,6 +825,7 @@ public:
     virtual term_type step();
 
 private:
+    Algorithm *mp_succ;
     real_type *mp_dist;
     tuple_type *mp_x,*mp_y;
     matrix_type *mp_normmat;
@@ -799,6 +836,152 @@ matdist(real_type *d,tuple_type *x,tuple_type *y,
         matrix_type *nm,Algorithm *p=NULL)
 { return new MahalanobisDistance(d,x,y,nm,p); }
 
+///////////////////////////////////////////////////////////////////
+
+template <class T>
+class NearestNeighbour
+    : public Algorithm
+{
+public:
+    inline NearestNeighbour(BaseTable *t,tuple_type *tv,const T *tl,
+			    tuple_type *x,real_type *d,T *retval,
+			    bool scaled,Algorithm *f,
+			    int_type *k=NULL,int_type *w=NULL,int_type *r=NULL,
+			    int_type *b=NULL)
+	: mp_filtered(f), mp_table(t), mp_trainvalue(tv), mp_trainlabel(tl)
+	, mp_x(x), mp_dist(d), mp_return_value(retval), m_scaled(scaled)
+	, mp_k(k), mp_weighted(w), mp_reorder(r), mp_blockwise(b)
+	, m_k(1), m_weighted(false)
+	, m_reorder(true), m_blockwise(false) {}
+
+    virtual void init();
+    virtual term_type step();
+    virtual void done();
+
+protected:
+    /// neighbour: distance and record number
+    typedef pair<double,int> neighbour_type;
+
+    /// node of the k-d tree, leaf if m_axis<0
+    struct node_type
+    {
+	int m_axis;
+	double m_split;
+	int m_first,m_last; ///< points [m_first,m_last) of a leaf
+	int m_left,m_right; ///< children of an inner node
+    };
+
+    void build();
+    int build(vector<int>&,int,int);
+    void reorder();
+    void search(int,const double*,double,vector<neighbour_type>&) const;
+    int classify(const tuple_type::value_type&,double&) const;
+    void classify(const tuple_type::value_type*,int,int*,double*) const;
+    int vote(const vector<neighbour_type>&,double,double&) const;
+
+    Algorithm *mp_filtered;
+    BaseTable *mp_table;
+    tuple_type *mp_trainvalue;
+    const T *mp_trainlabel;
+    tuple_type *mp_x;
+    real_type *mp_dist;
+    T *mp_return_value;
+    bool m_scaled;
+    int_type *mp_k,*mp_weighted,*mp_reorder,*mp_blockwise;
+    int m_k; ///< number of neighbours
+    bool m_weighted; ///< vote weighted by inverse squared distance
+    bool m_reorder; ///< coordinates ordered by variance
+
+    int m_dim; ///< dimension of training vectors
+    vector<int> m_order; ///< coordinate order of m_points (empty: original)
+    vector<double> m_points; ///< training vectors in tree order
+    vector<int> m_record; ///< record number of each point
+    vector<typename T::value_type> m_labels; ///< label of each record
+    vector<node_type> m_nodes;
+
+    bool m_blockwise; ///< block queries without tree (high dimension)
+    vector<double> m_mean; ///< mean of training vectors
+    vector<double> m_centered; ///< m_points minus m_mean
+    vector<double> m_centered_norm; ///< squared norms of m_centered
+};
+
+template <class T>
+inline NearestNeighbour<T>*
+nearest(BaseTable *t,tuple_type *tv,const T *tl,tuple_type *x,
+	real_type *d,T *retval,Algorithm *f,int_type *k=NULL,int_type *w=NULL,
+	int_type *r=NULL,int_type *b=NULL)
+  { return new NearestNeighbour<T>(t,tv,tl,x,d,retval,false,f,k,w,r,b); }
+
+template <class T>
+inline NearestNeighbour<T>*
+snearest(BaseTable *t,tuple_type *tv,const T *tl,tuple_type *x,
+	 real_type *d,T *retval,Algorithm *f,int_type *k=NULL,int_type *w=NULL,
+	 int_type *r=NULL)
+  { return new NearestNeighbour<T>(t,tv,tl,x,d,retval,true,f,k,w,r); }
+
+///////////////////////////////////////////////////////////////////
+
+template <class T>
+class BlockNearestNeighbour
+    : public NearestNeighbour<T>
+{
+public:
+    BlockNearestNeighbour(BaseTable *data,BaseTable *t,tuple_type *tv,
+			  const T *tl,tuple_type *x,real_type *d,
+			  T *retval,bool scaled,Algorithm *f,
+			  int_type *k,int_type *w,int_type *th,
+			  int_type *r,int_type *bs,int_type *b);
+    virtual ~BlockNearestNeighbour();
+
+    virtual void init();
+    virtual Algorithm::term_type step();
+    virtual void done();
+
+private:
+    void classify_slice(int,int);
+    void start();
+    void stop();
+    static void* work(void*);
+
+    BaseTable *mp_data;
+    int_type *mp_threads,*mp_blocksize;
+    int m_threads; ///< number of threads
+    int m_blocksize; ///< records per thread and block
+
+    vector<tuple_type::value_type> m_query; ///< query vectors of block
+    vector<ix_type> m_held; ///< query records of block (see BaseTable::hold())
+    vector<int> m_result; ///< record number of predicted label
+    vector<double> m_resultdist;
+
+#ifdef HAVE_LIBPTHREAD
+    /// worker thread, classifies slice m_slice of each block
+    struct worker_type
+    {
+	BlockNearestNeighbour<T> *mp_this;
+	int m_slice;
+	long m_block; ///< last block seen
+    };
+    vector<pthread_t> m_workers; ///< threads 1..m_threads-1 (0: step())
+    vector<worker_type> m_worker;
+    vector<int> m_bounds; ///< slice t is [m_bounds[t],m_bounds[t+1])
+    long m_block; ///< number of blocks handed to the workers
+    int m_busy; ///< workers still classifying the current block
+    bool m_stop; ///< request to the workers to terminate
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_started; ///< signal: new block (or m_stop)
+    pthread_cond_t m_finished; ///< signal: m_busy reached 0
+#endif
+};
+
+template <class T>
+inline BlockNearestNeighbour<T>*
+knearest(BaseTable *data,BaseTable *t,tuple_type *tv,const T *tl,
+	 tuple_type *x,real_type *d,T *retval,int_type *k,int_type *w,
+	 int_type *th,Algorithm *f,bool scaled=false,int_type *r=NULL,
+	 int_type *bs=NULL,int_type *b=NULL)
+  { return new BlockNearestNeighbour<T>(data,t,tv,tl,x,d,retval,scaled,
+					f,k,w,th,r,bs,b); }
+
 }; // namespace
 
 #endif // ALGORITHM_HEADER
@@ -123,6 +123,35 @@ namespace Data_Access_Library {
 
     Indicates whether this SETORRECORD is an SubSetTable or not. */
 
+/** \var Context::mode_type Context::PREFETCH
+
+    Flag is set if the input file of the table shall be read ahead by
+    a separate thread (table modifier \c :p). */
+
+/** \var Context::mode_type Context::BUFFERED
+
+    Flag is set if the output file of the table shall be written in
+    large blocks, without flushing the stream after each record (table
+    modifier \c :b). */
+
+/** \var Context::mode_type Context::INDEXED
+
+    Flag is set if the record positions of the input file(s) of the
+    table shall be kept in an index file (\c .idx) next to the input
+    file (table modifier \c :x). */
+
+/** \var Context::mode_type Context::BULKREAD
+
+    Flag is set by BufferedTable while it loads its complete input
+    file; large files are then split into records by several threads
+    (see Chunked<T>). */
+
+/** \var Context::mode_type Context::LAZY
+
+    Flag is set if the readers of the table shall only keep the input
+    text of the fields and decode a field on its first access (table
+    modifier \c :l, see abstract_data_type::defer()). */
+
 /** Context Constructor. */ 
 
 Context::Context( 
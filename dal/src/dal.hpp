@@ -34,7 +34,10 @@
 #include "stlstream.hpp"
 #include "table.hpp"
 #include <deque>
+#include <vector>
 #include <list>
+#include <stdio.h> // FILE
+#include <signal.h> // sig_atomic_t
 
 using namespace logtrace;
 namespace Data_Access_Library {
@@ -67,19 +70,38 @@ typedef word ix_type;
 
 extern ix_type g_illegal_ix;
 
+/** g_column_ix
+
+    g_column_ix kennzeichnet ein Feld, dessen Wert nicht im
+    Repository, sondern in einer Spalte einer ColumnTable liegt
+    (siehe column_type). [datarep.cpp] */
+
+extern ix_type g_column_ix;
+
 /** ix_tuple_type
 
     Typ fuer ein Tuple aus Indizes. */
 
 typedef DynTuple<ix_type> ix_tuple_type;
     
+/** Domain
+
+    Label einer Domain werden einmal in m_words abgelegt (interniert).
+    Die Suche nach einem Label (auch direkt ueber Zeiger und Laenge
+    aus einem Lesepuffer, ohne string zu erzeugen) geht ueber eine
+    Hash-Tabelle mit offener Adressierung, die Suche nach dem Label zu
+    einem Wert ueber einen Vektor (Werte, die mit add(label) vergeben
+    werden, sind fortlaufend ab 0). Die alphabetische Ordnung (fuer
+    Iteration und reassign_indices()) haelt m_str2idx. [domain.cpp] */
+
 class Domain
 {
 public:
     Domain();
     Domain(const string&,bool mixedmode=true);
     void clear();
-    bool find(const string&,int&);
+    bool find(const string&,int&) const;
+    bool find(const char*,int,int&) const;
     bool find(istream&,int&);
     int add(const string&);
     void add(const string&,int value);
@@ -93,18 +115,35 @@ public:
     int precision() const { return m_precision; }
     int& precision() { return m_precision; }
     bool mixed_mode() const { return m_mixed_mode; }
+    bool numeric_labels() const { return (m_numeric_labels>0); }
     
 private:
+    /// Eintrag der Hash-Tabelle
+    struct slot_type
+    {
+	string const *mp_label; ///< Label (in m_words), NULL: leer
+	int *mp_value; ///< Wert (in m_str2idx)
+	unsigned int m_hash;
+    };
     //typedef map< string const*, int, less_dereference<string const*> > str2idx_type;
     typedef map< int, string const* > idx2str_type;
-    typedef list<string> strlist_type;
+    typedef deque<string> strlist_type;
+    
+    int probe(const char*,int,unsigned int) const;
+    void insert(string const*);
+    void rehash(int);
+    void set_identifier(int,string const*);
+    
     str2idx_type m_str2idx;
-    idx2str_type m_idx2str;
+    vector<slot_type> m_slots; ///< Hash-Tabelle (Groesse Zweierpotenz)
+    vector<string const*> m_idx2str; ///< Label zu Werten 0..
+    idx2str_type m_sparse; ///< Label zu sonstigen Werten (z.B. Zeiger)
     strlist_type m_words;
     int m_size,m_next;
     bool m_fixed_values;
     int m_precision;
     bool m_mixed_mode; ///< mixed numerical and symbolic values
+    int m_numeric_labels; ///< number of labels starting like a number
     
 public:
     typedef str2idx_type::const_iterator const_iterator;
@@ -140,6 +179,7 @@ public:
 
 private:
     Domain *mp_domain;
+    mutable string m_word; ///< Lesepuffer fuer Label
 };
 
 class Context
@@ -151,9 +191,11 @@ public:
     enum mode_type { VOID=0, INITIALIZED=(1<<0), SUBSETOUT=(1<<1), 
 		     ENDOFDATA=(1<<2), READOUT=(1<<3), WRITEBACK=(1<<4), 
 		     SHARED=(1<<5), DELAYED=(1<<6), 
-		     DYNALLOC=(1<<7), MULTITABLE=(1<<8), 
+		     DYNALLOC=(1<<7), MULTITABLE=(1<<8), MAPPED=(1<<9),
 		     ORDERED=(1<<10), DETAIL=(1<<11), FLAT=(1<<12), 
-		     KEYREF=(1<<13), HIERTABLE=(1<<14), SUBSETTABLE=(1<<15)
+		     KEYREF=(1<<13), HIERTABLE=(1<<14), SUBSETTABLE=(1<<15),
+		     PREFETCH=(1<<16), BUFFERED=(1<<17), INDEXED=(1<<18),
+		     BULKREAD=(1<<19), LAZY=(1<<20)
     };
 
     Context(context_type ct,int mode,const string& name,
@@ -177,6 +219,12 @@ public:
     inline bool is_detail() const { return (!is_field())&&IS_TAG(m_mode,DETAIL); }
     inline bool is_ordered() const { return IS_TAG(m_mode,ORDERED); }
     inline bool is_multitable() const { return IS_TAG(m_mode,MULTITABLE); }
+    inline bool is_mapped() const { return IS_TAG(m_mode,MAPPED); }
+    inline bool is_prefetch() const { return IS_TAG(m_mode,PREFETCH); }
+    inline bool is_buffered() const { return IS_TAG(m_mode,BUFFERED); }
+    inline bool is_indexed() const { return IS_TAG(m_mode,INDEXED); }
+    inline bool is_bulkread() const { return IS_TAG(m_mode,BULKREAD); }
+    inline bool is_lazy() const { return IS_TAG(m_mode,LAZY); }
     inline bool is_flat() const { return IS_TAG(m_mode,FLAT); }
     inline bool is_keyref() const { return IS_TAG(m_mode,KEYREF); }
     inline bool is_subsettable() const { return IS_TAG(m_mode,SUBSETTABLE); }
@@ -244,6 +292,12 @@ ostream& operator<<(ostream&,const Context&);
 #define cORDERED Context::ORDERED
 #define cSHARED Context::SHARED
 #define cMULTITABLE Context::MULTITABLE
+#define cMAPPED Context::MAPPED
+#define cPREFETCH Context::PREFETCH
+#define cBUFFERED Context::BUFFERED
+#define cINDEXED Context::INDEXED
+#define cBULKREAD Context::BULKREAD
+#define cLAZY Context::LAZY
 #define cFLAT Context::FLAT
 #define cKEYREF Context::KEYREF
 #define cVOID Context::VOID
@@ -252,33 +306,127 @@ template <class T>
 class Repository
 {
 public:
-    typedef typename deque<T>::const_iterator const_iterator;
-    
-    explicit Repository() : next_element(0) {}
+    explicit Repository() 
+	: next_element(0), m_free(g_illegal_ix), m_free_count(0)
+	, m_peak(0), m_inserts(0) {}
     
     ix_type insert(const T& a_value);
     ix_type insert();
     
-    inline const T& operator[](ix_type a_no) const { return elements[a_no]; }
-    inline T& operator[](ix_type a_no) { return elements[a_no]; }
+    inline const T& operator[](ix_type a_no) const { return elements[a_no].m_value; }
+    inline T& operator[](ix_type a_no) { return elements[a_no].m_value; }
     
-    inline void free(ix_type a_no) { m_free.push_back(a_no); }
+    /** Referenz freigeben, der Eintrag wird erst frei, wenn keine
+	Referenz mehr besteht. */
+    inline void free(ix_type a_no) 
+	{ 
+	    slot_type& s = elements[a_no];
+	    INVARIANT(s.m_refs>0,"entry "<<a_no<<" freed twice");
+	    if (--s.m_refs>0) return;
+	    s.m_next=m_free; m_free=a_no; ++m_free_count; 
+	}
+    /// weitere Referenz auf einen Eintrag (siehe data_type<T>::share())
+    inline void ref(ix_type a_no) { ++elements[a_no].m_refs; }
+    inline int refs(ix_type a_no) const { return elements[a_no].m_refs; }
     
     void info(ostream& os) const;
     void mem_info(ostream& os) const;
-    inline const_iterator begin() const { return elements.begin(); }
-    inline const_iterator end() const { return elements.end(); }
+    void metrics(ostream& os) const;
+
+private:
+    /// Statistik nach jedem insert() (siehe metrics())
+    inline void inserted()
+	{ 
+	    ++m_inserts; 
+	    if (next_element-m_free_count>m_peak) m_peak=next_element-m_free_count; 
+	}
 
 private:
-    deque<T> elements;
+    /// Eintrag, freie Eintraege sind ueber m_next verkettet
+    struct slot_type 
+    { 
+	T m_value; 
+	ix_type m_next; 
+	int m_refs; ///< Anzahl der Referenzen (0: frei)
+    };
+    deque<slot_type> elements;
     ix_type next_element;
-    list<ix_type> m_free;
+    ix_type m_free; ///< erster freier Eintrag (g_illegal_ix: keiner)
+    ix_type m_free_count; ///< Anzahl freier Eintraege
+    ix_type m_peak; ///< Hoechststand belegter Eintraege
+    long m_inserts; ///< Anzahl insert() insgesamt
 };
 
 template <class T>
 inline ostream& operator<<(ostream& os,const Repository<T>& a_rep)
   { a_rep.info(os); return os; }
 
+/** RepositoryContext
+
+    Satz von Repositories (je eines pro Datentyp T, mit eigenem
+    globalen Default-Wert). Jedes Feld haengt an dem RepositoryContext,
+    der bei seiner Erzeugung aktuell war (bzw. an dem seiner
+    Tabelle). Ohne weiteres Zutun ist das der globale Context, es
+    verhaelt sich also alles wie bisher. Eine Pipeline, die in einem
+    eigenen Thread laeuft, legt einen eigenen RepositoryContext an und
+    setzt ihn mit set_current() bevor sie ihre Tabellen erzeugt; die
+    Repositories werden dann nicht mit anderen Threads geteilt und
+    muessen nicht gesperrt werden. Der Context muss laenger leben als
+    alle Felder, die ihn benutzen. Die Repositories fuer T werden beim
+    ersten Zugriff angelegt, der Default-Wert wird dabei aus dem
+    globalen Context uebernommen. Slots und Eintraege werden unter
+    einem Lock vergeben, gesucht und angelegt (nur beim Erzeugen eines
+    Feldes); die Repositories selbst werden ohne Lock benutzt.
+
+    Weiterhin prozessweit geteilt bleiben: die Domains (Labels, auch
+    die Tabellennamen in gp_dm_tables) ohne Lock, sie muessen vor dem
+    Start der Threads gefuellt sein (Tabellen und Felder also im
+    Hauptthread anlegen); Metrics (unter einem Mutex); die
+    Log-/Trace-Ausgabe (LOGTRACE_INIT, TRACE, INFO), deren Zeilen sich
+    zwischen Threads mischen koennen; die gemeinsamen Freilisten des
+    Slab-Speichers (unter einem Mutex, siehe slab_trim()). Geprueft
+    wird der Betrieb mehrerer Pipelines von "selftest pipelines". */
+
+class RepositoryContext
+{
+public:
+    /// Repository eines Datentyps im Context
+    struct entry_type
+    {
+	void *mp_repository; ///< Repository<T>*
+	ix_type m_default_ix; ///< Index des globalen Default-Wertes
+	void (*mp_destroy)(void*); ///< Repository<T> loeschen
+    };
+    /// Initialisierung eines neuen Eintrags (siehe data_type<T>::entry())
+    typedef void (*init_type)(entry_type&,RepositoryContext*);
+    
+    enum { max_slots = 32 }; ///< maximale Anzahl Datentypen
+    
+    explicit RepositoryContext();
+    ~RepositoryContext();
+    
+    /// Vorhandener Eintrag (nur unter dem Lock, d.h. in init_type)
+    inline entry_type* find(int a_slot) const { return mp_entries[a_slot]; }
+    entry_type& insert(int& a_slot,init_type);
+    
+    static RepositoryContext* global();
+    static RepositoryContext* current();
+    static void set_current(RepositoryContext*);
+
+private:
+    RepositoryContext(const RepositoryContext&); // CC not defined
+    entry_type& create(int a_slot,init_type);
+    entry_type *mp_entries[max_slots]; ///< Eintraege, Index: Slot des Datentyps
+};
+
+/** Umsetzung von Label-Werten einer fremden Domain-Numerierung auf
+    die eigene (beim Einlesen des Binaerformats, siehe COL_Reader). */
+
+typedef map<int,int> label_map_type;
+
+class abstract_column;
+template <class T> class column_type;
+
 /** abstract_data_type 
 
     Diese Klasse definiert einen abstrakten Datentyp. In der
@@ -299,19 +447,23 @@ class abstract_data_type
     friend class BaseTable;
     
 public:
-    explicit abstract_data_type(Context*); 
+    explicit abstract_data_type(Context*,RepositoryContext* = NULL); 
     virtual ~abstract_data_type() {}
     abstract_data_type(const abstract_data_type&); // CC not defined
     
     virtual void read(istream& is,const matrix_separators* = NULL); 
     virtual void read(istream& is,int,const matrix_separators* = NULL);
     virtual void write(ostream& os,const matrix_separators* = NULL) const;
+    virtual string binary_kind() const;
+    virtual void write_binary(string&) const;
+    virtual const char* read_binary(const char*,const label_map_type* = NULL);
     virtual void info(ostream& os) const = 0;
     virtual int size() const = 0; ///< Anzahl der Felder in einer Tabelle
     virtual bool is_default() const = 0; //{ DO_NOT_PASS; return true; }
     virtual void load_default() = 0;
     virtual void copy_default() = 0;
     virtual void set_context_default(const string&,const matrix_separators* = NULL) = 0;
+    virtual abstract_column* new_column() const = 0; ///< Leere Spalte fuer diesen Typ
     
     inline bool is_readout() const { return IS_TAG(mp_context->mode(),Context::READOUT); }
     inline bool is_writeback() const { return IS_TAG(mp_context->mode(),Context::WRITEBACK); }
@@ -320,18 +472,34 @@ public:
     inline Context const * context() const { return mp_context; }
     inline Context* context() { return mp_context; }
     inline Context::context_type type() const { return mp_context->type(); }
-    inline ix_type get_ix() const { return m_ix; } ///< Repository-Index zurueckgeben
+    inline ix_type get_ix() const { decode(); return m_ix; } ///< Repository-Index zurueckgeben
+    inline RepositoryContext* repositories() const { return mp_repositories; }
+    void defer(const string&,const matrix_separators*,int = -1);
+    inline bool is_deferred() const { return (mp_rawsep!=NULL); }
+    
+protected:
+    /// Verzoegert gelesenen Wert (siehe defer()) jetzt dekodieren
+    inline void decode() const { if (mp_rawsep!=NULL) decode_raw(); }
+    /// Verzoegert gelesenen Wert verwerfen (Feld erhaelt anderen Wert)
+    inline void discard() { mp_rawsep=NULL; }
+    void decode_raw() const;
     
 protected:
     virtual void load(ix_type) = 0; ///< Variable mit Wert aus Repository laden
     virtual void copy(ix_type) = 0; ///< Variable mit Kopie aus Repository laden
+    virtual void share(ix_type) = 0; ///< Variable mit Wert aus Repository laden, Kopie erst beim Schreiben
     virtual void free() = 0; ///< Variable auf Default setzen, Repository freigeben
     virtual void free(ix_type) = 0; ///< Wert aus Repository freigeben
     virtual ix_type get_default_ix() const = 0; ///< Repository-Index des Default-Wertes liefern
+    virtual void detach() = 0; ///< Wert aus einer Spalte (ColumnTable) ins Repository kopieren
     
 protected:
     Context *mp_context; ///< Context des Feldes (Feldbeschreibung)
+    RepositoryContext *mp_repositories; ///< Repositories, in denen der Wert liegt
     ix_type m_ix; ///< Index auf das Feld im entsprechenden Repository
+    mutable const matrix_separators *mp_rawsep; ///< Separatoren fuer m_raw, NULL: kein Text offen
+    string m_raw; ///< Eingabetext, noch nicht dekodiert (siehe defer())
+    int m_rawrows; ///< Anzahl Werte in m_raw (.tab), -1: read() ohne Anzahl
 };
 
 typedef list< abstract_data_type* > adtp_list;
@@ -350,15 +518,20 @@ template <class T>
 class data_type
     : public abstract_data_type
 {
+    friend class column_type<T>;
+
 public: 
     typedef T value_type;
     
 public: 
-    explicit data_type(Context*);
+    explicit data_type(Context*,RepositoryContext* = NULL);
     ~data_type() { free(); }
     
     virtual void info(ostream& os) const;
-    static void mem_info(ostream& os) { m_repository.mem_info(os); }
+    static void mem_info(ostream& os) 
+	{ repository(RepositoryContext::current()).mem_info(os); }
+    static void metrics(ostream& os) 
+	{ repository(RepositoryContext::current()).metrics(os); }
     
     /** Schreib-Zugriff auf Feld. Bei Schreib-Anforderung neuen Speicher
 	allokieren, wenn bisher nur der Default-Wert geladen war, da wir
@@ -367,11 +540,20 @@ public:
 	benutzt, aber bei Anweisungen wie (x||field()) wird vom Compiler
 	dann die non-const Variante aufgerufen, was zur unnoetigen
 	Allokation von Speicher fuehrt. Daher wird der Schreibzugriff
-	nun explizit durch Aufruf von .set(). */
-    inline T& var() { if (this->is_default()) allocate(); return (*mp_value); }
+	nun explizit durch Aufruf von .set(). Ein Wert in einer Spalte
+	(ColumnTable) oder ein mit share() geteilter Wert wird vor dem
+	Schreiben kopiert. Ein verzoegert gelesener Wert (siehe
+	defer()) wird beim ersten Zugriff dekodiert. */
+    inline T& var() 
+	{ 
+	    decode();
+	    if ((m_ix==g_column_ix)||(this->is_default())||(m_repository.refs(m_ix)>1)) 
+		allocate(); 
+	    return (*mp_value); 
+	}
     /** Lese-Zugriff auf Feld. */
-    inline const T& operator()() const { return (*mp_value); }
-    inline const T& val() const { return (*mp_value); }
+    inline const T& operator()() const { decode(); return (*mp_value); }
+    inline const T& val() const { decode(); return (*mp_value); }
     
     virtual bool is_default() const;
     virtual void load_default();
@@ -379,21 +561,153 @@ public:
     
     static void set_global_default(const T&);
     virtual void set_context_default(const string&,const matrix_separators* = NULL);
+    virtual abstract_column* new_column() const;
     
 protected:
     void allocate(); ///< Ein neues Feld (auch im Repository) anlegen
     virtual void load(ix_type); 
     virtual void copy(ix_type);
+    virtual void share(ix_type);
     virtual void free();
     virtual void free(ix_type);
     virtual ix_type get_default_ix() const;
+    virtual void detach();
     virtual ix_type store(const T& x); ///< Ein Feld im Repository speichern
 
+    static RepositoryContext::entry_type& entry(RepositoryContext*);
+    static Repository<T>& repository(RepositoryContext* ap_rc)
+	{ return *(Repository<T>*)entry(ap_rc).mp_repository; }
+    static void init_entry(RepositoryContext::entry_type&,RepositoryContext*);
+    static void destroy(void*);
+
 private:
     T* mp_value; ///< Zeiger auf die Feldinstanz im Repository (privat um Zugriff zu steuern)
 protected:
-    static ix_type m_global_default_ix; ///< Default-Index fuer alle T (lokal im Context)
-    static Repository<T> m_repository; ///< Daten-Repository fuer T
+    ix_type& m_global_default_ix; ///< Default-Index fuer alle T (im RepositoryContext)
+    Repository<T>& m_repository; ///< Daten-Repository fuer T (im RepositoryContext)
+    static int m_slot; ///< Slot von T in jedem RepositoryContext (-1: noch keiner)
+};
+
+/** abstract_column
+
+    Spalte einer ColumnTable: die Werte eines Feldes fuer alle Records
+    der Tabelle, zusammenhaengend gespeichert. Ein Feld wird nicht
+    durch Kopieren, sondern durch bind() mit einer Zeile geladen (es
+    zeigt dann direkt auf den Wert in der Spalte). */
+
+class abstract_column
+{
+public:
+    virtual ~abstract_column() {}
+    
+    virtual void append(const abstract_data_type&) = 0; ///< Wert des Feldes anhaengen
+    virtual void bind(abstract_data_type&,long) const = 0; ///< Feld mit Zeile laden
+    virtual void resize(long) = 0; ///< Auf Zeilenzahl bringen (mit Default-Werten)
+    virtual long size() const = 0;
+    virtual void clear() = 0;
+};
+
+/** column_type<T>
+
+    Spalte mit Werten vom Typ T. Default-Werte werden nur markiert,
+    das Feld laedt dann bei bind() wieder seinen Default-Wert. */
+
+template <class T>
+class column_type
+    : public abstract_column
+{
+public:
+    typedef T value_type;
+    
+    virtual void append(const abstract_data_type& a_field)
+	{ 
+	    const data_type<T>& f = (const data_type<T>&)a_field;
+	    bool d = f.is_default();
+	    m_default.push_back(d);
+	    if (d) m_values.push_back(T()); else m_values.push_back(f.val());
+	}
+    virtual void bind(abstract_data_type& a_field,long a_row) const
+	{
+	    data_type<T>& f = (data_type<T>&)a_field;
+	    f.free();
+	    if ((a_row>=size())||(m_default[a_row])) return;
+	    f.m_ix = g_column_ix;
+	    f.mp_value = (T*)&m_values[a_row];
+	}
+    virtual void resize(long n) 
+	{ m_values.resize(n); m_default.resize(n,true); }
+    virtual long size() const { return m_values.size(); }
+    virtual void clear() { m_values.clear(); m_default.clear(); }
+
+    /// Werte aller Zeilen, zusammenhaengend (NULL bei leerer Spalte)
+    inline const T* data() const { return (m_values.empty()) ? NULL : &m_values[0]; }
+    inline bool is_default(long a_row) const { return m_default[a_row]; }
+    
+protected:
+    vector<T> m_values; ///< Werte aller Zeilen
+    vector<bool> m_default; ///< Zeile hat Default-Wert
+};
+
+/** column_type< DynTuple<T> >
+
+    Spalte eines Tupel-Feldes (z.B. tuple_type). Ein vector<DynTuple>
+    waere nicht zusammenhaengend, daher liegen die Komponenten aller
+    Zeilen hintereinander in einem Feld (data()), Zeile \c r beginnt
+    bei offset(r) und hat width(r) Komponenten. bind() kopiert die
+    Zeile in einen Puffer der Spalte (ohne Allokation, sobald er gross
+    genug ist), auf den das Feld dann zeigt. */
+
+template <class T>
+class column_type< DynTuple<T> >
+    : public abstract_column
+{
+public:
+    typedef DynTuple<T> value_type;
+    
+    column_type() : m_offset(1,0) {}
+    virtual void append(const abstract_data_type& a_field)
+	{ 
+	    const data_type<value_type>& f = (const data_type<value_type>&)a_field;
+	    bool d = f.is_default();
+	    m_default.push_back(d);
+	    if (!d) 
+	    { 
+		const value_type& x = f.val(); 
+		m_values.insert(m_values.end(),x.data(),x.data()+x.size()); 
+	    }
+	    m_offset.push_back(m_values.size());
+	}
+    virtual void bind(abstract_data_type& a_field,long a_row) const
+	{
+	    data_type<value_type>& f = (data_type<value_type>&)a_field;
+	    f.free();
+	    if ((a_row>=size())||(m_default[a_row])) return;
+	    const int n = width(a_row);
+	    m_row.alloc(n);
+	    if (n>0) memcpy(m_row.data(),&m_values[m_offset[a_row]],sizeof(T)*n);
+	    f.m_ix = g_column_ix;
+	    f.mp_value = &m_row;
+	}
+    virtual void resize(long n) 
+	{ 
+	    if (n<size()) m_values.resize(m_offset[n]);
+	    m_offset.resize(n+1,m_values.size());
+	    m_default.resize(n,true); 
+	}
+    virtual long size() const { return m_default.size(); }
+    virtual void clear() { m_values.clear(); m_offset.assign(1,0); m_default.clear(); }
+
+    /// Komponenten aller Zeilen, zusammenhaengend (NULL bei leerer Spalte)
+    inline const T* data() const { return (m_values.empty()) ? NULL : &m_values[0]; }
+    inline long offset(long a_row) const { return m_offset[a_row]; }
+    inline int width(long a_row) const { return m_offset[a_row+1]-m_offset[a_row]; }
+    inline bool is_default(long a_row) const { return m_default[a_row]; }
+    
+protected:
+    vector<T> m_values; ///< Komponenten aller Zeilen, zeilenweise
+    vector<long> m_offset; ///< Zeile r liegt in [m_offset[r],m_offset[r+1])
+    vector<bool> m_default; ///< Zeile hat Default-Wert
+    mutable value_type m_row; ///< zuletzt gebundene Zeile
 };
 
 /** field_type<T>
@@ -417,9 +731,13 @@ public:
     virtual void read(istream& is,const matrix_separators* = NULL);
     virtual void read(istream& is,int,const matrix_separators* = NULL);
     virtual void write(ostream& os,const matrix_separators* = NULL) const;
+    virtual string binary_kind() const;
+    virtual void write_binary(string&) const;
+    virtual const char* read_binary(const char*,const label_map_type* = NULL);
 
 protected:
     const SymbolicIO<T> m_io; ///< IO-Operation fuer symbolische Werte
+    DynMatrix<T> m_buffer; ///< Lesepuffer (pro Feld, nicht static, wegen Threads)
 };
 
 /** array_type<T>
@@ -440,12 +758,16 @@ public:
     virtual void read(istream& is,const matrix_separators* = NULL);
     virtual void read(istream& is,int,const matrix_separators* = NULL);
     virtual void write(ostream& os,const matrix_separators* = NULL) const;
+    virtual string binary_kind() const;
+    virtual void write_binary(string&) const;
+    virtual const char* read_binary(const char*,const label_map_type* = NULL);
 
 protected:
     explicit array_type(Context *);
 
 protected:
     const SymbolicIO<typename T::value_type> m_io; ///< IO-Operation fuer symbolische Werte
+    DynMatrix<typename T::value_type> m_buffer; ///< Lesepuffer (pro Feld, nicht static, wegen Threads)
 };
 
 typedef field_type< int > int_type;
@@ -460,6 +782,78 @@ typedef array_type< DynTuple<double> > tuple_type;
 typedef array_type< DynMatrix<int> > int_matrix_type;
 typedef array_type< DynMatrix<double> > matrix_type;
 
+/** Metrics
+
+    Prozessweites Verzeichnis der Betriebszaehler aller Reader, Writer
+    und Tabellen sowie der Repositories (siehe Repository<T>::metrics()).
+    Es ist nur aktiv, wenn die Umgebungsvariable DAL_METRICS gesetzt
+    ist (Dateiname, "-" fuer stderr). Dann wird es bei Programmende,
+    alle DAL_METRICS_INTERVAL Sekunden und nach einem SIGUSR1 als JSON
+    ausgegeben, zusammen mit Durchsatz und Restzeit der Eingaben sowie
+    den Anteilen von Lese- und Parse-Zeit an der Laufzeit. Periodische
+    Ausgabe und SIGUSR1 werden erst beim naechsten pop() oder push()
+    einer Tabelle bedient (poll()), der Signal-Handler setzt nur ein
+    Flag.
+
+    Die Zaehler gehoeren dem Objekt, das sie fuehrt, und werden ohne
+    Lock hochgezaehlt; die Ausgabe liest sie ebenfalls ohne Lock (bei
+    mehreren Threads also nur eine Momentaufnahme). Zaehler eines
+    geloeschten Objekts bleiben mit dem letzten Stand erhalten, Objekte
+    mit gleicher Art, gleichem Namen und gleicher Datei werden dabei
+    zusammengefasst. [globdef.cpp] */
+
+class Metrics
+{
+public:
+    enum kind_type { READER, WRITER, TABLE };
+    
+    /// Zaehler eines Readers, Writers oder einer Tabelle
+    struct counters
+    {
+	counters() 
+	    : m_records(0), m_pushes(0), m_bytes(0), m_seeks(0), m_pos(0)
+	    , m_size(-1), m_chunks(0), m_mismatches(0)
+	    , m_parse(0), m_io(0), m_poll(0) {}
+	long m_records; ///< gelesene/geschriebene Records, Tabelle: pop()
+	long m_pushes; ///< Tabelle: push()
+	long m_bytes; ///< Bytes der Records
+	long m_seeks; ///< Neupositionierungen (setpos())
+	long m_pos; ///< aktuelle Position in der Eingabedatei
+	long m_size; ///< Groesse der Eingabedatei, -1: unbekannt
+	long m_chunks; ///< von Workern zerlegte Abschnitte (Chunked<T>)
+	long m_mismatches; ///< Abschnitte ohne Anschluss an den Vorgaenger (danach sequentiell)
+	double m_parse; ///< Sekunden beim Dekodieren (Reader), bei push() (Tabelle)
+	double m_io; ///< Sekunden beim Lesen des naechsten Records
+	int m_poll; ///< Aufrufe bis zum naechsten Blick auf die Uhr
+    };
+    
+    static void init();
+    static void enlist(counters*,kind_type,const string&,const string&);
+    static void remove(counters*);
+    static void dump(ostream&);
+    static void dump();
+    
+    inline static bool is_active() { return m_active; }
+    /// Zeitpunkt in Sekunden, 0 wenn nicht aktiv (dann wird nicht gemessen)
+    inline static double clock() { return (m_active) ? now() : 0.0; }
+    /// Seit \c a_start vergangene Zeit auf \c a_sum addieren, liefert clock()
+    inline static double lap(double& a_sum,double a_start)
+	{ if (!m_active) return 0.0; double t=now(); a_sum+=t-a_start; return t; }
+    /// Periodische/angeforderte Ausgabe faellig? (nach pop()/push())
+    inline static void poll(counters& c) 
+	{ if ((m_request)||(--c.m_poll<0)) check(c); }
+
+private:
+    static double now();
+    static void check(counters&);
+    static void write(ostream&);
+    static void request(int);
+    static void dump_at_exit();
+    
+    static bool m_active; ///< DAL_METRICS gesetzt
+    static volatile sig_atomic_t m_request; ///< SIGUSR1 empfangen
+};
+
 /** Tabelle. */
 
 class Reader;
@@ -474,6 +868,7 @@ public:
     
     inline Context const * context() const;
     inline Context* context();
+    RepositoryContext* repositories() const;
     void info(ostream&) const;
     
     virtual void attach(abstract_data_type *ap_value);
@@ -488,6 +883,9 @@ public:
     virtual bool done() = 0;
     virtual void close() = 0;
     virtual void free();
+    virtual long record_count(); ///< Anzahl Records laut Index, sonst -1
+    ix_type hold(); ///< Aktuellen Record festhalten (siehe restore())
+    void restore(ix_type); ///< Festgehaltenen Record wieder laden
     
     inline index_type const * keyptr() 
 	{ INVARIANT(context()->is_initialized(),"init+pop required"); 
@@ -512,6 +910,7 @@ protected:
 protected:
     record_type *mp_record;
     index_type *mp_input_key,*mp_input_ref,*mp_output_key,*mp_output_ref;
+    Metrics::counters m_metrics; ///< pop()/push() der Tabelle (siehe Metrics)
 };
 
 BaseTable* get_table(const string&); 
@@ -558,6 +957,7 @@ public:
     virtual bool pop();
     virtual bool done();
     virtual void close();
+    virtual long record_count();
     
     void setrpos(const marker_type&);
     void getrpos(marker_type&);
@@ -592,6 +992,7 @@ public:
     virtual bool pop();
     virtual bool done();
     virtual void close();
+    virtual long record_count();
 
 protected:
     virtual void init_reader();
@@ -632,6 +1033,7 @@ public:
     virtual void init();
     virtual void push();
     virtual bool pop();
+    virtual long record_count();
     
     bool match(const int_matrix_type::value_type&) const;
     bool match_next(const int_matrix_type::value_type&) const;
@@ -677,6 +1079,38 @@ protected:
     bool m_rhier,m_whier;
 };
 
+/** SpillFile
+
+    Temporaere Datei fuer die Records einer BufferedTable, die nicht
+    mehr in das Speicherbudget passen (Umgebungsvariable DAL_BUFFER_MB
+    oder DAL_BUFFER_BYTES).
+    Records (Binaerformat, siehe abstract_data_type::write_binary())
+    werden nur angehaengt und nur sequentiell wieder gelesen. Die
+    Datei wird beim ersten append() im Verzeichnis $TMPDIR (sonst /tmp)
+    angelegt und sofort wieder geloescht. [table.cpp] */
+
+class SpillFile
+{
+public:
+    explicit SpillFile();
+    ~SpillFile();
+    
+    void append(const string&);
+    bool read(string&);
+    void rewind();
+    void clear();
+    inline long records() const { return m_records; }
+    
+private:
+    SpillFile(const SpillFile&); // CC not defined
+    void open();
+    
+    FILE *mp_file;
+    char *mp_buffer; ///< Puffer fuer stdio
+    long m_records; ///< Anzahl Records in der Datei
+    bool m_reading; ///< zuletzt gelesen (vor Schreiben neu positionieren)
+};
+
 template <class T>
 class BufferedTable
     : public T
@@ -694,21 +1128,90 @@ public:
     virtual void submit();
     virtual void free();
     void swap();
+    /// Anzahl Records in den temporaeren Dateien (Ein- und Ausgabe)
+    inline long spilled() const 
+	{ return mp_inspill->records()+mp_outspill->records(); }
   
 protected:
     virtual void init_reader();
     virtual void init_writer();
 
+private:
+    long encode();
+    bool decode(SpillFile&);
+    /// Budget von Eingabe oder Ausgabe (\a a_bytes) ausgeschoepft?
+    inline bool over_budget(long a_bytes) const
+	{ return (m_budget>0)&&(a_bytes>=m_budget); }
+
 private:
     list<ix_type> *mp_input;
     list<ix_type> *mp_output;
     list<ix_type>::iterator m_inpos;
     list<Writer*> *mp_temp_writer;
+    
+    long m_budget; ///< Speicherbudget in Bytes je Ein- und Ausgabe (0: unbegrenzt)
+    long m_inbytes,m_outbytes; ///< geschaetzter Speicher von mp_input/mp_output
+    SpillFile *mp_inspill,*mp_outspill; ///< Fortsetzung von mp_input/mp_output
+    long m_spillpos; ///< Anzahl bereits gelesener Records aus mp_inspill
+    string m_record; ///< Record im Binaerformat
 };
 
 typedef BufferedTable<MasterTable> BMasterTable;
 typedef BufferedTable<HMasterTable> BHMasterTable;
 
+/** Gepufferte Tabelle mit spaltenweiser Speicherung (siehe
+    column_type), Schnittstelle wie BufferedTable. */
+
+template <class T>
+class ColumnTable
+    : public T
+{
+public:
+    explicit ColumnTable(int,const string&,Domain *d=NULL);
+    ~ColumnTable();
+    
+    virtual void rewind();
+    virtual void clear();
+    virtual void push();
+    virtual bool pop();
+    virtual bool done();
+    virtual void close();
+    virtual void submit();
+    virtual void free();
+    void swap();
+    
+    inline long rows() const { return m_rows; } ///< Anzahl Eingabe-Records
+    inline long row() const { return m_row-1; } ///< zuletzt gelesener Record
+    const abstract_column* column(const abstract_data_type*) const;
+    /** Direkter Zugriff auf die Eingabespalte des Feldes \a a_field:
+	data() liefert die Werte aller Zeilen zusammenhaengend (bei
+	tuple_type alle Komponenten, Zeile r ab offset(r)). */
+    template <class F> inline const column_type<typename F::value_type>& 
+    values(const F& a_field) const
+	{ 
+	    const abstract_column *p = column(&a_field);
+	    INVARIANT(p!=NULL,"field attached to table");
+	    return *(const column_type<typename F::value_type>*)p; 
+	}
+  
+protected:
+    virtual void init_reader();
+    virtual void init_writer();
+    void make_columns();
+    void unbind();
+
+private:
+    vector<abstract_column*> m_input; ///< Eingabespalten (je Feld)
+    vector<abstract_column*> m_output; ///< Ausgabespalten (je Feld)
+    long m_rows; ///< Anzahl Zeilen in m_input
+    long m_outrows; ///< Anzahl Zeilen in m_output
+    long m_row; ///< naechste zu lesende Zeile
+    list<Writer*> *mp_temp_writer;
+};
+
+typedef ColumnTable<MasterTable> CMasterTable;
+typedef ColumnTable<HMasterTable> CHMasterTable;
+
 /** SubSetTable. Nur fuer HMaster sinnig. */
 
 class SubSetTable
@@ -725,6 +1228,7 @@ public:
     virtual void rewind();
     virtual bool pop();
     virtual bool done();
+    virtual long record_count();
     
 private:
     int_matrix_type::value_type m_hmask;
@@ -26,6 +26,279 @@
 #ifndef REPOSITORY_SOURCE
 #define REPOSITORY_SOURCE
 
+/** Slab-Speicher fuer DynTuple/DynMatrix (siehe matvec_new()). Die
+    Groessenklassen sind Vielfache von g_slab_min bis g_slab_steps
+    Bytes, darueber Zweierpotenzen bis g_slab_max Bytes. Geschnitten
+    wird aus Bloecken von g_slab_block Bytes, die auf ihre Groesse
+    ausgerichtet sind; so findet slab_trim() zu jedem Eintrag den
+    Kopf seines Blocks. Ein freier Eintrag enthaelt den Zeiger auf den
+    naechsten freien Eintrag seiner Klasse.
+
+    Mit Threads hat jeder Thread eigene Freilisten und einen eigenen
+    Block, aus dem er schneidet (ein Feld darf aber in einem anderen
+    Thread freigegeben werden, als es allokiert wurde). Endet ein
+    Thread, wandern seine Freilisten in die gemeinsamen Listen
+    gp_slab_orphans, aus denen Threads mit leerer Freiliste
+    nachfuellen. Blocks, Zaehler und gp_slab_orphans schuetzt
+    g_slab_mutex, die Freilisten der Threads brauchen keine Sperre. */
+
+#include <sys/mman.h> // mmap
+#include <map>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#define SLAB_LOCAL __thread
+#else
+#define SLAB_LOCAL
+#endif
+
+static const size_t g_slab_min = 16;
+static const size_t g_slab_steps = 256; // bis hier in Schritten von g_slab_min
+static const size_t g_slab_max = 16384;
+static const int g_slab_classes = 22; // 16,32,..,256, 512..16384
+static const size_t g_slab_block = 256*1024;
+
+/// Kopf eines Blocks (am Blockanfang)
+struct slab_block
+{
+  size_t m_carved; ///< geschnittene Eintraege (erst gueltig, wenn m_retired)
+  bool m_retired; ///< kein Thread schneidet mehr aus diesem Block
+};
+/// Abstand des ersten Eintrags vom Blockanfang
+static const size_t g_slab_header = (sizeof(slab_block)+g_slab_min-1)&~(g_slab_min-1);
+
+static SLAB_LOCAL void* gp_slab_free[g_slab_classes];
+static SLAB_LOCAL slab_block* gp_slab_current = NULL;
+static SLAB_LOCAL char* gp_slab_pos = NULL;
+static SLAB_LOCAL size_t g_slab_left = 0;
+static SLAB_LOCAL size_t g_slab_carved = 0;
+
+static void* gp_slab_orphans[g_slab_classes];
+static volatile bool g_slab_orphaned[g_slab_classes]; ///< gp_slab_orphans[c] nicht leer
+static long g_slab_blocks = 0;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t g_slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_slab_key;
+#endif
+
+/** Groessenklasse fuer \a a_bytes (auf die Klassengroesse
+    aufgerundet), -1 falls zu gross. */
+
+static inline int
+slab_class(size_t& a_bytes)
+{
+  if (a_bytes>g_slab_max) return -1;
+  if (a_bytes<=g_slab_steps)
+    {
+    int c = (a_bytes<=g_slab_min) ? 0 : (a_bytes-1)/g_slab_min;
+    a_bytes = (c+1)*g_slab_min;
+    return c;
+    }
+  int c = g_slab_steps/g_slab_min; size_t size = 2*g_slab_steps;
+  while (size<a_bytes) { size<<=1; ++c; }
+  a_bytes = size;
+  return c;
+}
+
+static inline slab_block*
+slab_header(void *p)
+{
+  return (slab_block*)((size_t)p & ~(g_slab_block-1));
+}
+
+static inline void
+slab_lock()
+{
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&g_slab_mutex);
+#endif
+}
+
+static inline void
+slab_unlock()
+{
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_unlock(&g_slab_mutex);
+#endif
+}
+
+/** Haengt die Liste \a p vor die Liste \a a_list. */
+
+static void
+slab_append(void*& a_list,void *p)
+{
+  if (p==NULL) return;
+  void *q = p;
+  while (*(void**)q!=NULL) q = *(void**)q;
+  *(void**)q = a_list;
+  a_list = p;
+}
+
+/** Der Block, aus dem der Thread schneidet, wird abgeschlossen. */
+
+static void
+slab_retire()
+{
+  if (gp_slab_current==NULL) return;
+  slab_lock();
+  gp_slab_current->m_carved = g_slab_carved;
+  gp_slab_current->m_retired = true;
+  slab_unlock();
+  gp_slab_current = NULL; gp_slab_pos = NULL;
+  g_slab_left = g_slab_carved = 0;
+}
+
+#ifdef HAVE_LIBPTHREAD
+/** Ende eines Threads: Block abschliessen, Freilisten abgeben. */
+
+static void
+slab_thread_exit(void*)
+{
+  slab_retire();
+  slab_lock();
+  for (int c=0;c<g_slab_classes;++c)
+    {
+    slab_append(gp_slab_orphans[c],gp_slab_free[c]);
+    gp_slab_free[c] = NULL;
+    if (gp_slab_orphans[c]!=NULL) g_slab_orphaned[c] = true;
+    }
+  slab_unlock();
+  slab_trim();
+}
+
+static void
+slab_key_init()
+{
+  pthread_key_create(&g_slab_key,&slab_thread_exit);
+}
+
+/** Uebernimmt die gemeinsame Freiliste der Klasse \a c. */
+
+static void*
+slab_adopt(int c)
+{
+  slab_lock();
+  void *p = gp_slab_orphans[c];
+  gp_slab_orphans[c] = NULL;
+  g_slab_orphaned[c] = false;
+  slab_unlock();
+  return p;
+}
+#endif
+
+/** Neuer Block fuer den Thread. mmap() liefert nur Seiten, daher
+    wird der doppelte Bereich angefordert und auf einen ausgerichteten
+    Block gekuerzt. */
+
+static void
+slab_new_block()
+{
+  slab_retire();
+  const size_t n = 2*g_slab_block;
+  char *p = (char*)mmap(NULL,n,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+  if (p==(char*)MAP_FAILED) { ERROR("out of memory (slab block)"); exit(-1); }
+  char *b = (char*)(((size_t)p+g_slab_block-1) & ~(g_slab_block-1));
+  if (b>p) munmap(p,b-p);
+  if (b+g_slab_block<p+n) munmap(b+g_slab_block,p+n-(b+g_slab_block));
+
+  gp_slab_current = (slab_block*)b;
+  gp_slab_current->m_carved = 0;
+  gp_slab_current->m_retired = false;
+  gp_slab_pos = b+g_slab_header;
+  g_slab_left = g_slab_block-g_slab_header;
+  g_slab_carved = 0;
+  slab_lock();
+  ++g_slab_blocks;
+  slab_unlock();
+#ifdef HAVE_LIBPTHREAD
+  // beim Ende des Threads slab_thread_exit() aufrufen
+  pthread_once(&g_slab_once,&slab_key_init);
+  if (pthread_getspecific(g_slab_key)==NULL) pthread_setspecific(g_slab_key,(void*)1);
+#endif
+}
+
+void*
+slab_alloc(size_t& a_bytes)
+{
+  int c = slab_class(a_bytes);
+  if (c<0) return ::operator new(a_bytes);
+
+  void *p = gp_slab_free[c];
+#ifdef HAVE_LIBPTHREAD
+  if ((p==NULL)&&(g_slab_orphaned[c])) p = slab_adopt(c);
+#endif
+  if (p!=NULL) { gp_slab_free[c] = *(void**)p; return p; }
+
+  if (g_slab_left<a_bytes) slab_new_block();
+  p = gp_slab_pos;
+  gp_slab_pos += a_bytes; g_slab_left -= a_bytes; ++g_slab_carved;
+  return p;
+}
+
+void
+slab_free(void* p,size_t a_bytes)
+{
+  if (p==NULL) return;
+  int c = slab_class(a_bytes);
+  if (c<0) { ::operator delete(p); return; }
+  *(void**)p = gp_slab_free[c];
+  gp_slab_free[c] = p;
+}
+
+/** Gibt die Bloecke an das Betriebssystem zurueck, deren Eintraege
+    alle in den Freilisten des aufrufenden Threads oder in
+    gp_slab_orphans liegen. Bloecke mit Eintraegen in Freilisten
+    anderer Threads, und solche, aus denen noch geschnitten wird,
+    bleiben erhalten. Aufwand linear in der Zahl der freien Eintraege;
+    aufgerufen beim Schliessen einer Tabelle und beim Loeschen eines
+    RepositoryContext. */
+
+void
+slab_trim()
+{
+  slab_lock();
+  // freie Eintraege je Block zaehlen
+  map<slab_block*,size_t> found;
+  for (int c=0;c<g_slab_classes;++c)
+    {
+    for (void *p=gp_slab_free[c];p!=NULL;p=*(void**)p) ++found[slab_header(p)];
+    for (void *p=gp_slab_orphans[c];p!=NULL;p=*(void**)p) ++found[slab_header(p)];
+    }
+  // vollstaendig freie Bloecke behalten den Zaehler, die anderen 0
+  long release = 0;
+  for (map<slab_block*,size_t>::iterator b=found.begin();b!=found.end();++b)
+    {
+    if ((b->first->m_retired)&&(b->second==b->first->m_carved)) ++release;
+    else b->second = 0;
+    }
+  if (release>0)
+    {
+    void **lists[2] = { gp_slab_free, gp_slab_orphans };
+    for (int l=0;l<2;++l)
+      for (int c=0;c<g_slab_classes;++c)
+	{
+	void **pp = &lists[l][c];
+	while (*pp!=NULL)
+	  if (found[slab_header(*pp)]>0) *pp = *(void**)*pp; else pp = (void**)*pp;
+	}
+    for (map<slab_block*,size_t>::iterator b=found.begin();b!=found.end();++b)
+      if (b->second>0) munmap((char*)b->first,g_slab_block);
+    g_slab_blocks -= release;
+    }
+  slab_unlock();
+}
+
+/** Speicher der Slab-Bloecke (Bytes), fuer Tests und Metriken. */
+
+long
+slab_bytes()
+{
+  slab_lock();
+  long bytes = g_slab_blocks*(long)g_slab_block;
+  slab_unlock();
+  return bytes;
+}
+
 namespace Data_Access_Library {
 
 /** Illegal index. This global variable is used for several purposes,
@@ -34,6 +307,131 @@ namespace Data_Access_Library {
 
 ix_type g_illegal_ix = (ix_type)-1;
 
+/** Index of a field whose value is bound to a row of a column
+    (ColumnTable) rather than stored in the repository. */
+
+ix_type g_column_ix = (ix_type)-2;
+
+/** \class RepositoryContext
+    \brief Set of repositories
+
+    One repository per data type T (plus the index of the global
+    default value for T). The slot of T (its index in every context)
+    is assigned on first use. Each thread has a current context
+    (initially the global one); a field uses the context of its table,
+    or the current context, see abstract_data_type. */
+
+/// aktueller Context des Threads (NULL: globaler Context)
+static SLAB_LOCAL RepositoryContext* gp_current_repositories = NULL;
+/// Anzahl vergebener Slots
+static int g_repository_slots = 0;
+#ifdef HAVE_LIBPTHREAD
+/// schuetzt Slot-Vergabe sowie Suche und Anlegen von Eintraegen
+static pthread_mutex_t g_repository_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+RepositoryContext::RepositoryContext()
+{
+  for (int i=0;i<max_slots;++i) mp_entries[i]=NULL;
+}
+
+/** Destructor. Deletes all repositories of the context, there must
+    not be any field left that uses them. Slab blocks that became free
+    are returned (see slab_trim()). */
+
+RepositoryContext::~RepositoryContext()
+{
+  if (gp_current_repositories==this) gp_current_repositories=NULL;
+  for (int i=0;i<max_slots;++i)
+    if (mp_entries[i]!=NULL)
+      {
+      (*mp_entries[i]->mp_destroy)(mp_entries[i]->mp_repository);
+      delete mp_entries[i];
+      }
+  slab_trim();
+}
+
+/** Entry of the data type with slot \c a_slot in this context,
+    created and initialized by \c ap_init if it does not exist yet. A
+    data type without a slot (\c a_slot<0) gets the next free one
+    first. The entry of the global context is created before that of
+    any other context, since it holds the default value. Assigning the
+    slot, the lookup and the creation all happen under one lock:
+    other threads may write \c a_slot and \c mp_entries at the same
+    time. This is only done when a field is created, not when its
+    value is accessed. */
+
+RepositoryContext::entry_type&
+RepositoryContext::insert(
+  int& a_slot,
+  init_type ap_init
+  )
+{
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_lock(&g_repository_mutex);
+#endif
+  if (a_slot<0)
+    {
+    INVARIANT(g_repository_slots<max_slots,"too many repository types");
+    a_slot = g_repository_slots++;
+    }
+  RepositoryContext *p_global = global();
+  if (this!=p_global) p_global->create(a_slot,ap_init);
+  entry_type& e = create(a_slot,ap_init);
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_unlock(&g_repository_mutex);
+#endif
+  return e;
+}
+
+/** Entry for \c a_slot, created if it does not exist yet (only with
+    the lock held, see insert()). */
+
+RepositoryContext::entry_type&
+RepositoryContext::create(
+  int a_slot,
+  init_type ap_init
+  )
+{
+  if (mp_entries[a_slot]==NULL)
+    {
+    entry_type *p_entry = new entry_type;
+    (*ap_init)(*p_entry,this);
+    mp_entries[a_slot] = p_entry;
+    }
+  return *mp_entries[a_slot];
+}
+
+/** The global context. It is never deleted, since static fields may
+    still use it during program termination. */
+
+RepositoryContext* 
+RepositoryContext::global()
+{
+  static RepositoryContext *p_global = new RepositoryContext;
+  return p_global;
+}
+
+/** The current context of the calling thread. */
+
+RepositoryContext* 
+RepositoryContext::current()
+{
+  return (gp_current_repositories!=NULL) ? gp_current_repositories : global();
+}
+
+/** Set the current context of the calling thread (NULL: global
+    context). Fields and tables created afterwards by this thread use
+    it. */
+
+void
+RepositoryContext::set_current(
+  RepositoryContext *ap_rc
+  )
+{
+  gp_current_repositories = ap_rc;
+}
+
 /** \class Repository
     \brief Data repository
 
@@ -44,7 +442,12 @@ ix_type g_illegal_ix = (ix_type)-1;
     allocated and organized by an STL deque<T> type and instances
     allocated once will be reused later without freeing and
     reallocating the memory. The instances can be accessed by their
-    index in the deque array. */
+    index in the deque array. Free entries are chained through the
+    entries themselves (no separate list nodes). Each entry carries a
+    reference count, so that several records may share one entry
+    (copy on write, see data_type<T>::share()). The payload of
+    DynTuple and DynMatrix values comes from slabs (see
+    matvec_new()). */
 
 /** Insert instance. A new instance is inserted into the repository
     and initialized with \c a_value. If the list of free entries is
@@ -57,16 +460,22 @@ Repository<T>::insert(
     const T& a_value
     )
 {
-    if (m_free.empty())
+    if (m_free==g_illegal_ix)
     { 
-	elements.insert(elements.end(),a_value);
-	return next_element++;
+	elements.resize(elements.size()+1);
+	elements.back().m_value = a_value;
+	elements.back().m_refs = 1;
+	ix_type ix(next_element++);
+	inserted();
+	return ix;
     }
     else
     {
-	ix_type ix(*m_free.begin());
-	elements[ix]=a_value;
-	m_free.pop_front();
+	ix_type ix(m_free);
+	m_free = elements[ix].m_next; --m_free_count;
+	elements[ix].m_value = a_value;
+	elements[ix].m_refs = 1;
+	inserted();
 	return ix;
     }
 }
@@ -81,16 +490,20 @@ template <class T>
 ix_type 
 Repository<T>::insert()
 {
-    if (m_free.empty())
+    if (m_free==g_illegal_ix)
     { 
-	T value;
-	elements.insert(elements.end(),value);
-	return next_element++;
+	elements.resize(elements.size()+1);
+	elements.back().m_refs = 1;
+	ix_type ix(next_element++);
+	inserted();
+	return ix;
     }
     else
     {
-	ix_type ix(*m_free.begin());
-	m_free.pop_front();
+	ix_type ix(m_free);
+	m_free = elements[ix].m_next; --m_free_count;
+	elements[ix].m_refs = 1;
+	inserted();
 	return ix;
     }
 }
@@ -106,8 +519,8 @@ Repository<T>::info(
 {
     word n(0);
     os << "repository" << endl;
-    for (deque<T>::const_iterator i=elements.begin(); i!=elements.end(); ++i)
-    { os << setw(5) << n << " " << (*i) << endl; ++n; }
+    for (typename deque<slot_type>::const_iterator i=elements.begin(); i!=elements.end(); ++i)
+    { os << setw(5) << n << " " << (*i).m_value << endl; ++n; }
 }
 
 /** Debugging output to track memory consumption. */
@@ -120,11 +533,30 @@ Repository<T>::mem_info(
     const
 {
     const int n = next_element;
-    const int free = m_free.size();
+    const int free = m_free_count;
     const int percentfull = (n==0)?100:(n-free)*100/n;
     os << n << '(' << percentfull << "%)";
 }
 
+/** Zaehler fuer Metrics::dump() als JSON-Objekt: angelegte, belegte
+    und freie Eintraege, Hoechststand, Anzahl insert() und Speicher der
+    Eintraege (ohne dynamischen Speicher der Werte selbst). */
+
+template <class T>
+void
+Repository<T>::metrics(
+    ostream& os
+    ) 
+    const
+{
+    os << "{\"slots\":" << next_element 
+       << ",\"live\":" << next_element-m_free_count
+       << ",\"free\":" << m_free_count
+       << ",\"peak\":" << m_peak
+       << ",\"inserts\":" << m_inserts
+       << ",\"bytes\":" << (long)elements.size()*(long)sizeof(slot_type) << '}';
+}
+
 } // namespace
 
 #endif REPOSITORY_SOURCE
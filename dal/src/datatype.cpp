@@ -36,16 +36,60 @@ namespace Data_Access_Library {
 ////////////////////////////////////////////////////////////////////
 // abstract_data_type
 
-/** Constructor. Every data object needs a context. */
+/** Constructor. Every data object needs a context. The value is kept
+    in the repositories of \c ap_rc, or of the current repository
+    context if none is given (see RepositoryContext). */
 
 abstract_data_type::abstract_data_type(
-  Context *ap_context
+  Context *ap_context,
+  RepositoryContext *ap_rc
   )
   : mp_context(ap_context)
+  , mp_repositories((ap_rc!=NULL)?ap_rc:RepositoryContext::current())
+  , mp_rawsep(NULL)
+  , m_rawrows(-1)
 {
   INVARIANT(mp_context!=NULL,"");
 }
 
+/** Deferred reading (table modifier :l). The input text \c a_raw of
+    the field is kept and decoded on the first access to the value
+    (read(is,ap_sep) or, if \c a_rows>=0, read(is,a_rows,ap_sep)). If
+    the field gets another value before (e.g.\ the record is skipped),
+    the text is never decoded. Key and ref fields are decoded
+    immediately, since the readers need them. */
+
+void
+abstract_data_type::defer(
+  const string& a_raw,
+  const matrix_separators *ap_sep,
+  int a_rows
+  )
+{
+  m_raw = a_raw;
+  m_rawrows = a_rows;
+  mp_rawsep = ap_sep;
+  if (IS_TAG(mp_context->mode(),Context::KEYREF)) decode_raw();
+}
+
+/** Decode the text stored by defer(). The method is const, because it
+    is called from the (const) read access functions; the value itself
+    is logically unchanged. */
+
+void
+abstract_data_type::decode_raw() 
+  const
+{
+  const matrix_separators *p_sep = mp_rawsep;
+  mp_rawsep = NULL; // read() greift ueber var() zu
+  abstract_data_type *p_this = const_cast<abstract_data_type*>(this);
+  istrstream is(m_raw.data(),m_raw.length());
+  if (m_rawrows>=0) 
+    p_this->read(is,m_rawrows,p_sep);
+  else
+    p_this->read(is,p_sep);
+}
+
 /** Reading the data object from a stream. Since this class is
     abstract, an error will be reported if this method is called. */
 
@@ -91,28 +135,157 @@ const
   DO_NOT_PASS;
 }
 
+/** Binary type tag for the columnar file format (see COL_Writer).
+    Since this class is abstract, an error will be reported if this
+    method is called. */
+
+string
+abstract_data_type::binary_kind() const
+{
+  DO_NOT_PASS;
+  return string();
+}
+
+/** Appending the data object in binary form to a buffer. Since this
+    class is abstract, an error will be reported if this method is
+    called. */
+
+void
+abstract_data_type::write_binary(string&) const
+{
+  DO_NOT_PASS;
+}
+
+/** Reading the data object in binary form from memory. Since this
+    class is abstract, an error will be reported if this method is
+    called. */
+
+const char*
+abstract_data_type::read_binary(const char* p,const label_map_type*)
+{
+  DO_NOT_PASS;
+  return p;
+}
+
+/** Hilfsfunktionen fuer das Binaerformat. Werte werden in der
+    Darstellung der Maschine abgelegt (keine Portabilitaet zwischen
+    Architekturen), Strings mit vorangestellter Laenge. */
+
+inline const char* binary_tag(const int*) { return "i"; }
+inline const char* binary_tag(const word*) { return "u"; }
+inline const char* binary_tag(const long*) { return "l"; }
+inline const char* binary_tag(const double*) { return "d"; }
+inline const char* binary_tag(const string*) { return "s"; }
+
+template <class T> inline void 
+append_binary(string& a_buffer,const T& x)
+  { a_buffer.append((const char*)&x,sizeof(T)); }
+
+inline void 
+append_binary(string& a_buffer,const string& x)
+  { int n=x.length(); append_binary(a_buffer,n); a_buffer.append(x); }
+
+template <class T> inline const char*
+extract_binary(const char* p,T& x)
+  { memcpy(&x,p,sizeof(T)); return p+sizeof(T); }
+
+inline const char*
+extract_binary(const char* p,string& x)
+  { int n; p=extract_binary(p,n); x.assign(p,n); return p+n; }
+
+/** Nur ganzzahlige Werte koennen Label sein und werden umgesetzt. */
+
+template <class T> inline void
+translate_label(T&,const label_map_type*)
+  {}
+
+inline void
+translate_label(int& x,const label_map_type* ap_map)
+  { 
+  if (ap_map==NULL) return;
+  label_map_type::const_iterator i = ap_map->find(x);
+  if (i!=ap_map->end()) x = (*i).second; 
+  }
+
 ////////////////////////////////////////////////////////////////////
 // data_type<T>
 
-/** Constructor. Every data object needs a context. */
+/** Constructor. Every data object needs a context. The repository
+    for T and its global default value are taken from the repository
+    context (see abstract_data_type). */
 
 template <class T>
 data_type<T>::data_type
   (
-  Context* ap_context
+  Context* ap_context,
+  RepositoryContext* ap_rc
   ) 
-  : abstract_data_type(ap_context)
+  : abstract_data_type(ap_context,ap_rc)
   , mp_value(NULL)
+  , m_global_default_ix(entry(mp_repositories).m_default_ix)
+  , m_repository(repository(mp_repositories))
   {
-  // Wenn noch kein g_global_default existiert (erste Instanz), dann erstellen
-  if (m_global_default_ix==g_illegal_ix)
-  {
-    m_global_default_ix = m_repository.insert(T()); 
-  }
   // Default setzen
   load_default();
   }
 
+/** Repository entry for T in the repository context \c ap_rc. The
+    first access assigns a slot to T, the first access within a
+    context creates the repository (see init_entry()). Both happen
+    under the lock of RepositoryContext::insert(), as does the lookup
+    of an existing entry, since another thread may create a field of
+    type T at the same time. */
+
+template <class T>
+RepositoryContext::entry_type&
+data_type<T>::entry
+  (
+  RepositoryContext* ap_rc
+  )
+  {
+  return ap_rc->insert(m_slot,&init_entry);
+  }
+
+/** Create the repository for a new entry. Its global default value is
+    copied from the global context (or is T() in the global context
+    itself, until set_global_default() is called). Called with the
+    lock of RepositoryContext::insert() held. */
+
+template <class T>
+void
+data_type<T>::init_entry
+  (
+  RepositoryContext::entry_type& a_entry,
+  RepositoryContext* ap_rc
+  )
+  {
+  Repository<T> *p_rep = new Repository<T>;
+  RepositoryContext *p_global = RepositoryContext::global();
+  if (ap_rc==p_global)
+    a_entry.m_default_ix = p_rep->insert(T());
+  else
+    {
+    const RepositoryContext::entry_type& global = *p_global->find(m_slot);
+    a_entry.m_default_ix = 
+      p_rep->insert((*(Repository<T>*)global.mp_repository)[global.m_default_ix]);
+    }
+  a_entry.mp_repository = p_rep;
+  a_entry.mp_destroy = &destroy;
+  }
+
+/** Delete a repository created by entry() (called by
+    ~RepositoryContext). */
+
+template <class T>
+void
+data_type<T>::destroy
+  (
+  void *ap_repository
+  )
+  {
+  delete (Repository<T>*)ap_repository;
+  }
+
 /** Check for default value. The method returns true, if the data
     object has the default value. The default value is either defined
     by the global default value for the data_type, or specified
@@ -123,6 +296,7 @@ bool
 data_type<T>::is_default() 
     const
 { 
+    decode();
     ix_type contextdefault = mp_context->get_default_ix();
     if (contextdefault==g_illegal_ix)
     { // kein Context-spezifischer Default-Wert, also Test auf
@@ -149,6 +323,7 @@ template <class T>
 void
 data_type<T>::load_default()
 { 
+    discard();
     m_ix = mp_context->get_default_ix();
     if (m_ix==g_illegal_ix)
     { // kein Context-spezifischer Default-Wert
@@ -166,6 +341,10 @@ template <class T>
 void
 data_type<T>::copy_default()
 { 
+    discard();
+    // nicht in eine Spalte oder einen geteilten Eintrag schreiben
+    if ((m_ix==g_column_ix)||((!is_default())&&(m_repository.refs(m_ix)>1))) 
+	allocate();
     ix_type ix = mp_context->get_default_ix();
     if (ix==g_illegal_ix)
     { // kein Context-spezifischer Default-Wert
@@ -174,7 +353,11 @@ data_type<T>::copy_default()
     (*mp_value) = m_repository[ix];
 }
 
-/** Allocate a new field in the repository for the data object. */
+/** Allocate a new field in the repository for the data object. If
+    the data object is bound to a column (ColumnTable) or shares its
+    entry with others (share()), its value is copied and the shared
+    entry is released; otherwise the new field gets the default
+    value. */
 
 template <class T>
 void 
@@ -182,9 +365,13 @@ data_type<T>::allocate
   (
   )
   { 
+  ix_type old_ix = m_ix;
+  bool shared = (m_ix!=g_column_ix)&&(!is_default())&&(m_repository.refs(m_ix)>1);
+  const T *p_keep = ((m_ix==g_column_ix)||shared) ? mp_value : NULL;
   m_ix = m_repository.insert(); 
   mp_value = &m_repository[m_ix];
-  *mp_value = m_repository[get_default_ix()];
+  *mp_value = (p_keep!=NULL) ? *p_keep : m_repository[get_default_ix()];
+  if (shared) m_repository.free(old_ix);
   }
 
 /** Copy a value from the repository to this data object. */
@@ -195,11 +382,13 @@ data_type<T>::load(
   ix_type a_ix
 ) 
 { 
+  discard();
   mp_value = &m_repository[a_ix]; 
   m_ix = a_ix; 
 } 
 
-/** Copy a value from the repository to this data object. */
+/** Copy a value from the repository to this data object (assigned
+    once, without loading the default value first). */
 
 template <class T>
 void 
@@ -207,10 +396,42 @@ data_type<T>::copy(
   ix_type a_ix
 )
 {
-    allocate();
+    INVARIANT(a_ix!=g_column_ix,"column value has no repository entry");
+    discard();
+    m_ix = m_repository.insert(); 
+    mp_value = &m_repository[m_ix];
     (*mp_value) = m_repository[a_ix]; 
 }
 
+/** Share a value from the repository with this data object. No copy
+    is made, the entry gets another reference instead. A write access
+    via var() will copy the value first (copy on write), free() only
+    drops the reference. */
+
+template <class T>
+void 
+data_type<T>::share(
+  ix_type a_ix
+)
+{
+    INVARIANT(a_ix!=g_column_ix,"column value has no repository entry");
+    discard();
+    if (a_ix!=get_default_ix()) m_repository.ref(a_ix);
+    load(a_ix);
+}
+
+/** Copy a value that is bound to a column (ColumnTable) into the
+    repository, so that get_ix() returns a valid repository index
+    (see record_type::store()). The column is not changed. */
+
+template <class T>
+void 
+data_type<T>::detach()
+{
+    decode();
+    if (m_ix==g_column_ix) allocate();
+}
+
 /** Free the data object. The value of the data object will be the
     default value afterwards. Depending on whether it is a shared
     field or not, the space in the repository will be freed or not. */
@@ -219,6 +440,8 @@ template <class T>
 void 
 data_type<T>::free() 
 {
+    discard();
+    if (m_ix==g_column_ix) { load_default(); return; } // Spalte gehoert der Tabelle
     if (!is_default())
     { 
 	if (is_shared())
@@ -239,6 +462,7 @@ data_type<T>::free(
     ix_type a_ix
     ) 
 {
+    if (a_ix==g_column_ix) { if (m_ix==a_ix) load_default(); return; }
     if (a_ix!=get_default_ix())
     {
 	if (is_shared())
@@ -282,6 +506,19 @@ data_type<T>::store
   return m_repository.insert(x); 
 }
 
+/** Create an empty column for values of this data type (used by
+    ColumnTable). */
+
+template <class T>
+abstract_column*
+data_type<T>::new_column
+  (
+  ) 
+const
+  {
+  return new column_type<T>;
+  }
+
 /** Output for debugging purposes. */
 
 template <class T>
@@ -300,7 +537,9 @@ const
 
 /** Setting the global default value. This static method should be
     called once (globdef.cpp) to initialize the global default
-    value. (g_illegal_ix for index fields, 0 for integer, etc.) */
+    value. (g_illegal_ix for index fields, 0 for integer, etc.) It
+    sets the default of the global repository context; contexts
+    created afterwards copy it. */
 
 template <class T>
 void
@@ -309,16 +548,8 @@ data_type<T>::set_global_default
   const T& a_default
   )
   { 
-  // Wenn noch kein g_global_default existiert (noch keine Instanz
-  // zuvor erzeugt), dann erstellen
-  if (m_global_default_ix==g_illegal_ix)
-    {
-    m_global_default_ix = m_repository.insert(a_default); 
-    }
-  else
-    {
-    m_repository[m_global_default_ix]=a_default; 
-    }
+  RepositoryContext::entry_type& e = entry(RepositoryContext::global());
+  (*(Repository<T>*)e.mp_repository)[e.m_default_ix]=a_default; 
   }
 
 /** Setting the context-specific default value. If the data object
@@ -369,7 +600,8 @@ field_type<T>::field_type(
   const string name, ///< name of the field
   Domain *d=gp_dm_numeric ///< domain of the field
   )
-  : data_type<T>(new Context(Context::FIELD,mode,name,name,name,d))
+  : data_type<T>(new Context(Context::FIELD,mode,name,name,name,d),
+		 (ap_table!=NULL)?ap_table->repositories():NULL)
   , m_io(context()->domain())
 {
   if (ap_table!=NULL)
@@ -392,7 +624,8 @@ field_type<T>::field_type
   const string outtag, ///< tag to be used for output
   Domain *d=gp_dm_numeric ///< domain of the field
   ) 
-  : data_type<T>(new Context(Context::FIELD,mode,name,intag,outtag,d))
+  : data_type<T>(new Context(Context::FIELD,mode,name,intag,outtag,d),
+		 (ap_table!=NULL)?ap_table->repositories():NULL)
   , m_io(context()->domain())
   {
   if (ap_table!=NULL)
@@ -440,7 +673,7 @@ field_type<T>::read
   const matrix_separators* p_sep
   )
   {
-  static DynMatrix<T> tmp; 
+  DynMatrix<T>& tmp = m_buffer; 
   matrix_read_dim(is,tmp,m_io,p_sep);
 
   if (mp_context->select().size()==0)
@@ -461,7 +694,7 @@ field_type<T>::read
   const matrix_separators* p_sep
   )
   {
-  static DynMatrix<T> tmp; 
+  DynMatrix<T>& tmp = m_buffer; 
 
   // Wann soll das Lesen eines (symbolischen) Labels abgebrochen
   // werden? (noetig bei (a b), hier soll bspw. das "b" als Label
@@ -552,6 +785,33 @@ const
   os << operator()();
 }
 
+template <class T>
+string
+field_type<T>::binary_kind() const
+{
+  return binary_tag((const T*)NULL);
+}
+
+template <class T>
+void
+field_type<T>::write_binary(string& a_buffer) const
+{
+  append_binary(a_buffer,val());
+}
+
+/** Auslesen aus dem Binaerformat. Label werden ggf. ueber \c ap_map
+    in die Numerierung der eigenen Domain umgesetzt. */
+
+template <class T>
+const char*
+field_type<T>::read_binary(const char* p,const label_map_type* ap_map)
+{
+  T& x = var();
+  p = extract_binary(p,x);
+  translate_label(x,ap_map);
+  return p;
+}
+
 ////////////////////////////////////////////////////////////////////
 // array_type<T>
 
@@ -564,7 +824,8 @@ array_type<T>::array_type
   const string& name,
   Domain *d=gp_dm_numeric
   )
-  : data_type<T>(new Context(Context::MATVEC,mode,name,name,name,d))
+  : data_type<T>(new Context(Context::MATVEC,mode,name,name,name,d),
+		 (ap_table!=NULL)?ap_table->repositories():NULL)
   , m_io(context()->domain())
   {
   if (ap_table!=NULL)
@@ -592,6 +853,21 @@ array_type<T>::~array_type()
   delete mp_context;
   }
 
+/** Gelesenen Puffer in den Feldwert uebernehmen. Hat das Feld den
+    Typ des Puffers (DynMatrix), werden die Inhalte nur getauscht
+    (siehe DynMatrix::swap()), der Puffer erhaelt dabei den alten
+    Speicher des Feldes fuer den naechsten Record. Sonst (DynTuple)
+    wird kopiert. */
+
+template <class T>
+inline void 
+take_buffer(DynMatrix<T>& a_var,DynMatrix<T>& a_buffer)
+  { swap(a_var,a_buffer); }
+
+template <class V,class T>
+inline void 
+take_buffer(V& a_var,DynMatrix<T>& a_buffer)
+  { matrix_copy(a_var,a_buffer); }
 
 template <class T>
 void
@@ -600,11 +876,11 @@ array_type<T>::read(
   const matrix_separators* p_sep
   )
   {
-  static DynMatrix<typename T::value_type> tmp;
+  DynMatrix<typename T::value_type>& tmp = m_buffer;
   matrix_read_dim(is,tmp,m_io,p_sep);
 
   if (mp_context->select().size()==0)
-    matrix_copy(var(),tmp);
+    take_buffer(var(),tmp);
   else
     matrix_copy(var(),SelectTuple< DynMatrix<typename T::value_type>,DynMatrix<int> >(tmp,mp_context->select()));
   }
@@ -645,6 +921,46 @@ array_type<T>::write
   matrix_write_dim(os,operator()(),m_io,p_sep);
   }
 
+template <class T>
+string
+array_type<T>::binary_kind() const
+  {
+  string kind("M");
+  return kind+binary_tag((const typename T::value_type*)NULL);
+  }
+
+/** Binaerformat: Zeilen- und Spaltenzahl, dann die Werte
+    zeilenweise. */
+
+template <class T>
+void
+array_type<T>::write_binary(string& a_buffer) const
+  {
+  const T& x = val();
+  int r = x.rows(), c = x.cols();
+  append_binary(a_buffer,r); append_binary(a_buffer,c);
+  for (int i=0;i<r;++i) 
+    for (int j=0;j<c;++j) 
+      append_binary(a_buffer,x(i,j));
+  }
+
+template <class T>
+const char*
+array_type<T>::read_binary(const char* p,const label_map_type* ap_map)
+  {
+  int r,c;
+  p = extract_binary(p,r); p = extract_binary(p,c);
+  T& x = var();
+  x.adjust(r,c);
+  for (int i=0;i<r;++i) 
+    for (int j=0;j<c;++j) 
+      {
+      p = extract_binary(p,x(i,j));
+      translate_label(x(i,j),ap_map);
+      }
+  return p;
+  }
+
 }; // namespace
 
 #endif // DATATYPE_SOURCE
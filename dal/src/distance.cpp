@@ -23,10 +23,579 @@
 #ifndef DISTANCE_SOURCE
 #define DISTANCE_SOURCE
 
+#include <algorithm>
+#include <math.h>
+#include <float.h> // DBL_EPSILON
+#include <unistd.h> // sysconf
+#include <stdlib.h> // getenv
 #include "algorithm.hpp"
+#include "logtrace.h"
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#endif
 
 namespace Data_Analysis_Library {
 
+///////////////////////////////////////////////////////////////////
+////////////////////// DISTANCE KERNELS ///////////////////////////
+///////////////////////////////////////////////////////////////////
+
+/* Each kernel set provides five primitives: squared distance (also
+   with early abandoning), dot product, the 4x4 dot products of four
+   vectors x with four vectors y (for kernel_square_distance_block())
+   and squared distance to a scaled vector. The bounded squared distance accumulates in the same
+   order as the unbounded one and compares the partial sum with the
+   bound after every 16 coordinates. As all summands are non-negative,
+   the partial sum never exceeds the final sum. The vectorized
+   versions are compiled with the gcc target attribute, such that the
+   rest of the library does not require these instruction sets. */
+
+static double 
+scalar_sqdist(const double* x,const double* y,int n)
+{
+    double d = 0;
+    for (int i=0;i<n;++i) { double h=x[i]-y[i]; d+=h*h; }
+    return d;
+}
+
+static double 
+scalar_sqdist_bounded(const double* x,const double* y,int n,double bound)
+{
+    double d = 0;
+    for (int i=0;i<n;)
+    {
+	for (int e=min(i+16,n);i<e;++i) { double h=x[i]-y[i]; d+=h*h; }
+	if (d>bound) return d;
+    }
+    return d;
+}
+
+static double 
+scalar_dot(const double* x,const double* y,int n)
+{
+    double d = 0;
+    for (int i=0;i<n;++i) d+=x[i]*y[i];
+    return d;
+}
+
+/* The 4x4 kernels compute R[a*ldr+b] = x_a^T y_b for the vectors x_a
+   = X+a*n and y_b = Y+b*n (a,b=0..3). Every coordinate is loaded once
+   for four products. */
+
+static void
+scalar_dot4x4(const double* X,const double* Y,int n,double* R,int ldr)
+{
+    double r[16] = { 0 };
+    for (int k=0;k<n;++k)
+	for (int a=0;a<4;++a)
+	{
+	    double x = X[a*n+k];
+	    for (int b=0;b<4;++b) r[a*4+b]+=x*Y[b*n+k];
+	}
+    for (int a=0;a<4;++a)
+	for (int b=0;b<4;++b) R[a*ldr+b]=r[a*4+b];
+}
+
+static double 
+scalar_sqdist_scaled(const double* x,const double* y,double s,int n)
+{
+    double d = 0;
+    for (int i=0;i<n;++i) { double h=x[i]-s*y[i]; d+=h*h; }
+    return d;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DAL_KERNEL_X86
+
+static __attribute__((target("sse2"))) double 
+sse2_sqdist(const double* x,const double* y,int n)
+{
+    __m128d a0=_mm_setzero_pd(),a1=_mm_setzero_pd();
+    int i=0;
+    for (;i+4<=n;i+=4)
+    {
+	__m128d h0=_mm_sub_pd(_mm_loadu_pd(x+i),_mm_loadu_pd(y+i));
+	__m128d h1=_mm_sub_pd(_mm_loadu_pd(x+i+2),_mm_loadu_pd(y+i+2));
+	a0=_mm_add_pd(a0,_mm_mul_pd(h0,h0));
+	a1=_mm_add_pd(a1,_mm_mul_pd(h1,h1));
+    }
+    double r[2]; _mm_storeu_pd(r,_mm_add_pd(a0,a1));
+    double d = r[0]+r[1];
+    for (;i<n;++i) { double h=x[i]-y[i]; d+=h*h; }
+    return d;
+}
+
+static __attribute__((target("sse2"))) double 
+sse2_sqdist_bounded(const double* x,const double* y,int n,double bound)
+{
+    __m128d a0=_mm_setzero_pd(),a1=_mm_setzero_pd();
+    double r[2];
+    int i=0;
+    for (;i+4<=n;i+=4)
+    {
+	__m128d h0=_mm_sub_pd(_mm_loadu_pd(x+i),_mm_loadu_pd(y+i));
+	__m128d h1=_mm_sub_pd(_mm_loadu_pd(x+i+2),_mm_loadu_pd(y+i+2));
+	a0=_mm_add_pd(a0,_mm_mul_pd(h0,h0));
+	a1=_mm_add_pd(a1,_mm_mul_pd(h1,h1));
+	if (((i+4)&15)==0)
+	{
+	    _mm_storeu_pd(r,_mm_add_pd(a0,a1));
+	    if (r[0]+r[1]>bound) return r[0]+r[1];
+	}
+    }
+    _mm_storeu_pd(r,_mm_add_pd(a0,a1));
+    double d = r[0]+r[1];
+    for (;i<n;++i) { double h=x[i]-y[i]; d+=h*h; }
+    return d;
+}
+
+static __attribute__((target("sse2"))) double 
+sse2_dot(const double* x,const double* y,int n)
+{
+    __m128d a0=_mm_setzero_pd(),a1=_mm_setzero_pd();
+    int i=0;
+    for (;i+4<=n;i+=4)
+    {
+	a0=_mm_add_pd(a0,_mm_mul_pd(_mm_loadu_pd(x+i),_mm_loadu_pd(y+i)));
+	a1=_mm_add_pd(a1,_mm_mul_pd(_mm_loadu_pd(x+i+2),_mm_loadu_pd(y+i+2)));
+    }
+    double r[2]; _mm_storeu_pd(r,_mm_add_pd(a0,a1));
+    double d = r[0]+r[1];
+    for (;i<n;++i) d+=x[i]*y[i];
+    return d;
+}
+
+/* SSE2 and AVX2: two passes with 4x2 accumulators each (the x
+   vectors are loaded twice), such that all registers fit into the 16
+   vector registers. The loops are unrolled by hand to keep the
+   accumulators in registers. */
+
+static __attribute__((target("sse2"))) void
+sse2_dot4x4(const double* X,const double* Y,int n,double* R,int ldr)
+{
+    const double *x0=X,*x1=X+n,*x2=X+2*n,*x3=X+3*n;
+    for (int b=0;b<4;b+=2)
+    {
+	const double *y0=Y+b*n,*y1=y0+n;
+	__m128d a00=_mm_setzero_pd(),a01=a00,a10=a00,a11=a00;
+	__m128d a20=a00,a21=a00,a30=a00,a31=a00;
+	int k=0;
+	for (;k+2<=n;k+=2)
+	{
+	    __m128d v0=_mm_loadu_pd(y0+k),v1=_mm_loadu_pd(y1+k),u;
+	    u=_mm_loadu_pd(x0+k);
+	    a00=_mm_add_pd(a00,_mm_mul_pd(u,v0)); a01=_mm_add_pd(a01,_mm_mul_pd(u,v1));
+	    u=_mm_loadu_pd(x1+k);
+	    a10=_mm_add_pd(a10,_mm_mul_pd(u,v0)); a11=_mm_add_pd(a11,_mm_mul_pd(u,v1));
+	    u=_mm_loadu_pd(x2+k);
+	    a20=_mm_add_pd(a20,_mm_mul_pd(u,v0)); a21=_mm_add_pd(a21,_mm_mul_pd(u,v1));
+	    u=_mm_loadu_pd(x3+k);
+	    a30=_mm_add_pd(a30,_mm_mul_pd(u,v0)); a31=_mm_add_pd(a31,_mm_mul_pd(u,v1));
+	}
+	__m128d a[8] = { a00,a01,a10,a11,a20,a21,a30,a31 };
+	for (int i=0;i<4;++i)
+	    for (int j=0;j<2;++j)
+	    {
+		double r[2]; _mm_storeu_pd(r,a[2*i+j]);
+		double d = r[0]+r[1];
+		if (k<n) d += X[i*n+k]*Y[(b+j)*n+k];
+		R[i*ldr+b+j] = d;
+	    }
+    }
+}
+
+static __attribute__((target("sse2"))) double 
+sse2_sqdist_scaled(const double* x,const double* y,double s,int n)
+{
+    __m128d a0=_mm_setzero_pd(),a1=_mm_setzero_pd(),f=_mm_set1_pd(s);
+    int i=0;
+    for (;i+4<=n;i+=4)
+    {
+	__m128d h0=_mm_sub_pd(_mm_loadu_pd(x+i),_mm_mul_pd(f,_mm_loadu_pd(y+i)));
+	__m128d h1=_mm_sub_pd(_mm_loadu_pd(x+i+2),_mm_mul_pd(f,_mm_loadu_pd(y+i+2)));
+	a0=_mm_add_pd(a0,_mm_mul_pd(h0,h0));
+	a1=_mm_add_pd(a1,_mm_mul_pd(h1,h1));
+    }
+    double r[2]; _mm_storeu_pd(r,_mm_add_pd(a0,a1));
+    double d = r[0]+r[1];
+    for (;i<n;++i) { double h=x[i]-s*y[i]; d+=h*h; }
+    return d;
+}
+
+/** Horizontal sum of four doubles. */
+
+static __attribute__((target("avx2"))) double 
+avx2_sum(__m256d a)
+{
+    __m128d s=_mm_add_pd(_mm256_castpd256_pd128(a),_mm256_extractf128_pd(a,1));
+    return _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+}
+
+static __attribute__((target("avx2,fma"))) double 
+avx2_sqdist(const double* x,const double* y,int n)
+{
+    __m256d a0=_mm256_setzero_pd(),a1=_mm256_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m256d h0=_mm256_sub_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i));
+	__m256d h1=_mm256_sub_pd(_mm256_loadu_pd(x+i+4),_mm256_loadu_pd(y+i+4));
+	a0=_mm256_fmadd_pd(h0,h0,a0);
+	a1=_mm256_fmadd_pd(h1,h1,a1);
+    }
+    if (i+4<=n)
+    {
+	__m256d h0=_mm256_sub_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i));
+	a0=_mm256_fmadd_pd(h0,h0,a0); i+=4;
+    }
+    double d = avx2_sum(_mm256_add_pd(a0,a1));
+    for (;i<n;++i) { double h=x[i]-y[i]; d+=h*h; }
+    return d;
+}
+
+static __attribute__((target("avx2,fma"))) double 
+avx2_sqdist_bounded(const double* x,const double* y,int n,double bound)
+{
+    __m256d a0=_mm256_setzero_pd(),a1=_mm256_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m256d h0=_mm256_sub_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i));
+	__m256d h1=_mm256_sub_pd(_mm256_loadu_pd(x+i+4),_mm256_loadu_pd(y+i+4));
+	a0=_mm256_fmadd_pd(h0,h0,a0);
+	a1=_mm256_fmadd_pd(h1,h1,a1);
+	if (((i+8)&15)==0)
+	{
+	    double d = avx2_sum(_mm256_add_pd(a0,a1));
+	    if (d>bound) return d;
+	}
+    }
+    if (i+4<=n)
+    {
+	__m256d h0=_mm256_sub_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i));
+	a0=_mm256_fmadd_pd(h0,h0,a0); i+=4;
+    }
+    double d = avx2_sum(_mm256_add_pd(a0,a1));
+    for (;i<n;++i) { double h=x[i]-y[i]; d+=h*h; }
+    return d;
+}
+
+static __attribute__((target("avx2,fma"))) double 
+avx2_dot(const double* x,const double* y,int n)
+{
+    __m256d a0=_mm256_setzero_pd(),a1=_mm256_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	a0=_mm256_fmadd_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i),a0);
+	a1=_mm256_fmadd_pd(_mm256_loadu_pd(x+i+4),_mm256_loadu_pd(y+i+4),a1);
+    }
+    if (i+4<=n)
+    { a0=_mm256_fmadd_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i),a0); i+=4; }
+    double d = avx2_sum(_mm256_add_pd(a0,a1));
+    for (;i<n;++i) d+=x[i]*y[i];
+    return d;
+}
+
+static __attribute__((target("avx2,fma"))) void
+avx2_dot4x4(const double* X,const double* Y,int n,double* R,int ldr)
+{
+    const double *x0=X,*x1=X+n,*x2=X+2*n,*x3=X+3*n;
+    for (int b=0;b<4;b+=2)
+    {
+	const double *y0=Y+b*n,*y1=y0+n;
+	__m256d a00=_mm256_setzero_pd(),a01=a00,a10=a00,a11=a00;
+	__m256d a20=a00,a21=a00,a30=a00,a31=a00;
+	int k=0;
+	for (;k+4<=n;k+=4)
+	{
+	    __m256d v0=_mm256_loadu_pd(y0+k),v1=_mm256_loadu_pd(y1+k),u;
+	    u=_mm256_loadu_pd(x0+k);
+	    a00=_mm256_fmadd_pd(u,v0,a00); a01=_mm256_fmadd_pd(u,v1,a01);
+	    u=_mm256_loadu_pd(x1+k);
+	    a10=_mm256_fmadd_pd(u,v0,a10); a11=_mm256_fmadd_pd(u,v1,a11);
+	    u=_mm256_loadu_pd(x2+k);
+	    a20=_mm256_fmadd_pd(u,v0,a20); a21=_mm256_fmadd_pd(u,v1,a21);
+	    u=_mm256_loadu_pd(x3+k);
+	    a30=_mm256_fmadd_pd(u,v0,a30); a31=_mm256_fmadd_pd(u,v1,a31);
+	}
+	__m256d a[8] = { a00,a01,a10,a11,a20,a21,a30,a31 };
+	for (int i=0;i<4;++i)
+	    for (int j=0;j<2;++j)
+	    {
+		double d = avx2_sum(a[2*i+j]);
+		for (int l=k;l<n;++l) d += X[i*n+l]*Y[(b+j)*n+l];
+		R[i*ldr+b+j] = d;
+	    }
+    }
+}
+
+static __attribute__((target("avx2,fma"))) double 
+avx2_sqdist_scaled(const double* x,const double* y,double s,int n)
+{
+    __m256d a0=_mm256_setzero_pd(),a1=_mm256_setzero_pd(),f=_mm256_set1_pd(s);
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m256d h0=_mm256_fnmadd_pd(f,_mm256_loadu_pd(y+i),_mm256_loadu_pd(x+i));
+	__m256d h1=_mm256_fnmadd_pd(f,_mm256_loadu_pd(y+i+4),_mm256_loadu_pd(x+i+4));
+	a0=_mm256_fmadd_pd(h0,h0,a0);
+	a1=_mm256_fmadd_pd(h1,h1,a1);
+    }
+    if (i+4<=n)
+    {
+	__m256d h0=_mm256_fnmadd_pd(f,_mm256_loadu_pd(y+i),_mm256_loadu_pd(x+i));
+	a0=_mm256_fmadd_pd(h0,h0,a0); i+=4;
+    }
+    double d = avx2_sum(_mm256_add_pd(a0,a1));
+    for (;i<n;++i) { double h=x[i]-s*y[i]; d+=h*h; }
+    return d;
+}
+
+/* AVX-512: the remainder is handled by masked loads (masked lanes
+   are zero and do not contribute). */
+
+static __attribute__((target("avx512f"))) double 
+avx512_sqdist(const double* x,const double* y,int n)
+{
+    __m512d a=_mm512_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m512d h=_mm512_sub_pd(_mm512_loadu_pd(x+i),_mm512_loadu_pd(y+i));
+	a=_mm512_fmadd_pd(h,h,a);
+    }
+    if (i<n)
+    {
+	__mmask8 m=(__mmask8)((1u<<(n-i))-1);
+	__m512d h=_mm512_sub_pd(_mm512_maskz_loadu_pd(m,x+i),_mm512_maskz_loadu_pd(m,y+i));
+	a=_mm512_fmadd_pd(h,h,a);
+    }
+    return _mm512_reduce_add_pd(a);
+}
+
+static __attribute__((target("avx512f"))) double 
+avx512_sqdist_bounded(const double* x,const double* y,int n,double bound)
+{
+    __m512d a=_mm512_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m512d h=_mm512_sub_pd(_mm512_loadu_pd(x+i),_mm512_loadu_pd(y+i));
+	a=_mm512_fmadd_pd(h,h,a);
+	if (((i+8)&15)==0)
+	{
+	    double d = _mm512_reduce_add_pd(a);
+	    if (d>bound) return d;
+	}
+    }
+    if (i<n)
+    {
+	__mmask8 m=(__mmask8)((1u<<(n-i))-1);
+	__m512d h=_mm512_sub_pd(_mm512_maskz_loadu_pd(m,x+i),_mm512_maskz_loadu_pd(m,y+i));
+	a=_mm512_fmadd_pd(h,h,a);
+    }
+    return _mm512_reduce_add_pd(a);
+}
+
+static __attribute__((target("avx512f"))) double 
+avx512_dot(const double* x,const double* y,int n)
+{
+    __m512d a=_mm512_setzero_pd();
+    int i=0;
+    for (;i+8<=n;i+=8)
+	a=_mm512_fmadd_pd(_mm512_loadu_pd(x+i),_mm512_loadu_pd(y+i),a);
+    if (i<n)
+    {
+	__mmask8 m=(__mmask8)((1u<<(n-i))-1);
+	a=_mm512_fmadd_pd(_mm512_maskz_loadu_pd(m,x+i),_mm512_maskz_loadu_pd(m,y+i),a);
+    }
+    return _mm512_reduce_add_pd(a);
+}
+
+/* AVX-512 has 32 vector registers, all 16 products in one pass. */
+
+static __attribute__((target("avx512f"))) void
+avx512_dot4x4(const double* X,const double* Y,int n,double* R,int ldr)
+{
+    const double *x0=X,*x1=X+n,*x2=X+2*n,*x3=X+3*n;
+    const double *y0=Y,*y1=Y+n,*y2=Y+2*n,*y3=Y+3*n;
+    __m512d a00=_mm512_setzero_pd(),a01=a00,a02=a00,a03=a00;
+    __m512d a10=a00,a11=a00,a12=a00,a13=a00,a20=a00,a21=a00,a22=a00,a23=a00;
+    __m512d a30=a00,a31=a00,a32=a00,a33=a00;
+    for (int k=0;k<n;k+=8)
+    {
+	__mmask8 m = (k+8<=n) ? (__mmask8)0xff : (__mmask8)((1u<<(n-k))-1);
+	__m512d v0=_mm512_maskz_loadu_pd(m,y0+k),v1=_mm512_maskz_loadu_pd(m,y1+k);
+	__m512d v2=_mm512_maskz_loadu_pd(m,y2+k),v3=_mm512_maskz_loadu_pd(m,y3+k),u;
+	u=_mm512_maskz_loadu_pd(m,x0+k);
+	a00=_mm512_fmadd_pd(u,v0,a00); a01=_mm512_fmadd_pd(u,v1,a01);
+	a02=_mm512_fmadd_pd(u,v2,a02); a03=_mm512_fmadd_pd(u,v3,a03);
+	u=_mm512_maskz_loadu_pd(m,x1+k);
+	a10=_mm512_fmadd_pd(u,v0,a10); a11=_mm512_fmadd_pd(u,v1,a11);
+	a12=_mm512_fmadd_pd(u,v2,a12); a13=_mm512_fmadd_pd(u,v3,a13);
+	u=_mm512_maskz_loadu_pd(m,x2+k);
+	a20=_mm512_fmadd_pd(u,v0,a20); a21=_mm512_fmadd_pd(u,v1,a21);
+	a22=_mm512_fmadd_pd(u,v2,a22); a23=_mm512_fmadd_pd(u,v3,a23);
+	u=_mm512_maskz_loadu_pd(m,x3+k);
+	a30=_mm512_fmadd_pd(u,v0,a30); a31=_mm512_fmadd_pd(u,v1,a31);
+	a32=_mm512_fmadd_pd(u,v2,a32); a33=_mm512_fmadd_pd(u,v3,a33);
+    }
+    __m512d a[16] = { a00,a01,a02,a03,a10,a11,a12,a13,
+		      a20,a21,a22,a23,a30,a31,a32,a33 };
+    for (int i=0;i<4;++i)
+	for (int j=0;j<4;++j) R[i*ldr+j]=_mm512_reduce_add_pd(a[4*i+j]);
+}
+
+static __attribute__((target("avx512f"))) double 
+avx512_sqdist_scaled(const double* x,const double* y,double s,int n)
+{
+    __m512d a=_mm512_setzero_pd(),f=_mm512_set1_pd(s);
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+	__m512d h=_mm512_fnmadd_pd(f,_mm512_loadu_pd(y+i),_mm512_loadu_pd(x+i));
+	a=_mm512_fmadd_pd(h,h,a);
+    }
+    if (i<n)
+    {
+	__mmask8 m=(__mmask8)((1u<<(n-i))-1);
+	__m512d h=_mm512_fnmadd_pd(f,_mm512_maskz_loadu_pd(m,y+i),_mm512_maskz_loadu_pd(m,x+i));
+	a=_mm512_fmadd_pd(h,h,a);
+    }
+    return _mm512_reduce_add_pd(a);
+}
+
+#endif // DAL_KERNEL_X86
+
+/** Selected kernel set. */
+
+struct kernel_table
+{
+    const char *mp_name;
+    double (*mp_sqdist)(const double*,const double*,int);
+    double (*mp_sqdist_bounded)(const double*,const double*,int,double);
+    double (*mp_dot)(const double*,const double*,int);
+    void (*mp_dot4x4)(const double*,const double*,int,double*,int);
+    double (*mp_sqdist_scaled)(const double*,const double*,double,int);
+};
+
+/** Choose the best kernel set supported by the processor (and
+    permitted by \c DAL_KERNEL). */
+
+static kernel_table
+select_kernels()
+{
+    kernel_table k = { "scalar", &scalar_sqdist, &scalar_sqdist_bounded,
+			  &scalar_dot, &scalar_dot4x4, &scalar_sqdist_scaled };
+#ifdef DAL_KERNEL_X86
+    const char *p = getenv("DAL_KERNEL");
+    string limit = (p==NULL) ? "avx512" : p;
+    __builtin_cpu_init();
+    if ((limit=="scalar")||(!__builtin_cpu_supports("sse2"))) return k;
+    kernel_table sse2 = { "sse2", &sse2_sqdist, &sse2_sqdist_bounded,
+			  &sse2_dot, &sse2_dot4x4, &sse2_sqdist_scaled };
+    k = sse2;
+    if ((limit=="sse2")||(!__builtin_cpu_supports("avx2"))||(!__builtin_cpu_supports("fma"))) return k;
+    kernel_table avx2 = { "avx2", &avx2_sqdist, &avx2_sqdist_bounded,
+			  &avx2_dot, &avx2_dot4x4, &avx2_sqdist_scaled };
+    k = avx2;
+    if ((limit=="avx2")||(!__builtin_cpu_supports("avx512f"))) return k;
+    kernel_table avx512 = { "avx512", &avx512_sqdist, &avx512_sqdist_bounded,
+			  &avx512_dot, &avx512_dot4x4, &avx512_sqdist_scaled };
+    k = avx512;
+#endif
+    return k;
+}
+
+static const kernel_table g_kernel = select_kernels();
+
+double 
+kernel_square_distance(const double* x,const double* y,int n)
+{ return (*g_kernel.mp_sqdist)(x,y,n); }
+
+double 
+kernel_square_distance_bounded(const double* x,const double* y,int n,double bound)
+{ return (*g_kernel.mp_sqdist_bounded)(x,y,n,bound); }
+
+double 
+kernel_dot_product(const double* x,const double* y,int n)
+{ return (*g_kernel.mp_dot)(x,y,n); }
+
+/** The reference vectors are processed in tiles of 64 vectors, which
+    stay in the cache while all query vectors pass by. Within a tile
+    blocks of 4x4 dot products are computed by the 4x4 kernel, the
+    remaining rows and columns by the dot product kernel. */
+
+void
+kernel_square_distance_block(
+    const double* X,
+    const double* xx,
+    int m,
+    const double* Y,
+    const double* yy,
+    int l,
+    int n,
+    double* D
+    )
+{
+    const int tile = 64;
+
+    for (int i0=0;i0<m;i0+=tile)
+    {
+	const int i1 = min(i0+tile,m);
+	for (int j0=0;j0<l;j0+=tile)
+	{
+	    const int j1 = min(j0+tile,l);
+	    for (int i=i0;i<i1;i+=4)
+		for (int j=j0;j<j1;j+=4)
+		    if ((i+4<=i1)&&(j+4<=j1))
+			(*g_kernel.mp_dot4x4)(X+i*n,Y+j*n,n,D+i*l+j,l);
+		    else
+			for (int a=i;a<min(i+4,i1);++a)
+			    for (int b=j;b<min(j+4,j1);++b)
+				D[a*l+b] = (*g_kernel.mp_dot)(X+a*n,Y+b*n,n);
+	}
+    }
+
+    for (int i=0;i<m;++i)
+	for (int j=0;j<l;++j) D[i*l+j] = xx[i]+yy[j]-2*D[i*l+j];
+}
+
+/** If \c y is zero, the scale factor is undefined (NaN, like in the
+    formula). */
+
+double 
+kernel_scaled_distance(const double* x,const double* y,int n,double& s)
+{
+    s = (*g_kernel.mp_dot)(x,y,n) / (*g_kernel.mp_dot)(y,y,n);
+    return (*g_kernel.mp_sqdist_scaled)(x,y,s,n);
+}
+
+/** The difference vector is kept on the stack for up to 64
+    dimensions. */
+
+double 
+kernel_quadratic_form(const double* x,const double* y,const double* A,int n)
+{
+    double local[64];
+    vector<double> buffer;
+    double *diff = local;
+    if (n>64) { buffer.resize(n); diff = &buffer[0]; }
+    for (int i=0;i<n;++i) diff[i]=x[i]-y[i];
+
+    double d = 0;
+    for (int i=0;i<n;++i) d += diff[i]*(*g_kernel.mp_dot)(A+i*n,diff,n);
+    return d;
+}
+
+const char* 
+kernel_name()
+{ return g_kernel.mp_name; }
+
 ///////////////////////////////////////////////////////////////////
 
 /** \class EuclideanDistance
@@ -41,7 +610,9 @@ EuclideanDistance::step()
 {
     LOG_METHOD("DAA","EuclideanDistance","step","");
 
-    mp_dist->var() = matrix_square_distance((*mp_x)(),(*mp_y)());
+    const tuple_type::value_type &x=mp_x->val(),&y=mp_y->val();
+    INVARIANT(x.rows()<=y.rows(),"operation assumes relaxed matrix dimensions");
+    mp_dist->var() = kernel_square_distance(x.data(),y.data(),x.rows());
     TRACE_ID("distance",(*mp_dist)()<<"= eucldist("<<
 	     (*mp_x)()<<","<<(*mp_y)()<<")");
 
@@ -49,18 +620,841 @@ EuclideanDistance::step()
 }
 
 ////////////////////////////////////////////////////////////////
-#ifdef NOTYET
+
+/** \class NearestNeighbour
+    \brief Nearest neighbour query using a k-d tree.
+
+    Replaces the nested loop
+
+\code
+      embed_loop(fetch(&train),
+                 euclidsqdist(&dist,&trainvalue,&value),
+                 selectmin(&dist,&trainlabel,&label,succ))
+\endcode
+
+    by a single one-step algorithm. In init() the table \c t is read
+    once and the vectors \c trainvalue are stored in a k-d tree
+    together with the labels \c trainlabel. Every step() call then
+    determines the training vector with minimal distance to \c x,
+    stores its label in \c retval and the distance in \c d, and calls
+    the step() method of the successor (as FilterExtremum does in its
+    done() method). The result is the same as with the nested loop:
+    in case of ties the first record of the training table wins.
+    Records with undefined \c trainvalue are ignored, all others must
+    have the same dimension, and so must every query \c x (otherwise
+    the program stops with an error). The tree is rebuilt whenever init() is
+    called, i.e.\ if the training table is iterated (see
+    iterate_algorithm()) the current subset is used.
+
+    If \c k is given, the \c k nearest training vectors vote for the
+    label (ties are broken in favour of the label of the nearer
+    vector). If \c w is true, each vote is weighted by the inverse
+    squared distance \f$ 1/\|x-y\|^2 \f$ (the distance itself is
+    never computed); training vectors with distance zero then outvote
+    all others. In \c d the distance of the nearest vector with the
+    predicted label is returned.
+
+    Within a leaf of the tree the distance to a candidate is computed
+    with kernel_square_distance_bounded(), i.e.\ the summation stops
+    as soon as the candidate cannot beat the k-th best neighbour found
+    so far. Unless \c r is false, the coordinates are reordered by
+    decreasing variance of the training vectors beforehand, such that
+    most candidates are rejected after a small part of the
+    coordinates (which pays off for high-dimensional data). Only the
+    order of summation changes, not the result (up to rounding).
+
+    In high dimensions (16 or more, Euclidean distance only) the k-d
+    tree has to visit most of the leaves anyway. Then the queries of
+    BlockNearestNeighbour are not searched in the tree one by one, but
+    the distances of a whole block of queries to all training vectors
+    are computed as a matrix product (see kernel_square_distance_block()
+    and the blockwise classify()), which uses the processor much better
+    than one distance calculation after the other. The predictions
+    and distances are the same in both cases (up to rounding: the
+    candidates are only selected within the heuristic tolerance \c
+    tol of the blockwise classify(), so in a near-tie at the k-th
+    neighbour the other vector may win). If \c b is false, the tree
+    is searched in any dimension.
+
+    If \c scaled is false (nearest()), the squared Euclidean distance
+    of EuclideanDistance is used. If \c scaled is true (snearest()),
+    the distance of ScaledEuclideanDistance is used, where the
+    training vector \c y is scaled to fit \c x best: \f$ \min_s
+    \|x-sy\|^2 = \|x\|^2 \sin^2 \angle(x,y) \f$. In this case the tree
+    contains the normalized training vectors \f$ u=y/\|y\| \f$ and is
+    searched for \f$ \pm x/\|x\| \f$, because \f$ \|x/\|x\|-u\|^2 = e
+    \f$ yields \f$ \sin^2 \angle(x,y) = e(1-e/4) \f$. Training vectors
+    of length zero are ignored. */
+
+template <class T>
+void
+NearestNeighbour<T>::init()
+{
+    LOG_METHOD("DAA","NearestNeighbour","init",mp_table->context()->name());
+
+    m_k = (mp_k==NULL) ? 1 : mp_k->val();
+    if (m_k<1) { WARNING("k="<<m_k<<" replaced by k=1"); m_k=1; }
+    m_weighted = (mp_weighted!=NULL)&&(mp_weighted->val()!=0);
+    m_reorder = (mp_reorder==NULL)||(mp_reorder->val()!=0);
+
+    build();
+    if (mp_filtered!=NULL) mp_filtered->init();
+}
+
+/** Read training table and build the k-d tree. */
+
+template <class T>
+void
+NearestNeighbour<T>::build()
+{
+    LOG_METHOD("DAA","NearestNeighbour","build",mp_table->context()->name());
+
+    const int blockwise_dim = 16; // siehe m_blockwise
+
+    m_dim = -1;
+    m_points.clear(); m_record.clear(); m_labels.clear(); m_nodes.clear();
+
+    int skipped = 0;
+    mp_table->rewind();
+    while (!mp_table->done())
+    {
+	mp_table->pop();
+	m_labels.push_back(mp_trainlabel->val());
+	if (mp_trainvalue->is_default()) { ++skipped; continue; }
+
+	const tuple_type::value_type& y = mp_trainvalue->val();
+	if (m_dim<0) m_dim = y.rows();
+	if (y.rows()!=m_dim)
+	{
+	    ERROR("record "<<m_labels.size()<<" of "<<mp_table->context()->name()
+		  <<" has dimension "<<y.rows()<<" instead of "<<m_dim);
+	    exit(-1);
+	}
+
+	double n = 1.0;
+	if (m_scaled)
+	{
+	    double sq = matrix_square_norm(y);
+	    if (sq==0) { ++skipped; continue; }
+	    n = 1.0/sqrt(sq);
+	}
+	for (int i=0;i<m_dim;++i) m_points.push_back(y(i)*n);
+	m_record.push_back(m_labels.size()-1);
+    }
+    if (skipped>0)
+	WARNING(skipped<<" records of "<<mp_table->context()->name()
+		<<" ignored for nearest neighbour search");
+
+    // Koordinaten nach fallender Varianz ordnen
+    m_order.clear();
+    if (m_reorder && (m_dim>1)) reorder();
+
+    // Baum ueber eine Permutation der Punkte aufbauen
+    vector<int> perm(m_record.size());
+    for (word i=0;i<perm.size();++i) perm[i]=i;
+    if (!perm.empty()) build(perm,0,perm.size());
+
+    // Punkte in Blatt-Reihenfolge umkopieren (zusammenhaengend je Blatt)
+    vector<double> points(m_points.size());
+    vector<int> record(m_record.size());
+    for (word i=0;i<perm.size();++i)
+    {
+	copy(m_points.begin()+perm[i]*m_dim,m_points.begin()+(perm[i]+1)*m_dim,
+	     points.begin()+i*m_dim);
+	record[i] = m_record[perm[i]];
+    }
+    m_points.swap(points);
+    m_record.swap(record);
+
+    // hochdimensional: Bloecke von Anfragen ohne Baum (siehe classify())
+    m_blockwise = (!m_scaled) && (m_dim>=blockwise_dim)
+	&& ((mp_blockwise==NULL)||(mp_blockwise->val()!=0));
+    m_mean.clear(); m_centered.clear(); m_centered_norm.clear();
+    if (m_blockwise)
+    {
+	const int n = m_record.size();
+	m_mean.assign(m_dim,0.0);
+	for (int i=0;i<n;++i)
+	    for (int d=0;d<m_dim;++d) m_mean[d]+=m_points[i*m_dim+d];
+	for (int d=0;d<m_dim;++d) if (n>0) m_mean[d]/=n;
+	m_centered.resize(m_points.size());
+	m_centered_norm.resize(n);
+	for (int i=0;i<n;++i)
+	{
+	    double *c = &m_centered[i*m_dim];
+	    for (int d=0;d<m_dim;++d) c[d]=m_points[i*m_dim+d]-m_mean[d];
+	    m_centered_norm[i] = kernel_dot_product(c,c,m_dim);
+	}
+    }
+
+    INFO("nearest neighbour index: "<<m_record.size()<<" vectors, dimension "
+	 <<m_dim<<", "<<m_nodes.size()<<" nodes, "<<kernel_name()<<" kernels"
+	 <<(m_order.empty() ? "" : ", coordinates ordered by variance")
+	 <<(m_blockwise ? ", blockwise search" : ""));
+}
+
+/** Order coordinates by variance (see m_order). */
+
+struct variance_greater
+{
+    inline variance_greater(const vector<double>& v) : m_var(v) {}
+    inline bool operator()(int a,int b) const
+	{ return m_var[a] > m_var[b]; }
+    const vector<double>& m_var;
+};
+
+/** Permute the coordinates of all points in m_points by decreasing
+    variance and store the permutation in m_order. The distance
+    computation in search() then visits the most discriminating
+    coordinates first and abandons most candidates after a few of
+    them. */
+
+template <class T>
+void
+NearestNeighbour<T>::reorder()
+{
+    const int n = m_record.size();
+    if (n<2) return;
+
+    vector<double> mean(m_dim,0.0),var(m_dim,0.0);
+    for (int i=0;i<n;++i)
+	for (int d=0;d<m_dim;++d) mean[d]+=m_points[i*m_dim+d];
+    for (int d=0;d<m_dim;++d) mean[d]/=n;
+    for (int i=0;i<n;++i)
+	for (int d=0;d<m_dim;++d)
+	{ double h=m_points[i*m_dim+d]-mean[d]; var[d]+=h*h; }
+
+    m_order.resize(m_dim);
+    for (int d=0;d<m_dim;++d) m_order[d]=d;
+    stable_sort(m_order.begin(),m_order.end(),variance_greater(var));
+
+    vector<double> point(m_dim);
+    for (int i=0;i<n;++i)
+    {
+	double *p = &m_points[i*m_dim];
+	for (int d=0;d<m_dim;++d) point[d]=p[m_order[d]];
+	copy(point.begin(),point.end(),p);
+    }
+}
+
+/** Order points by one coordinate (for nth_element). */
+
+struct coordinate_less
+{
+    inline coordinate_less(const vector<double>& p,int dim,int axis)
+	: m_points(p), m_dim(dim), m_axis(axis) {}
+    inline bool operator()(int a,int b) const
+	{ return m_points[a*m_dim+m_axis] < m_points[b*m_dim+m_axis]; }
+    const vector<double>& m_points;
+    int m_dim,m_axis;
+};
+
+/** Build subtree for points \c a_perm[a_first..a_last) and return
+    its node number. The points are split at the median of the axis
+    with the largest spread. */
+
+template <class T>
+int
+NearestNeighbour<T>::build(
+    vector<int>& a_perm,
+    int a_first,
+    int a_last
+    )
+{
+    const int leafsize = 16;
+
+    int n = m_nodes.size();
+    m_nodes.push_back(node_type());
+    m_nodes[n].m_axis = -1;
+    m_nodes[n].m_first = a_first;
+    m_nodes[n].m_last = a_last;
+    if (a_last-a_first<=leafsize) return n;
+
+    int axis=0; double spread=-1;
+    for (int d=0;d<m_dim;++d)
+    {
+	double lo=m_points[a_perm[a_first]*m_dim+d],hi=lo;
+	for (int i=a_first+1;i<a_last;++i)
+	{
+	    double v = m_points[a_perm[i]*m_dim+d];
+	    if (v<lo) lo=v; else if (v>hi) hi=v;
+	}
+	if (hi-lo>spread) { spread=hi-lo; axis=d; }
+    }
+    if (spread<=0) return n; // alle Punkte gleich
+
+    int mid = (a_first+a_last)/2;
+    nth_element(a_perm.begin()+a_first,a_perm.begin()+mid,
+		a_perm.begin()+a_last,coordinate_less(m_points,m_dim,axis));
+
+    m_nodes[n].m_axis = axis;
+    m_nodes[n].m_split = m_points[a_perm[mid]*m_dim+axis];
+    int l = build(a_perm,a_first,mid);
+    m_nodes[n].m_left = l;
+    int r = build(a_perm,mid,a_last);
+    m_nodes[n].m_right = r;
+    return n;
+}
+
+/** Search subtree \c a_node for the m_k points nearest to \c
+    a_query. The list \c a_best holds the neighbours found so far,
+    ordered by distance and record number, only distances below \c
+    a_limit are considered. A subtree is skipped only if the distance
+    to its splitting plane exceeds the current bound, such that a
+    point with equal distance but smaller record number is still
+    found. The method does not modify the tree and may be called by
+    several threads. */
+
+template <class T>
+void
+NearestNeighbour<T>::search(
+    int a_node,
+    const double* a_query,
+    double a_limit,
+    vector<neighbour_type>& a_best
+    ) const
+{
+    const node_type& node = m_nodes[a_node];
+    if (node.m_axis<0)
+    {
+	const double *p = &m_points[node.m_first*m_dim];
+	for (int i=node.m_first;i<node.m_last;++i,p+=m_dim)
+	{
+	    bool full = ((int)a_best.size()==m_k);
+	    double bound = full ? a_best.back().first : a_limit;
+	    double d = kernel_square_distance_bounded(p,a_query,m_dim,bound);
+	    if (d>=a_limit) continue;
+	    neighbour_type c(d,m_record[i]);
+	    if (full && !(c<a_best.back())) continue;
+
+	    // im skalierten Fall wird jeder Punkt zweimal (+x,-x) gefunden
+	    typename vector<neighbour_type>::iterator n = a_best.end();
+	    if (m_scaled)
+		for (n=a_best.begin();n!=a_best.end();++n)
+		    if (n->second==c.second) break;
+	    if (n!=a_best.end())
+	    { if (c<*n) a_best.erase(n); else continue; }
+	    else if (full) a_best.pop_back();
+	    a_best.insert(upper_bound(a_best.begin(),a_best.end(),c),c);
+	}
+	return;
+    }
+
+    double h = a_query[node.m_axis]-node.m_split;
+    int nearer = (h<0) ? node.m_left : node.m_right;
+    int farther = (h<0) ? node.m_right : node.m_left;
+    search(nearer,a_query,a_limit,a_best);
+    double bound = ((int)a_best.size()==m_k) ? a_best.back().first : a_limit;
+    if (h*h<=bound) search(farther,a_query,a_limit,a_best);
+}
+
+/** Determine the k nearest neighbours of \c a_x and let them vote.
+    Returns the record number of the predicted label (-1 if there is
+    none) and its distance in \c a_dist. Thread-safe, see search(). */
+
+template <class T>
+int
+NearestNeighbour<T>::classify(
+    const tuple_type::value_type& a_x,
+    double& a_dist
+    ) const
+{
+    if (m_record.empty()) return -1;
+    if (a_x.rows()!=m_dim)
+    {
+	ERROR("query vector has dimension "<<a_x.rows()<<" instead of "<<m_dim);
+	exit(-1);
+    }
+
+    // Koordinaten in der Reihenfolge des Baums (siehe build())
+    vector<double> query(m_dim);
+    for (int i=0;i<m_dim;++i) query[i] = a_x(m_order.empty() ? i : m_order[i]);
+
+    vector<neighbour_type> best; best.reserve(m_k+1);
+    double sq = 0;
+    if (!m_scaled)
+    {
+	search(0,&query[0],POS_IMPOSSIBLE_RANGE,best);
+    }
+    else
+    {
+	sq = kernel_dot_product(&query[0],&query[0],m_dim);
+	if (sq==0)
+	{
+	    // jeder Vektor hat Abstand 0, die ersten k Records gewinnen
+	    vector<int> first(m_record);
+	    sort(first.begin(),first.end());
+	    for (int i=0;(i<m_k)&&(i<(int)first.size());++i)
+		best.push_back(neighbour_type(0,first[i]));
+	}
+	else
+	{
+	    double n = 1.0/sqrt(sq);
+	    for (int i=0;i<m_dim;++i) query[i]*=n;
+	    search(0,&query[0],4,best); // 4: maximaler Abstand auf Einheitskugel
+	    for (int i=0;i<m_dim;++i) query[i]=-query[i];
+	    search(0,&query[0],4,best);
+	}
+    }
+    return vote(best,sq,a_dist);
+}
+
+/** Let the neighbours \c a_best (ordered by distance and record
+    number) vote, see classify(). \c a_sq is the squared norm of the
+    query (scaled distance only). */
+
+template <class T>
+int
+NearestNeighbour<T>::vote(
+    const vector<neighbour_type>& a_best,
+    double a_sq,
+    double& a_dist
+    ) const
+{
+    if (a_best.empty()) return -1;
+
+    // Abstimmung: Stimmen je Label, Reihenfolge nach naechstem Nachbarn
+    int winner = 0;
+    if (a_best.size()>1)
+    {
+	bool exact = m_weighted && (a_best[0].first==0);
+	vector<int> label; vector<double> votes;
+	for (word i=0;i<a_best.size();++i)
+	{
+	    double d = a_best[i].first, v = 1;
+	    if (m_scaled) d = d*(1-d/4);
+	    if (exact) v = (d==0) ? 1 : 0;
+	    else if (m_weighted) v = 1/d;
+	    word j=0;
+	    while ((j<label.size())&&
+		   !(m_labels[a_best[label[j]].second]==m_labels[a_best[i].second])) ++j;
+	    if (j==label.size()) { label.push_back(i); votes.push_back(0); }
+	    votes[j] += v;
+	}
+	for (word j=1;j<label.size();++j)
+	    if (votes[j]>votes[0]) { votes[0]=votes[j]; winner=label[j]; }
+    }
+
+    a_dist = a_best[winner].first;
+    if (m_scaled) a_dist = a_sq*a_dist*(1-a_dist/4);
+    return a_best[winner].second;
+}
+
+/** Classify the \c a_count queries \c a_x, see classify(). Without
+    m_blockwise the tree is searched for each query. Otherwise the
+    distances of a block of queries to all training vectors are
+    computed at once by kernel_square_distance_block() (on the
+    centered vectors, to reduce cancellation). These distances are
+    only accurate up to \c tol, therefore all training vectors that
+    may belong to the k nearest ones are kept as candidates, and the
+    neighbours are selected from the candidates by their exact
+    distance (kernel_square_distance(), as in search()). Thus the
+    result does not depend on m_blockwise, up to rounding: \c tol =
+    4*(m_dim+4)*DBL_EPSILON is a heuristic bound, not a proven one, so
+    training vectors whose distances differ by less than the error of
+    the matrix product may be ordered differently than by search().
+    Thread-safe. */
+
+template <class T>
+void
+NearestNeighbour<T>::classify(
+    const tuple_type::value_type* a_x,
+    int a_count,
+    int* a_result,
+    double* a_dist
+    ) const
+{
+    if (!m_blockwise)
+    {
+	for (int i=0;i<a_count;++i) a_result[i] = classify(a_x[i],a_dist[i]);
+	return;
+    }
+
+    const int qtile = 64, rtile = 256; // Anfragen und Trainingsvektoren je Block
+    const int n = m_record.size();
+    const double tol = 4*(m_dim+4)*DBL_EPSILON; // relativ zu |x|^2+|y|^2
+
+    vector<double> query(qtile*m_dim),centered(qtile*m_dim),norm(qtile);
+    vector<double> dist(qtile*rtile);
+    vector< vector<double> > upper(qtile); // k kleinste obere Schranken (Heap)
+    vector< vector<neighbour_type> > cand(qtile); // untere Schranke, Punkt
+    vector<neighbour_type> best;
+    for (int q0=0;q0<a_count;q0+=qtile)
+    {
+	const int q = min(qtile,a_count-q0);
+	for (int i=0;i<q;++i)
+	{
+	    const tuple_type::value_type& x = a_x[q0+i];
+	    if (x.rows()!=m_dim)
+	    {
+		ERROR("query vector has dimension "<<x.rows()<<" instead of "<<m_dim);
+		exit(-1);
+	    }
+	    double *p = &query[i*m_dim], *c = &centered[i*m_dim];
+	    for (int d=0;d<m_dim;++d)
+	    {
+		p[d] = x(m_order.empty() ? d : m_order[d]);
+		c[d] = p[d]-m_mean[d];
+	    }
+	    norm[i] = kernel_dot_product(c,c,m_dim);
+	    upper[i].clear(); cand[i].clear();
+	}
+
+	for (int r0=0;r0<n;r0+=rtile)
+	{
+	    const int r = min(rtile,n-r0);
+	    kernel_square_distance_block(&centered[0],&norm[0],q,
+					 &m_centered[r0*m_dim],&m_centered_norm[r0],
+					 r,m_dim,&dist[0]);
+	    for (int i=0;i<q;++i)
+	    {
+		vector<double>& u = upper[i];
+		vector<neighbour_type>& c = cand[i];
+		double bound = ((int)u.size()==m_k) ? u.front() : POS_IMPOSSIBLE_RANGE;
+		for (int j=0;j<r;++j)
+		{
+		    double e = tol*(norm[i]+m_centered_norm[r0+j]);
+		    double d = dist[i*r+j];
+		    if (d-e>bound) continue;
+		    c.push_back(neighbour_type(d-e,r0+j));
+		    if ((int)u.size()<m_k)
+		    { u.push_back(d+e); push_heap(u.begin(),u.end()); }
+		    else if (d+e<u.front())
+		    { pop_heap(u.begin(),u.end()); u.back()=d+e; push_heap(u.begin(),u.end()); }
+		    if ((int)u.size()==m_k) bound = u.front();
+		}
+		// Kandidaten ausduennen, die Schranke ist inzwischen kleiner
+		if ((int)c.size()>2*m_k+rtile)
+		{
+		    word k=0;
+		    for (word l=0;l<c.size();++l) if (c[l].first<=bound) c[k++]=c[l];
+		    c.resize(k);
+		}
+	    }
+	}
+
+	for (int i=0;i<q;++i)
+	{
+	    const vector<double>& u = upper[i];
+	    const vector<neighbour_type>& c = cand[i];
+	    double bound = ((int)u.size()==m_k) ? u.front() : POS_IMPOSSIBLE_RANGE;
+	    best.clear();
+	    for (word l=0;l<c.size();++l)
+		if (c[l].first<=bound)
+		{
+		    int p = c[l].second;
+		    double d = kernel_square_distance(&m_points[p*m_dim],&query[i*m_dim],m_dim);
+		    best.push_back(neighbour_type(d,m_record[p]));
+		}
+	    sort(best.begin(),best.end());
+	    if ((int)best.size()>m_k) best.resize(m_k);
+	    a_result[q0+i] = vote(best,0,a_dist[q0+i]);
+	}
+    }
+}
+
+template <class T>
+Algorithm::term_type
+NearestNeighbour<T>::step()
+{
+    LOG_METHOD("DAA","NearestNeighbour","step","");
+
+    double d;
+    int r = classify(mp_x->val(),d);
+    if (r>=0)
+    {
+	mp_dist->var() = d;
+	mp_return_value->var() = m_labels[r];
+	TRACE_ID("distance",d<<"= nearest("<<(*mp_x)()<<") #"<<r);
+    }
+
+    return call_step(UNKNOWN,mp_filtered);
+}
+
+template <class T>
+void
+NearestNeighbour<T>::done()
+{
+    LOG_METHOD("DAA","NearestNeighbour","done","");
+
+    if (mp_filtered!=NULL) mp_filtered->done();
+}
+
+template NearestNeighbour<index_type>;
+template NearestNeighbour<int_type>;
+template NearestNeighbour<real_type>;
+template NearestNeighbour<tuple_type>;
+
+////////////////////////////////////////////////////////////////
+
+/** \class BlockNearestNeighbour
+    \brief Nearest neighbour classification of a whole table.
+
+    Like NearestNeighbour, but the algorithm iterates itself over the
+    query table \c data (like ReadRecord) and replaces
+
+\code
+      seq(fetch(&data),nearest(&train,...,succ))
+\endcode
+
+    Each step() call reads a block of \c bs records per thread
+    (default 1024), which are classified in parallel by \c threads
+    threads (default: number of processors). Then the records are
+    restored one after the other in input order (see
+    BaseTable::hold()), the predicted label is stored in \c retval
+    and the step() method of the successor is called (usually
+    writeback()). The threads are started with the first block that
+    needs more than one of them and wait for the next block until
+    done() is called; the calling thread classifies the first slice
+    of each block itself. */
+
+template <class T>
+BlockNearestNeighbour<T>::BlockNearestNeighbour(
+    BaseTable *data,
+    BaseTable *t,
+    tuple_type *tv,
+    const T *tl,
+    tuple_type *x,
+    real_type *d,
+    T *retval,
+    bool scaled,
+    Algorithm *f,
+    int_type *k,
+    int_type *w,
+    int_type *th,
+    int_type *r,
+    int_type *bs,
+    int_type *b
+    )
+    : NearestNeighbour<T>(t,tv,tl,x,d,retval,scaled,f,k,w,r,b)
+    , mp_data(data)
+    , mp_threads(th)
+    , mp_blocksize(bs)
+    , m_threads(1)
+    , m_blocksize(1024)
+#ifdef HAVE_LIBPTHREAD
+    , m_block(0)
+    , m_busy(0)
+    , m_stop(false)
+#endif
+{
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
+    pthread_cond_init(&m_started,NULL);
+    pthread_cond_init(&m_finished,NULL);
+#endif
+}
+
+template <class T>
+BlockNearestNeighbour<T>::~BlockNearestNeighbour()
+{
+    stop();
+#ifdef HAVE_LIBPTHREAD
+    pthread_cond_destroy(&m_finished);
+    pthread_cond_destroy(&m_started);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+template <class T>
+void
+BlockNearestNeighbour<T>::init()
+{
+    LOG_METHOD("DAA","BlockNearestNeighbour","init",mp_data->context()->name());
+
+    stop(); // Anzahl der Threads kann sich geaendert haben
+    NearestNeighbour<T>::init();
+    mp_data->rewind();
+
+    m_blocksize = (mp_blocksize==NULL) ? 1024 : mp_blocksize->val();
+    if (m_blocksize<1)
+    { WARNING("block size "<<m_blocksize<<" replaced by 1024"); m_blocksize=1024; }
+    m_threads = (mp_threads==NULL) ? 0 : mp_threads->val();
+#ifdef HAVE_LIBPTHREAD
+    if (m_threads<=0) m_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (m_threads<1) m_threads = 1;
+#else
+    m_threads = 1;
+#endif
+}
+
+template <class T>
+void
+BlockNearestNeighbour<T>::classify_slice(
+    int a_first,
+    int a_last
+    )
+{
+    if (a_first<a_last)
+	this->classify(&m_query[a_first],a_last-a_first,
+		       &m_result[a_first],&m_resultdist[a_first]);
+}
+
+/** Start the threads 1..m_threads-1 (thread 0 is the caller of
+    step()). */
+
+template <class T>
+void
+BlockNearestNeighbour<T>::start()
+{
+#ifdef HAVE_LIBPTHREAD
+    stop();
+    m_stop = false;
+    m_bounds.assign(m_threads+1,0);
+    m_worker.resize(m_threads-1);
+    m_workers.resize(m_threads-1);
+    for (int t=0;t<m_threads-1;++t)
+    {
+	m_worker[t].mp_this = this;
+	m_worker[t].m_slice = t+1;
+	m_worker[t].m_block = m_block;
+	if (pthread_create(&m_workers[t],NULL,&BlockNearestNeighbour<T>::work,&m_worker[t])!=0)
+	{ ERROR("cannot start classification thread"); exit(-1); }
+    }
+    TRACE(m_threads<<" threads");
+#endif
+}
+
+/** Terminate the threads (if any). */
+
+template <class T>
+void
+BlockNearestNeighbour<T>::stop()
+{
+#ifdef HAVE_LIBPTHREAD
+    if (m_workers.empty()) return;
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_broadcast(&m_started);
+    pthread_mutex_unlock(&m_mutex);
+    for (word t=0;t<m_workers.size();++t) pthread_join(m_workers[t],NULL);
+    m_workers.clear();
+    m_worker.clear();
+#endif
+}
+
+/** Thread function: waits for the next block, classifies its slice
+    and reports back, until stop() is called. */
+
+template <class T>
+void*
+BlockNearestNeighbour<T>::work(
+    void *ap_worker
+    )
+{
+#ifdef HAVE_LIBPTHREAD
+    worker_type *w = (worker_type*)ap_worker;
+    BlockNearestNeighbour<T> *p = w->mp_this;
+
+    pthread_mutex_lock(&p->m_mutex);
+    while (true)
+    {
+	while ((!p->m_stop)&&(p->m_block==w->m_block))
+	    pthread_cond_wait(&p->m_started,&p->m_mutex);
+	if (p->m_stop) break;
+	w->m_block = p->m_block;
+	int first = p->m_bounds[w->m_slice], last = p->m_bounds[w->m_slice+1];
+	pthread_mutex_unlock(&p->m_mutex);
+
+	p->classify_slice(first,last);
+
+	pthread_mutex_lock(&p->m_mutex);
+	if (--p->m_busy==0) pthread_cond_signal(&p->m_finished);
+    }
+    pthread_mutex_unlock(&p->m_mutex);
+#endif
+    return NULL;
+}
+
+template <class T>
+Algorithm::term_type
+BlockNearestNeighbour<T>::step()
+{
+    LOG_METHOD("DAA","BlockNearestNeighbour","step",mp_data->context()->name());
+
+    if (mp_data->done()) return Algorithm::TERMINATE;
+
+    // Block lesen, Records festhalten
+    int size = m_blocksize*m_threads;
+    m_query.resize(size); m_held.resize(size);
+    m_result.resize(size); m_resultdist.resize(size);
+    int n = 0;
+    while ((n<size)&&(!mp_data->done()))
+    {
+	mp_data->pop();
+	m_query[n] = this->mp_x->val();
+	m_held[n] = mp_data->hold();
+	++n;
+    }
+
+    // Block parallel klassifizieren, ueberzaehlige Threads bekommen
+    // leere Abschnitte
+    int threads = min(m_threads,(n+m_blocksize-1)/m_blocksize);
+#ifdef HAVE_LIBPTHREAD
+    if (threads>1)
+    {
+	if (m_workers.empty()) start();
+	pthread_mutex_lock(&m_mutex);
+	for (int t=0;t<=m_threads;++t)
+	    m_bounds[t] = (t<threads) ? (long)n*t/threads : n;
+	m_busy = m_workers.size();
+	++m_block;
+	pthread_cond_broadcast(&m_started);
+	pthread_mutex_unlock(&m_mutex);
+
+	classify_slice(m_bounds[0],m_bounds[1]);
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_busy>0) pthread_cond_wait(&m_finished,&m_mutex);
+	pthread_mutex_unlock(&m_mutex);
+    }
+    else
+#endif
+	classify_slice(0,n);
+    TRACE(n<<" records, "<<threads<<" threads");
+
+    // Records in Eingabe-Reihenfolge weiterreichen
+    for (int i=0;i<n;++i)
+    {
+	mp_data->restore(m_held[i]);
+	if (m_result[i]>=0)
+	{
+	    this->mp_dist->var() = m_resultdist[i];
+	    this->mp_return_value->var() = this->m_labels[m_result[i]];
+	}
+	call_step(Algorithm::UNKNOWN,this->mp_filtered);
+    }
+
+    return (mp_data->done()) ? Algorithm::TERMINATE : Algorithm::CONTINUE;
+}
+
+template <class T>
+void
+BlockNearestNeighbour<T>::done()
+{
+    LOG_METHOD("DAA","BlockNearestNeighbour","done","");
+
+    stop();
+    NearestNeighbour<T>::done();
+}
+
+template BlockNearestNeighbour<index_type>;
+template BlockNearestNeighbour<int_type>;
+template BlockNearestNeighbour<real_type>;
+template BlockNearestNeighbour<tuple_type>;
+
+////////////////////////////////////////////////////////////////
+
 /** \class ScalarProdDistance
     \brief Scalar product distance. 
 
-    This one-step algorithm returns the squared scalar product between
-    \c x and \c y: \f$(x^\top y)^2\f$. If \c inc is true, then the
-    scalar product is subtracted from an \c output value: \f$(o-x^\top
-    y)^2\f$ */
+    This one-step algorithm returns the squared difference between an
+    \c output value and the scalar product of \c x and \c y:
+    \f$(o-x^\top y)^2\f$. If \c inc is true, the squared difference
+    is added to \c p_dist instead of overwriting it. */
 
-/** The squared distance between \c x and \c y is stored in \c
-    p_dist. The boolean variable \c inc determines whether \c output
-    is subtracted from the scalar product of \c x and \c y. */
+/** The squared distance is stored in (or, if \c inc is true, added
+    to) \c p_dist. */
 
 ScalarProdDistance::ScalarProdDistance(
     real_type *p_dist,
@@ -70,7 +1464,7 @@ ScalarProdDistance::ScalarProdDistance(
     bool inc,
     Algorithm *p_succ
     )
-    : Algorithm(p_succ)
+    : mp_succ(p_succ)
     , mp_dist(p_dist)
     , mp_output(p_output)
     , mp_x(p_x)
@@ -83,11 +1477,12 @@ ScalarProdDistance::ScalarProdDistance(
 Algorithm::term_type
 ScalarProdDistance::step()
 {
-    real_type::value_type d = mp_output->val();
-    if (mp_x->val().rows()==mp_y->val().rows()) 
-	d -= matrix_dot_product((*mp_x)(),(*mp_y)());
-    if (m_inc) mp_dist->var() += d; else mp_dist->var() = d;
+    const tuple_type::value_type &x=mp_x->val(),&y=mp_y->val();
+    INVARIANT(x.rows()<=y.rows(),"operation assumes relaxed matrix dimensions");
+    real_type::value_type d = mp_output->val()
+	- kernel_dot_product(x.data(),y.data(),x.rows());
     d *= d;
+    if (m_inc) mp_dist->var() += d; else mp_dist->var() = d;
     TRACE_ID("distance",d<<"= dotdist("<<(*mp_x)()<<","<<(*mp_y)()<<")");
 
     return call_step(UNKNOWN,mp_succ);
@@ -108,7 +1503,7 @@ ScaledEuclideanDistance::ScaledEuclideanDistance(
     real_type *p_yscale,
     Algorithm *p_succ
     )
-    : Algorithm(p_succ)
+    : mp_succ(p_succ)
     , mp_dist(p_dist)
     , mp_yscale(p_yscale)
     , mp_x(p_x)
@@ -122,11 +1517,11 @@ ScaledEuclideanDistance::ScaledEuclideanDistance(
 Algorithm::term_type
 ScaledEuclideanDistance::step()
 {
-    mp_yscale->var() = matrix_dot_product(mp_x->val(),mp_y->val())
-	/ matrix_square_norm(mp_y->val());
-    static tuple_type::value_type tmp; tmp.alloc(mp_x->val().rows());
-    matrix_set_combi(tmp,1.0,mp_x->val(),-mp_yscale->val(),mp_y->val());
-    mp_dist->var() = matrix_square_norm(tmp);
+    const tuple_type::value_type &x=mp_x->val(),&y=mp_y->val();
+    INVARIANT(x.rows()<=y.rows(),"operation assumes relaxed matrix dimensions");
+    double s;
+    mp_dist->var() = kernel_scaled_distance(x.data(),y.data(),x.rows(),s);
+    mp_yscale->var() = s;
     TRACE_ID("distance",(*mp_dist)()<<"= scaleddist("<<
 	     (*mp_x)()<<","<<(*mp_y)()<<")");
 
@@ -147,7 +1542,7 @@ MahalanobisDistance::MahalanobisDistance(
     matrix_type *p_normmat,
     Algorithm *p_succ
     )
-    : Algorithm(p_succ)
+    : mp_succ(p_succ)
     , mp_dist(p_dist)
     , mp_x(p_x)
     , mp_y(p_y) 
@@ -157,34 +1552,33 @@ MahalanobisDistance::MahalanobisDistance(
 Algorithm::term_type
 MahalanobisDistance::step()
 {
-    static tuple_type::value_type diff,single;
-    static matrix_type::value_type temp;
-    diff.alloc(mp_x->val().rows());
-    temp.alloc(1,mp_x->val().rows());
-    single.alloc(1);
+    const tuple_type::value_type &x=mp_x->val(),&y=mp_y->val();
+    const matrix_type::value_type &A=mp_normmat->val();
+    int n = x.rows();
+    INVARIANT(n<=y.rows(),"operation assumes relaxed matrix dimensions");
 
-    matrix_set_diff(diff,mp_x->val(),mp_y->val());
-    
-    if (mp_normmat->val().rows()==0)
+    double d;
+    if (A.rows()==0)
     {
-	single(0,0) = matrix_square_norm(diff);
+	d = kernel_square_distance(x.data(),y.data(),n);
     }
     else
     {
-	matrix_set_product(temp,transposed(diff),mp_normmat->val());
-	matrix_set_product(single,temp,diff);
-	if (single(0,0)<0)
-	{ single(0,0)=1E-8; INVARIANT(false,"positiv definite matrix"); }
+	INVARIANT((A.rows()==n)&&(A.cols()==n),"norm matrix "<<A.rows()<<'x'<<A.cols()
+		  <<" for dimension "<<n);
+	d = kernel_quadratic_form(x.data(),y.data(),A.data(),n);
+	if (d<0)
+	{ d=1E-8; INVARIANT(false,"positiv definite matrix"); }
     }
     
-    mp_dist->var() = single(0,0);
+    mp_dist->var() = d;
 
     TRACE_ID("distance",(*mp_dist)()<<"= mahalanobixdist("<<
 	     (*mp_x)()<<","<<(*mp_y)()<<")");
 
     return call_step(UNKNOWN,mp_succ);
 }
-#endif
+
 }; // namespace
 
 #endif DISTANCE_SOURCE
@@ -25,6 +25,8 @@
 
 #include "dal.hpp"
 #include <stdio.h> // sprintf
+#include <ctype.h> // isdigit
+#include <string.h> // memcmp
 #include "globdef.hpp"
 
 namespace Data_Access_Library {
@@ -35,7 +37,27 @@ namespace Data_Access_Library {
     Domains are used to store a mapping of symbolical variables to
     integer numbers which are used to represent the symbols. If a
     data_type is instantiated with no domain, only numerical variables
-    will be allowed. */
+    will be allowed. 
+
+    Labels are looked up in a hash table (open addressing, linear
+    probing, at most half full), which may be queried with a pointer
+    and length into a read buffer. Numbers assigned by add(label) are
+    dense (0,1,2,...), their labels are found in a flat vector. */
+
+/** Werte bis zu dieser Entfernung hinter dem letzten Wert im Vektor
+    m_idx2str werden noch dort abgelegt (sonst in m_sparse). */
+
+static const int g_dense_gap = 1024;
+
+/** Labels, die wie eine Zahl beginnen, verhindern das direkte
+    Einlesen von Zahlen in SymbolicIO<T>::read() (dort muss dann
+    zuerst in der Domain gesucht werden). */
+
+static inline bool is_numeric_label(const string& label)
+  {
+  return (!label.empty()) && 
+    ((isdigit(label[0])) || (label[0]=='.') || (label[0]=='-'));
+  }
 
 /** Default Constructor. */
 
@@ -45,6 +67,7 @@ Domain::Domain()
   , m_fixed_values(false)
   , m_precision(12)
   , m_mixed_mode(true)
+  , m_numeric_labels(0)
   {
   }
 
@@ -63,6 +86,7 @@ Domain::Domain
   , m_fixed_values(false)
   , m_precision(12)
   , m_mixed_mode(mixmode)
+  , m_numeric_labels(0)
   {
   gp_dm_domains->add(name,(long)this);
   }
@@ -76,9 +100,10 @@ Domain::reassign_indices()
   if (m_fixed_values) ERROR("reassign denied, fixed domain values");
 
   m_idx2str.clear();
+  m_sparse.clear();
   int n = 0;
   for (str2idx_type::iterator i=m_str2idx.begin();i!=m_str2idx.end();++i)
-    { (*i).second = n; m_idx2str[n] = (*i).first; ++n; }
+    { (*i).second = n; m_idx2str.push_back((*i).first); ++n; }
   INVARIANT(n==m_size,"n="<<n<<",m_size="<<m_size);
   m_next = n;
 }
@@ -94,8 +119,93 @@ Domain::clear()
   m_next = 0;
   m_fixed_values = false;
   m_str2idx.clear();
+  m_slots.clear();
   m_idx2str.clear();
+  m_sparse.clear();
   m_words.clear();
+  m_numeric_labels = 0;
+  }
+
+/** Slot of the hash table for label \c p (length \c n, hash value
+    \c h): either the slot containing the label or the empty slot where
+    it would be inserted. The return value is -1 if the table is
+    empty. */
+
+int
+Domain::probe
+  (
+  const char *p,
+  int n,
+  unsigned int h
+  )
+  const
+  {
+  if (m_slots.empty()) return -1;
+  const unsigned int mask = m_slots.size()-1;
+  unsigned int i = h & mask;
+  for (;;)
+    {
+    const slot_type& s = m_slots[i];
+    if (s.mp_label==NULL) return i;
+    if ((s.m_hash==h) && ((int)s.mp_label->length()==n) &&
+	(memcmp(s.mp_label->data(),p,n)==0)) return i;
+    i = (i+1) & mask;
+    }
+  }
+
+/** Resize the hash table to \c a_size slots (a power of 2) and
+    reinsert all labels. */
+
+void
+Domain::rehash
+  (
+  int a_size
+  )
+  {
+  vector<slot_type> old;
+  old.swap(m_slots);
+  slot_type empty = { NULL, NULL, 0 };
+  m_slots.assign(a_size,empty);
+  for (vector<slot_type>::const_iterator i=old.begin();i!=old.end();++i)
+    if ((*i).mp_label!=NULL)
+      m_slots[probe((*i).mp_label->data(),(*i).mp_label->length(),(*i).m_hash)] = *i;
+  }
+
+/** Insert label \c p (already in m_words and m_str2idx) into the hash
+    table. */
+
+void
+Domain::insert
+  (
+  string const *p
+  )
+  {
+  if (2*(m_size+1)>(int)m_slots.size()) 
+    rehash(max(16,2*(int)m_slots.size()));
+  slot_type& s = m_slots[probe(p->data(),p->length(),fnv_hash(p->data(),p->length()))];
+  s.mp_label = p;
+  s.mp_value = &m_str2idx[p];
+  s.m_hash = fnv_hash(p->data(),p->length());
+  }
+
+/** Remember \c p as label for \c value (unless \c value has a label
+    already, the first label is used for output). */
+
+void
+Domain::set_identifier
+  (
+  int value,
+  string const *p
+  )
+  {
+  if ((value>=0)&&(value<(int)m_idx2str.size()+g_dense_gap))
+    {
+    if (value>=(int)m_idx2str.size()) m_idx2str.resize(value+1,NULL);
+    if ((m_idx2str[value]==NULL)&&(m_sparse.find(value)==m_sparse.end())) 
+      m_idx2str[value] = p;
+    }
+  else if (m_sparse.find(value)==m_sparse.end()) 
+    m_sparse[value] = p;
   }
 
 /** Search for a symbolic label. Search for a symbol \c label in the
@@ -110,14 +220,28 @@ Domain::find
   const string& label,
   int &value
   ) 
+  const
+  {
+  return find(label.data(),label.length(),value);
+  }
+
+/** Search for the symbolic label given by the first \c n characters
+    at \c p (e.g.\ in a read buffer, no string is constructed). */
+
+bool
+Domain::find
+  (
+  const char *p,
+  int n,
+  int &value
+  ) 
+  const
   {
-  // Test auf Vorhandensein
-  str2idx_type::const_iterator i = m_str2idx.find(&label);
-  // Wenn schon bekannt, dann Index zurueckmelden
-  if (i==m_str2idx.end())
+  int i = probe(p,n,fnv_hash(p,n));
+  if ((i<0)||(m_slots[i].mp_label==NULL))
     { value=INT_MAX; return false; }
   else
-    { value=(*i).second; return true; }
+    { value=*m_slots[i].mp_value; return true; }
   }
 
 /** Search for a symbolic label in stream. Check if the next symbols
@@ -160,20 +284,22 @@ Domain::add
   {
   //LOG_METHOD("DAL","Domain","add",*this);
   { // Test auf Vorhandensein
-    str2idx_type::const_iterator i = m_str2idx.find(&label);
+    int value;
     // Wenn schon bekannt, dann Index zurueckmelden
-    if (i!=m_str2idx.end()) 
+    if (find(label,value)) 
       {
-      TRACE("add label "<<label<<" already known as "<<(*i).second);
-      return (*i).second;
+      TRACE("add label "<<label<<" already known as "<<value);
+      return value;
       }
    }
    { // Anmeldung eines neuen Labels
     m_words.push_back(label);
-    string *p = &(*m_words.rbegin());
+    string *p = &m_words.back();
     m_str2idx[p] = m_next; 
+    insert(p);
+    if (is_numeric_label(label)) ++m_numeric_labels;
     TRACE("add label "<<label<<" index "<<m_next);
-    if (m_idx2str.find(m_next)==m_idx2str.end()) m_idx2str[m_next] = p;
+    set_identifier(m_next,p);
     ++m_size; ++m_next;
    }
   return (m_next-1);
@@ -195,20 +321,27 @@ Domain::add
   {
   //LOG_METHOD("DAL","Domain","add",*this);
     { // Test auf doppelten Bezeichner
-    str2idx_type::const_iterator i = m_str2idx.find(&label);
-    // Doppelanmeldung leise ignorieren
-    if (i!=m_str2idx.end())
+    int i = probe(label.data(),label.length(),fnv_hash(label.data(),label.length()));
+    if ((i>=0)&&(m_slots[i].mp_label!=NULL))
       {
-      if ((*i).second==value) return;
-      // Abbruch
-      //ERROR("label "<<label<<" already in "<<m_words);
+      // Doppelanmeldung leise ignorieren
+      if (*m_slots[i].mp_value==value) return;
+      // sonst gilt der neue Wert
+      *m_slots[i].mp_value = value;
+      set_identifier(value,m_slots[i].mp_label);
+      TRACE("add label "<<label<<" new index "<<value);
+      m_fixed_values = true;
+      m_next=max(m_next,value)+1;
+      return;
       }
     }
     { // Anmeldung 
     m_words.push_back(label);
-    string *p = &(*m_words.rbegin());
+    string *p = &m_words.back();
     m_str2idx[p] = value;
-    if (m_idx2str.find(value)==m_idx2str.end()) m_idx2str[value] = p;
+    insert(p);
+    if (is_numeric_label(label)) ++m_numeric_labels;
+    set_identifier(value,p);
     TRACE("add label "<<label<<" index "<<value);
     // Nachdem Werte direkt gesetzt wurden, keine Neuordnung mehr
     m_fixed_values = true;
@@ -227,8 +360,10 @@ Domain::identifier
   )
   const
   {
-  idx2str_type::const_iterator i = m_idx2str.find(value);
-  return (i==m_idx2str.end())?NULL:(*i).second;
+  if ((value>=0)&&(value<(int)m_idx2str.size())&&(m_idx2str[value]!=NULL)) 
+    return m_idx2str[value];
+  idx2str_type::const_iterator i = m_sparse.find(value);
+  return (i==m_sparse.end())?NULL:(*i).second;
   }
 
 /** Print domain (for debugging purposes). */
@@ -6,6 +6,11 @@
 #include "globdef.hpp"
 #include "ttime.hpp"
 #include <strstream>
+#include <fstream>
+#include <stdio.h> // rename
+#include <stdlib.h> // getenv, atexit
+#include <limits.h> // INT_MAX
+#include <sys/time.h> // gettimeofday
 #include "access.hpp" // g_matrix_cml_separators
 
 namespace Data_Access_Library {
@@ -90,6 +95,8 @@ init_global()
 	srand( ((unsigned int)usec)%1023 );
     }
     
+    // Betriebszaehler (nur mit DAL_METRICS)
+    Metrics::init();
 }
     
 /** Erstelle ein neues Label aus einem alten \c label durch
@@ -227,6 +234,20 @@ evaluate_command(
 		    CLEAR_TAG(p_table->context()->mode(),cMULTITABLE); break;
 		case 'f' :
 		    SET_TAG(p_table->context()->mode(),cFLAT); break;
+		case 'm' : // mapped : Eingabedatei einblenden statt lesen
+		    SET_TAG(p_table->context()->mode(),cMAPPED); break;
+		case 'p' : // prefetch : Eingabedatei im Hintergrund vorauslesen
+#ifdef HAVE_LIBPTHREAD
+		    SET_TAG(p_table->context()->mode(),cPREFETCH); break;
+#else
+		    INFO("no thread support, table modifier p ignored"); break;
+#endif
+		case 'b' : // buffered : Ausgabedatei blockweise schreiben
+		    SET_TAG(p_table->context()->mode(),cBUFFERED); break;
+		case 'x' : // indexed : Recordpositionen in .idx-Datei merken
+		    SET_TAG(p_table->context()->mode(),cINDEXED); break;
+		case 'l' : // lazy : Felder erst beim ersten Zugriff dekodieren
+		    SET_TAG(p_table->context()->mode(),cLAZY); break;
 		case '<' :
 		case '=' :
 		case '>' :
@@ -421,6 +442,325 @@ void mem_info(
     os << endl; 
 }
 
+/** Metrics ******************************************************/
+
+bool Metrics::m_active = false;
+volatile sig_atomic_t Metrics::m_request = 0;
+
+/// Eintrag im Verzeichnis der Zaehler
+struct metrics_entry
+{
+    Metrics::kind_type m_kind;
+    string m_name;
+    string m_file;
+    Metrics::counters *mp_counters; ///< Zaehler des Objekts, NULL: Objekt geloescht
+    Metrics::counters m_last; ///< letzter Stand eines geloeschten Objekts
+    double m_start; ///< Zeitpunkt der Anmeldung
+    double m_end; ///< Zeitpunkt der Abmeldung
+};
+
+static list<metrics_entry> *gp_metrics = NULL; ///< alle Eintraege
+static string g_metrics_file; ///< Ausgabedatei, "-": stderr
+static double g_metrics_start = 0; ///< Zeitpunkt von init()
+static double g_metrics_interval = 0; ///< Sekunden, 0: keine periodische Ausgabe
+static double g_metrics_next = 0; ///< naechste periodische Ausgabe
+/// pop()/push() einer Tabelle zwischen zwei Blicken auf die Uhr
+static const int g_metrics_poll = 1024;
+#ifdef HAVE_LIBPTHREAD
+/// schuetzt das Verzeichnis und die Ausgabe
+static pthread_mutex_t g_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** Aktiviert das Verzeichnis, wenn DAL_METRICS gesetzt ist (Aufruf in
+    init_global()). Installiert den Handler fuer SIGUSR1 und die
+    Ausgabe bei Programmende. */
+
+void
+Metrics::init()
+{
+    const char *p_file = getenv("DAL_METRICS");
+    if ((p_file==NULL)||(*p_file=='\0')||(m_active)) return;
+    
+    g_metrics_file = p_file;
+    gp_metrics = new list<metrics_entry>;
+    g_metrics_start = now();
+    const char *p_interval = getenv("DAL_METRICS_INTERVAL");
+    if (p_interval!=NULL) g_metrics_interval = atof(p_interval);
+    g_metrics_next = g_metrics_start + g_metrics_interval;
+    m_active = true;
+    
+    signal(SIGUSR1,&Metrics::request);
+    atexit(&Metrics::dump_at_exit);
+    INFO("metrics to '"<<g_metrics_file<<"'");
+}
+
+/** Sekunden seit 1970, als double (TTime aus ttime.hpp ist float und
+    fuer Summen kurzer Intervalle zu ungenau). */
+
+double
+Metrics::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+/** Signal-Handler fuer SIGUSR1: Ausgabe beim naechsten poll(). */
+
+void
+Metrics::request(int)
+{
+    m_request = 1;
+}
+
+void
+Metrics::dump_at_exit()
+{
+    m_request = 0;
+    dump();
+}
+
+/** Meldet die Zaehler \c ap_counters eines Objekts der Art \c a_kind
+    mit Namen \c a_name (Tabelle/Feld) und Datei \c a_file an. */
+
+void
+Metrics::enlist(
+    counters *ap_counters,
+    kind_type a_kind,
+    const string& a_name,
+    const string& a_file
+    )
+{
+    if (!m_active) return;
+    metrics_entry e;
+    e.m_kind = a_kind;
+    e.m_name = a_name;
+    e.m_file = a_file;
+    e.mp_counters = ap_counters;
+    e.m_start = now();
+    e.m_end = 0;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&g_metrics_mutex);
+#endif
+    gp_metrics->push_back(e);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&g_metrics_mutex);
+#endif
+}
+
+/** Abmelden (Objekt wird geloescht). Der letzte Stand bleibt
+    erhalten, er wird ggf. mit einem frueher geloeschten Objekt
+    gleicher Art, gleichen Namens und gleicher Datei zusammengefasst. */
+
+void
+Metrics::remove(
+    counters *ap_counters
+    )
+{
+    if (!m_active) return;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&g_metrics_mutex);
+#endif
+    list<metrics_entry>::iterator i = gp_metrics->begin();
+    while ((i!=gp_metrics->end())&&((*i).mp_counters!=ap_counters)) ++i;
+    if (i!=gp_metrics->end())
+    {
+	(*i).m_last = *ap_counters;
+	(*i).mp_counters = NULL;
+	(*i).m_end = now();
+	for (list<metrics_entry>::iterator j=gp_metrics->begin();j!=gp_metrics->end();++j)
+	{
+	    if ((j==i)||((*j).mp_counters!=NULL)||((*j).m_kind!=(*i).m_kind)
+		||((*j).m_name!=(*i).m_name)||((*j).m_file!=(*i).m_file)) continue;
+	    counters& c = (*j).m_last;
+	    const counters& d = (*i).m_last;
+	    c.m_records += d.m_records; c.m_pushes += d.m_pushes; 
+	    c.m_bytes += d.m_bytes; c.m_seeks += d.m_seeks;
+	    c.m_parse += d.m_parse; c.m_io += d.m_io;
+	    c.m_pos = d.m_pos; c.m_size = d.m_size;
+	    (*j).m_end = (*i).m_end;
+	    gp_metrics->erase(i);
+	    break;
+	}
+    }
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&g_metrics_mutex);
+#endif
+}
+
+/** Aus poll(): Ausgabe, wenn SIGUSR1 empfangen wurde oder das
+    Intervall abgelaufen ist. */
+
+void
+Metrics::check(
+    counters& c
+    )
+{
+    if (!m_active) { m_request=0; c.m_poll=INT_MAX; return; }
+    c.m_poll = g_metrics_poll;
+    if ((!m_request)&&((g_metrics_interval<=0)||(now()<g_metrics_next))) return;
+    m_request = 0;
+    g_metrics_next = now() + g_metrics_interval;
+    dump();
+}
+
+/** String als JSON-Literal ausgeben. */
+
+static void
+json_string(
+    ostream& os,
+    const string& a_text
+    )
+{
+    os << '"';
+    for (string::size_type i=0;i<a_text.length();++i)
+    {
+	const unsigned char c = a_text[i];
+	if ((c=='"')||(c=='\\')) os << '\\' << c;
+	else if (c<0x20) 
+	{ char buf[8]; sprintf(buf,"\\u%04x",c); os << buf; }
+	else os << c;
+    }
+    os << '"';
+}
+
+/** Alle Eintraege der Art \c a_kind als JSON-Array. Summiert die
+    Zeiten in \c a_parse und \c a_io (fuer die Anteile an der
+    Laufzeit). Aufruf nur unter g_metrics_mutex. */
+
+static void
+metrics_array(
+    ostream& os,
+    Metrics::kind_type a_kind,
+    double a_now,
+    double& a_parse,
+    double& a_io
+    )
+{
+    os << '[';
+    bool first = true;
+    for (list<metrics_entry>::const_iterator i=gp_metrics->begin();i!=gp_metrics->end();++i)
+    {
+	const metrics_entry& e = *i;
+	if (e.m_kind!=a_kind) continue;
+	const Metrics::counters& c = (e.mp_counters!=NULL) ? *e.mp_counters : e.m_last;
+	const double elapsed = ((e.mp_counters!=NULL) ? a_now : e.m_end) - e.m_start;
+	a_parse += c.m_parse; a_io += c.m_io;
+	
+	os << ((first)?"\n  {":",\n  {"); first = false;
+	os << "\"name\":"; json_string(os,e.m_name);
+	if (a_kind!=Metrics::TABLE) { os << ",\"file\":"; json_string(os,e.m_file); }
+	os << ",\"open\":" << ((e.mp_counters!=NULL)?"true":"false")
+	   << ",\"elapsed\":" << elapsed;
+	if (a_kind==Metrics::TABLE)
+	{
+	    os << ",\"pops\":" << c.m_records << ",\"pushes\":" << c.m_pushes
+	       << ",\"push_sec\":" << c.m_parse;
+	}
+	else
+	{
+	    os << ",\"records\":" << c.m_records << ",\"bytes\":" << c.m_bytes
+	       << ",\"seeks\":" << c.m_seeks;
+	    if (elapsed>0)
+		os << ",\"records_per_sec\":" << c.m_records/elapsed
+		   << ",\"bytes_per_sec\":" << c.m_bytes/elapsed;
+	}
+	if (a_kind==Metrics::READER)
+	{
+	    os << ",\"parse_sec\":" << c.m_parse << ",\"io_sec\":" << c.m_io
+	       << ",\"pos\":" << c.m_pos << ",\"size\":" << c.m_size
+	       << ",\"chunks\":" << c.m_chunks << ",\"chunk_mismatches\":" << c.m_mismatches;
+	    // Restzeit bei gleichbleibendem Durchsatz
+	    if ((e.mp_counters!=NULL)&&(c.m_size>0)&&(c.m_pos>0)&&(elapsed>0))
+		os << ",\"eta_sec\":" << (c.m_size-c.m_pos)*elapsed/c.m_pos;
+	}
+	os << '}';
+    }
+    os << ((first)?"]":"\n  ]");
+}
+
+/** Ausgabe aller Zaehler als JSON-Objekt auf \c os. Die Anteile \c
+    parse_share, \c io_share (Reader) und \c push_share (Tabellen)
+    beziehen sich auf die Laufzeit seit init(): ueberwiegt das Lesen
+    oder das Dekodieren, oder keines von beiden (dann liegt die Zeit
+    in der Anwendung bzw. bei den Repositories, siehe deren \c
+    inserts und \c peak). */
+
+void
+Metrics::dump(
+    ostream& os
+    )
+{
+    if (!m_active) return;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&g_metrics_mutex);
+#endif
+    write(os);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&g_metrics_mutex);
+#endif
+}
+
+/** Wie dump(ostream&), Aufruf nur unter g_metrics_mutex. */
+
+void
+Metrics::write(
+    ostream& os
+    )
+{
+    const double t = now();
+    const double elapsed = t - g_metrics_start;
+    double parse=0,io=0,push=0,dummy=0;
+    os << "{\"elapsed\":" << elapsed << ",\n \"readers\":";
+    metrics_array(os,READER,t,parse,io);
+    os << ",\n \"writers\":";
+    metrics_array(os,WRITER,t,dummy,dummy);
+    os << ",\n \"tables\":";
+    metrics_array(os,TABLE,t,push,dummy);
+    os << ",\n \"repositories\":{";
+    os << "\n  \"i\":"; data_type<int>::metrics(os);
+    os << ",\n  \"x\":"; data_type<ix_type>::metrics(os);
+    os << ",\n  \"d\":"; data_type<double>::metrics(os);
+    os << ",\n  \"s\":"; data_type<string>::metrics(os);
+    os << ",\n  \"ti\":"; data_type<DynTuple<int> >::metrics(os);
+    os << ",\n  \"tx\":"; data_type<DynTuple<ix_type> >::metrics(os);
+    os << ",\n  \"td\":"; data_type<DynTuple<double> >::metrics(os);
+    os << ",\n  \"mi\":"; data_type<DynMatrix<int> >::metrics(os);
+    os << ",\n  \"md\":"; data_type<DynMatrix<double> >::metrics(os);
+    os << "},\n \"parse_share\":" << ((elapsed>0)?parse/elapsed:0)
+       << ",\"io_share\":" << ((elapsed>0)?io/elapsed:0)
+       << ",\"push_share\":" << ((elapsed>0)?push/elapsed:0)
+       << "}" << endl;
+}
+
+/** Ausgabe in die Datei aus DAL_METRICS. Die Datei wird jedesmal
+    neu geschrieben (ueber eine temporaere Datei und rename(), ein
+    Beobachter sieht also immer einen vollstaendigen Stand). */
+
+void
+Metrics::dump()
+{
+    if (!m_active) return;
+    if (g_metrics_file=="-") { dump(cerr); return; }
+    
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&g_metrics_mutex);
+#endif
+    string tmp = g_metrics_file + ".tmp";
+    ofstream os(tmp.c_str(),ios::out|ios::trunc);
+    if (os.good()) 
+    {
+	write(os);
+	os.close();
+	if (rename(tmp.c_str(),g_metrics_file.c_str())!=0)
+	    WARNING("cannot rename '"<<tmp<<"' to '"<<g_metrics_file<<"'");
+    }
+    else WARNING("cannot write metrics to '"<<tmp<<"'");
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&g_metrics_mutex);
+#endif
+}
+
 
 }; // namespace
 
@@ -23,6 +23,15 @@ extern Domain *gp_dm_tables;
 /** Information ueber benutzten Speicher.  */
 void mem_info(ostream&);
 
+/** FNV-1a Hashwert der Zeichen [p,p+n), fuer die Hashtabellen der
+    Domains (Labels) und des TAG_Reader (Tag-Namen). */
+inline unsigned int fnv_hash(const char *p,int n)
+{
+    unsigned int h = 2166136261u;
+    for (int i=0;i<n;++i) { h ^= (unsigned char)p[i]; h *= 16777619u; }
+    return h;
+}
+
 }; // namespace
 
 #endif
@@ -88,45 +88,45 @@ template SymbolicIO<double>;
 
 #include "datarep.cpp"
 
-Repository< ix_type > data_type< ix_type >::m_repository;
-ix_type data_type< ix_type >::m_global_default_ix(g_illegal_ix);
+int data_type< ix_type >::m_slot(-1);
 template void data_type< ix_type >::mem_info(ostream&);
+template void data_type< ix_type >::metrics(ostream&);
 
-Repository<int> data_type<int>::m_repository;
-ix_type data_type<int>::m_global_default_ix(g_illegal_ix);
+int data_type<int>::m_slot(-1);
 template void data_type< int >::mem_info(ostream&);
+template void data_type< int >::metrics(ostream&);
 
-Repository<long> data_type<long>::m_repository;
-ix_type data_type<long>::m_global_default_ix(g_illegal_ix);
+int data_type<long>::m_slot(-1);
 template void data_type< long >::mem_info(ostream&);
+template void data_type< long >::metrics(ostream&);
 
-Repository<double> data_type<double>::m_repository;
-ix_type data_type<double>::m_global_default_ix(g_illegal_ix);
+int data_type<double>::m_slot(-1);
 template void data_type< double >::mem_info(ostream&);
+template void data_type< double >::metrics(ostream&);
 
-Repository<string> data_type<string>::m_repository;
-ix_type data_type<string>::m_global_default_ix(g_illegal_ix);
+int data_type<string>::m_slot(-1);
 template void data_type< string >::mem_info(ostream&);
+template void data_type< string >::metrics(ostream&);
 
-Repository< DynTuple<ix_type> > data_type< DynTuple<ix_type> >::m_repository;
-ix_type data_type< DynTuple<ix_type> >::m_global_default_ix(g_illegal_ix);
+int data_type< DynTuple<ix_type> >::m_slot(-1);
 template void data_type< DynTuple<ix_type> >::mem_info(ostream&);
+template void data_type< DynTuple<ix_type> >::metrics(ostream&);
 
-Repository< DynTuple<int> > data_type< DynTuple<int> >::m_repository;
-ix_type data_type< DynTuple<int> >::m_global_default_ix(g_illegal_ix);
+int data_type< DynTuple<int> >::m_slot(-1);
 template void data_type< DynTuple<int> >::mem_info(ostream&);
+template void data_type< DynTuple<int> >::metrics(ostream&);
 
-Repository< DynTuple<double> > data_type< DynTuple<double> >::m_repository;
-ix_type data_type< DynTuple<double> >::m_global_default_ix(g_illegal_ix);
+int data_type< DynTuple<double> >::m_slot(-1);
 template void data_type< DynTuple<double> >::mem_info(ostream&);
+template void data_type< DynTuple<double> >::metrics(ostream&);
 
-Repository< DynMatrix<int> > data_type< DynMatrix<int> >::m_repository;
-ix_type data_type< DynMatrix<int> >::m_global_default_ix(g_illegal_ix);
+int data_type< DynMatrix<int> >::m_slot(-1);
 template void data_type< DynMatrix<int> >::mem_info(ostream&);
+template void data_type< DynMatrix<int> >::metrics(ostream&);
 
-Repository< DynMatrix<double> > data_type< DynMatrix<double> >::m_repository;
-ix_type data_type< DynMatrix<double> >::m_global_default_ix(g_illegal_ix);
+int data_type< DynMatrix<double> >::m_slot(-1);
 template void data_type< DynMatrix<double> >::mem_info(ostream&);
+template void data_type< DynMatrix<double> >::metrics(ostream&);
 
 #endif // INSTANCES_SOURCE
 
@@ -9,6 +9,7 @@
 #include "dal.hpp" // Definition von SymbolicIO
 #include "globdef.hpp"
 #include <iomanip>
+#include <strstream>
 
 namespace Data_Access_Library {
 
@@ -17,6 +18,38 @@ namespace Data_Access_Library {
 
     Bezug zu Domains */
 
+/** Muss das Label \a a_label beim Schreiben in ".." eingeklammert
+    werden? Das ist der Fall, wenn es leer ist, Leerzeichen,
+    Anfuehrungszeichen oder Trennzeichen der Dateiformate enthaelt,
+    oder (bei \a a_mixed) wie eine Zahl beginnt; sonst wuerde es beim
+    Lesen zerteilt oder als Zahl gelesen. */
+
+static inline bool
+needs_quotes(const string& a_label,bool a_mixed)
+{
+    if (a_label.empty()) return true;
+    if ((a_mixed)&&((isdigit(a_label[0]))||(a_label[0]=='.')||(a_label[0]=='-')))
+	return true;
+    for (string::const_iterator c=a_label.begin();c!=a_label.end();++c)
+	if ((isspace(*c))||(strchr("\"()[]<>,;:",*c)!=NULL)) return true;
+    return false;
+}
+
+/** Label in ".." ausgeben, " und \\ darin mit vorangestelltem \\
+    (siehe SymbolicIO<T>::read()). */
+
+static void
+write_quoted(ostream& os,const string& a_label)
+{
+    os << '\"';
+    for (string::const_iterator c=a_label.begin();c!=a_label.end();++c)
+    {
+	if ((*c=='\"')||(*c=='\\')) os << '\\';
+	os << *c;
+    }
+    os << '\"';
+}
+
 /** Wir benutzen INT zum Speichern von ganzen Zahlen und als Referenz
     auf Label. In einem Stream stehen dann die Label, intern benutzen
     wir die INTs. Die Konvertierung INT<->LABEL geschieht durch diese
@@ -38,48 +71,60 @@ SymbolicIO<T>::read(
 {
     if (mp_domain == NULL)
     {
-	is >> a_value;
+	scan_number(is,a_value);
     }
     else if ((is.eof()) || (!is.good()))
     {
 	return;
     }
+    else if ( (mp_domain->mixed_mode()) && (!mp_domain->numeric_labels()) 
+	      && (number_follows(is)) )
+    { // Zahl kann kein Label sein, also ohne Suche in der Domain lesen
+	scan_number(is,a_value);
+    }
     else
     {
+	read_white(is);
+	if (is.peek()=='\"')
+	{ // symbolisches Label in ".." eingeklammert, \ maskiert " und \ 
+	    is.get();
+	    m_word.erase();
+	    int c;
+	    while (((c=is.get())!=EOF)&&(c!='\"'))
+	    {
+		if ((c=='\\')&&(is.peek()!=EOF)) c=is.get();
+		m_word += (char)c;
+	    }
+	    a_value = mp_domain->add(m_word);   
+	    return;
+	}
+	// naechstes Wort lesen und in der Domain suchen (ohne Kopie)
+	read_word_break(is,p_break,m_word);
 	int x;
-	if (mp_domain->find(is,x))
+	if (mp_domain->find(m_word.data(),m_word.length(),x))
 	{ // symbolischer Bezeichner direkt gefunden
 	    a_value = x;
 	}
-	else
-	{
-	    read_white(is);
-	    char c; is.get(c); 
-	    if ( (mp_domain->mixed_mode()) && (isdigit(c)||(c=='.')||(c=='-')) )
-	    { // numerischer Wert, unveraendert lesen (nur bei !mixed_mode)
-		is.putback(c);
-		is >> a_value;
-	    }
-	    else if (c=='\"')
-	    { // symbolisches Label in ".." eingeklammert
-		string entry;
-		read_until(is,"\"",entry);
-		a_value = mp_domain->add(entry);   
-	    }
-	    else
-	    { // naechstes Wort als neues symbolisches Label uebernehmen
-		is.putback(c);
-		string entry;
-		read_word_break(is,p_break,entry);
-		if (mp_domain->is_fixed())
-		{ // keine neuen Label erlaubt (bzw. unklar welcher Wert zugewiesen werden soll)
-		    ERROR("do not know how to handle label \"" << entry 
-			  << "\" (in fixed domain "<<*mp_domain<<")");
-		}
-		else 
-		    a_value = mp_domain->add(entry);           
+	else if ( (mp_domain->mixed_mode()) && (!m_word.empty()) &&
+		  (isdigit(m_word[0])||(m_word[0]=='.')||(m_word[0]=='-')) )
+	{ // numerischer Wert, unveraendert lesen (nur bei !mixed_mode)
+	    istrstream number(m_word.data(),m_word.length());
+	    if ((!scan_number(number,a_value))||(number.peek()!=EOF))
+	    { // bspw. "12ab": weder Label noch Zahl
+		ERROR("\""<<m_word<<"\" is neither a label (in domain "
+		      <<*mp_domain<<") nor a number, use \"..\" for labels");
+		exit(-1);
 	    }
 	}
+	else if (mp_domain->is_fixed())
+	{ // keine neuen Label erlaubt (bzw. unklar welcher Wert zugewiesen werden soll)
+	    ERROR("do not know how to handle label \"" << m_word 
+		  << "\" (in fixed domain "<<*mp_domain<<")");
+	}
+	else 
+	{ // Wort als neues symbolisches Label uebernehmen
+	    a_value = mp_domain->add(m_word);           
+	}
     }
 }
     
@@ -89,7 +134,8 @@ SymbolicIO<T>::read(
     vorher eingelesen wurden, dann haben wir symbolische Bezeichner,
     die wir nun ausgeben koennen. Wenn der Werte-Bereich (gewollt oder
     ungewollt) vergroesset wurde, dann geben wir einfach die
-    entsprechende Zahl aus. */
+    entsprechende Zahl aus. Label, die read() nicht unveraendert
+    zuruecklesen wuerde, werden in ".." ausgegeben (needs_quotes()). */
 
 template <class T>
 void
@@ -108,7 +154,9 @@ const
     {
     os << setprecision( mp_domain->precision() );
     const string * p = mp_domain->identifier(a_value);
-    if (p==NULL) os << a_value; else os << (*p);
+    if (p==NULL) os << a_value; 
+    else if (needs_quotes(*p,mp_domain->mixed_mode())) write_quoted(os,*p);
+    else os << (*p);
     }
   }
 
@@ -8,6 +8,7 @@
 
 #include "algorithm.hpp"
 #include "logtrace.h"
+#include <algorithm> // stable_sort
 
 using namespace Data_Access_Library;
 namespace Data_Analysis_Library {
@@ -113,6 +114,31 @@ ReadRecord::done()
 
 ////////////////////////////////////////////////////////////////////
 
+/** \class CountRecords
+
+    Determines the number of records in a table, like ReadRecord
+    without successor. If the table knows its size from the index of
+    its input file (table modifier \c :x), the table is not read at
+    all. */
+
+void CountRecords::init()
+{
+    LOG_METHOD("DAA","CountRecords","init",mp_table->context()->name());
+    
+    ReadRecord::init();
+    long n = mp_table->record_count();
+    m_known = (n>=0);
+    if (m_known) m_count = n;
+}
+
+Algorithm::term_type 
+CountRecords::step()
+{
+    return (m_known) ? TERMINATE : ReadRecord::step();
+}
+
+////////////////////////////////////////////////////////////////////
+
 /* The successor algorithm is embedded into the done() method.  Acts
 as a filter, iterator algorithm is called only for elements in the
 resp. subset. */
@@ -174,6 +200,8 @@ SwapInputOutput<T>::step()
 
 template SwapInputOutput< BMasterTable >;
 template SwapInputOutput< BHMasterTable >;
+template SwapInputOutput< CMasterTable >;
+template SwapInputOutput< CHMasterTable >;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -189,6 +217,8 @@ SubmitBuffered<T>::step()
 
 template SubmitBuffered< BMasterTable >;
 template SubmitBuffered< BHMasterTable >;
+template SubmitBuffered< CMasterTable >;
+template SubmitBuffered< CHMasterTable >;
 
 ////////////////////////////////////////////////////////////////////
 
@@ -242,17 +272,20 @@ void DomainIterate::done()
     nochmals ausgelesen und dieses Mal auch geschrieben. */
 
 /** Create sorted index of table. For every record the sorting key is
-    constructed and stored together with the table file position in \c
-    m_index. */
+    constructed and moved (by swap(), without copying its values) to
+    \c m_keys, the table file position goes to \c m_marks. Then the
+    record indices in \c m_order are sorted by key. The sort is
+    stable, records with equal keys keep their order (as in the
+    multimap used before). */
 
 void
 SortedTableIteration::init()
 {
     LOG_METHOD("DAA","SortedTableIteration","init","");
 
-    tuple_type::value_type value;
+    key_type value;
     marker_type m;
-    m_index.clear();    
+    m_keys.clear(); m_marks.clear(); m_order.clear();
 
     // In sortierten Index einlesen
     mp_data->rewind();
@@ -261,28 +294,35 @@ SortedTableIteration::init()
 	mp_data->pop(); mp_data->getrpos(m);
 	matrix_copy(value,mp_key->val());
 	vector_concat(value,mp_key2->val());
-	m_index.insert( index_type::value_type(value,m) );
+	m_keys.push_back(key_type());
+	swap(m_keys.back(),value);
+	m_marks.push_back(m);
+	m_order.push_back(m_order.size());
     }
-    m_position = m_index.begin();
+
+    key_less less; less.mp_keys = &m_keys;
+    stable_sort(m_order.begin(),m_order.end(),less);
+    m_position = 0;
 }
 
 /** Iterate over sorted table. The records are read a second time from
-    the table in the order given by \c m_index. */
+    the table in the order given by \c m_order. */
 
 Algorithm::term_type
 SortedTableIteration::step()
 {
     LOG_METHOD("DAA","SortedTableIteration","step","");
 
-    term_type t = (m_position==m_index.end()) ? TERMINATE : CONTINUE;
+    const long n = m_order.size();
+    term_type t = (m_position==n) ? TERMINATE : CONTINUE;
 
     if (t == CONTINUE) 
     { 
-	mp_data->setrpos((*m_position).second); 
+	mp_data->setrpos(m_marks[ m_order[m_position] ]); 
 	mp_data->pop(); 
 
         ++m_position; 
-	t = eval_stop(t,m_position==m_index.end());
+	t = eval_stop(t,m_position==n);
     } 
 
     return t;
@@ -290,6 +330,7 @@ SortedTableIteration::step()
 
 void SortedTableIteration::done()
 {
+    m_keys.clear(); m_marks.clear(); m_order.clear();
 }
 
 //////////////////////////////////////////////////////////////////////
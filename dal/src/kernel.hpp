@@ -0,0 +1,58 @@
+
+/** \file kernel.hpp
+    \author Frank Hoppner <frank.hoeppner@ieee.org>
+    \brief Distance kernels on plain double arrays.
+
+    The kernels are used by the distance algorithms (distance.cpp),
+    but they do not depend on DAL and may be called directly, e.g.\
+    with DynTuple<double>::data(). On x86 processors vectorized
+    versions (SSE2, AVX2, AVX-512) are selected at program start
+    according to the processor, otherwise (or if the environment
+    variable \c DAL_KERNEL is set to \c scalar) a plain loop is
+    used. \c DAL_KERNEL=sse2|avx2|avx512 restricts the selection to
+    the given instruction set (if supported). Due to the different
+    order of summation the results of different kernels may differ
+    in the last bits. */
+
+#ifndef KERNEL_HEADER
+#define KERNEL_HEADER
+
+namespace Data_Analysis_Library {
+
+/// \f$ \|x-y\|^2 \f$ for vectors of length \c n
+double kernel_square_distance(const double* x,const double* y,int n);
+
+/** \f$ \|x-y\|^2 \f$ like kernel_square_distance() (with the same
+    result), but the summation is abandoned as soon as a partial sum
+    exceeds \c bound. In that case some value greater than \c bound
+    is returned. */
+double kernel_square_distance_bounded(const double* x,const double* y,int n,
+				      double bound);
+
+/// \f$ x^\top y \f$ for vectors of length \c n
+double kernel_dot_product(const double* x,const double* y,int n);
+
+/** Squared distances of \c m vectors \c X (stored row by row, each
+    of length \c n) to \c l vectors \c Y: \f$ D_{ij} = \|x_i-y_j\|^2
+    = \|x_i\|^2 + \|y_j\|^2 - 2 x_i^\top y_j \f$ (\c D has \c m
+    rows of length \c l). The squared norms are passed in \c xx and
+    \c yy, such that the norms of fixed reference vectors are
+    calculated only once. Due to cancellation the result differs from
+    kernel_square_distance() by up to about \f$ 2(n+2)\epsilon
+    (\|x_i\|^2+\|y_j\|^2) \f$ and may even be slightly negative. */
+void kernel_square_distance_block(const double* X,const double* xx,int m,
+				  const double* Y,const double* yy,int l,int n,
+				  double* D);
+
+/// \f$ \|x-sy\|^2 \f$ with \f$ s=x^\top y/\|y\|^2 \f$ (returned in \c s)
+double kernel_scaled_distance(const double* x,const double* y,int n,double& s);
+
+/// \f$ (x-y)^\top A (x-y) \f$ with \c A stored row by row (\c n x \c n)
+double kernel_quadratic_form(const double* x,const double* y,const double* A,int n);
+
+/// name of the selected kernel set ("scalar", "sse2", "avx2", "avx512")
+const char* kernel_name();
+
+}; // namespace
+
+#endif // KERNEL_HEADER
@@ -19,12 +19,55 @@
 #endif
 #include "matvecop.hpp"
 #include <string.h> // memcpy
+#include <new> // placement new
+
+/** Speicher fuer die Felder von DynTuple und DynMatrix. Felder bis
+    zu einigen KB kommen aus Groessenklassen (16-Byte-Schritte bis 256
+    Bytes, darueber Zweierpotenzen), die aus grossen Bloecken (Slabs)
+    geschnitten werden; freigegebene Felder wandern in die Freiliste
+    ihrer Klasse und werden dort wiederverwendet. Groessere Felder werden direkt allokiert. Die
+    angeforderte Groesse wird auf die Klassengroesse aufgerundet.
+    slab_trim() gibt vollstaendig freie Bloecke zurueck. [datarep.cpp] */
+
+void* slab_alloc(size_t& a_bytes);
+void slab_free(void* p,size_t a_bytes);
+void slab_trim();
+long slab_bytes();
+
+/** Feld fuer (mindestens) \a n Elemente, \a n wird auf die
+    tatsaechliche Kapazitaet gesetzt. */
+
+template <class T>
+inline T* matvec_new(int& n)
+{
+  if (n<=0) { n=0; return NULL; }
+  size_t bytes = n*sizeof(T);
+  T* p = (T*)slab_alloc(bytes);
+  n = bytes/sizeof(T);
+  for (int i=0;i<n;++i) new(p+i) T;
+  return p;
+}
+
+/** Feld mit Kapazitaet \a n zurueckgeben. */
+
+template <class T>
+inline void matvec_delete(T* p,int n)
+{
+  if (p!=NULL) slab_free(p,n*sizeof(T));
+}
+
+/** Groesse des internen Puffers von DynTuple und DynMatrix (Bytes).
+    Kurze Vektoren und kleine Matrizen kommen ohne Allokation aus. */
+
+#define MATVEC_LOCAL_BYTES 64
 
 /** Neudimensionierung eines 1D/2D Feldes (zeilenweise gespeichert)
-    unter Beibehaltung der zuvor bereits gesetzten Eintraege. */
+    unter Beibehaltung der zuvor bereits gesetzten Eintraege. Der
+    interne Puffer \a p_local (falls vorhanden) wird nicht
+    freigegeben. */
  
 template <class T>
-T* adjust(T* p_field,int &rows,int &cols,int &cap,int newrows,int newcols)
+T* adjust(T* p_field,int &rows,int &cols,int &cap,int newrows,int newcols,T* p_local=NULL)
 {
   int newcap = newrows*newcols;
   T* p;
@@ -33,9 +76,9 @@ T* adjust(T* p_field,int &rows,int &cols,int &cap,int newrows,int newcols)
   { // Kopie von Vektor nach Vektor ist unkritisch, Reihenfolge bleibt identisch
     if (newcap>cap)
     { // mehr Speicher erforderlich
-      p = new T[newcap];
-      memcpy(p,p_field,sizeof(T)*cap);
-      delete[] p_field;
+      p = matvec_new<T>(newcap);
+      if (cap>0) memcpy(p,p_field,sizeof(T)*cap);
+      if (p_field!=p_local) matvec_delete(p_field,cap);
     }
     else
     { // bisheriger Speicher reicht, alles bleibt
@@ -47,11 +90,11 @@ T* adjust(T* p_field,int &rows,int &cols,int &cap,int newrows,int newcols)
   { // echte Matrixkopie (kein Vektor)
     if (newcap>cap)
     { // mehr Speicher erforderlich
-      p = new T[newcap];
+      p = matvec_new<T>(newcap);
       for (int i=0;i<min(rows,newrows);++i)
         for (int j=0;j<min(cols,newcols);++j)
           p[i*newcols+j] = p_field[i*cols+j];
-      delete[] p_field;
+      if (p_field!=p_local) matvec_delete(p_field,cap);
     }
     else 
     { // bisheriger Speicher reicht, lokale Doppelkopie (kann man
@@ -81,39 +124,42 @@ T* adjust(T* p_field,int &rows,int &cols,int &cap,int newrows,int newcols)
   INVARIANT(c==1,"vector type, illegal adjust request c="<<c);
 
 /** Vektor mit dynamischer Groesse. Einmal allokierter Speicher wird
-    erst wieder im Destruktor freigegeben. */
+    erst wieder im Destruktor freigegeben (siehe matvec_new()). Bis
+    zu MATVEC_LOCAL_BYTES liegen die Werte im Objekt selbst. Statt
+    einer Kopie kann mit swap() der Inhalt getauscht werden. */
 
 template <class T>
 class DynTuple
 {
 public:
   typedef T value_type;
+  enum { local_size = (sizeof(T)<MATVEC_LOCAL_BYTES) ? MATVEC_LOCAL_BYTES/sizeof(T) : 1 };
 
   DynTuple()
-    : m_array_size(0), mp_field(NULL), m_rows(0) {}
+    : m_array_size(local_size), mp_field(m_local), m_rows(0) {}
   DynTuple(const DynTuple& M)
-    : m_array_size(M.m_rows), mp_field(NULL), m_rows(M.m_rows)
-    { if (m_array_size>0) { mp_field=new T[m_array_size]; memcpy(mp_field,M.mp_field,sizeof(T)*m_array_size); } }
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
+    { alloc(M.m_rows); if (m_rows>0) memcpy(mp_field,M.mp_field,sizeof(T)*m_rows); }
   explicit DynTuple(const T a)
-    : m_array_size(0), mp_field(NULL), m_rows(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
     { matrix_set_vector(*this,a); }
   explicit DynTuple(const T a,const T b)
-    : m_array_size(0), mp_field(NULL), m_rows(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
     { matrix_set_vector(*this,a,b); }
   explicit DynTuple(const T a,const T b,const T c)
-    : m_array_size(0), mp_field(NULL), m_rows(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
     { matrix_set_vector(*this,a,b,c); }
   explicit DynTuple(const T a,const T b,const T c,const T d)
-    : m_array_size(0), mp_field(NULL), m_rows(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
     { matrix_set_vector(*this,a,b,c,d); }
   explicit DynTuple(const T a,const T b,const T c,const T d,const T e)
-    : m_array_size(0), mp_field(NULL), m_rows(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0)
     { matrix_set_vector(*this,a,b,c,d,e); }
  ~DynTuple()
-    { if (mp_field!=NULL) { delete[] mp_field; mp_field=NULL; } }
+    { if (mp_field!=m_local) matvec_delete(mp_field,m_array_size); }
 
   const DynTuple& operator=(const DynTuple& M)
-    { alloc(M.m_rows); memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); return *this; }
+    { alloc(M.m_rows); if (M.size()>0) memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); return *this; }
   bool operator<(const DynTuple& M) const
     { return matrix_lexico_less(*this,M); }
   bool operator==(const DynTuple& M) const
@@ -132,12 +178,28 @@ public:
   inline int cols() const { return 1; }
   inline int size() const { return m_rows; }
   inline int capacity() const { return m_array_size; }
+  /// Direkter Zugriff auf die Werte (ohne Bereichspruefung)
+  inline const T* data() const { return mp_field; }
+  inline T* data() { return mp_field; }
 
   void alloc(int r,int c=1)
-    { MVONE(c); if (r>m_array_size) { if (mp_field!=NULL) delete[] mp_field; mp_field=new T[r]; m_array_size=r; }
+    { MVONE(c); if (r>m_array_size) { if (mp_field!=m_local) matvec_delete(mp_field,m_array_size); 
+	m_array_size=r; mp_field=matvec_new<T>(m_array_size); }
       m_rows=r; } 
   void adjust(int r,int c=1)
-    { MVONE(c); int cols=1; mp_field = ::adjust(mp_field,m_rows,cols,m_array_size,r,1); }
+    { MVONE(c); int cols=1; mp_field = ::adjust(mp_field,m_rows,cols,m_array_size,r,1,m_local); }
+  /// Inhalt tauschen (ohne Kopie der allokierten Felder)
+  void swap(DynTuple& M)
+    { 
+      T *p = (mp_field==m_local) ? NULL : mp_field;
+      T *q = (M.mp_field==M.m_local) ? NULL : M.mp_field;
+      T h[local_size];
+      memcpy(h,m_local,sizeof(h)); memcpy(m_local,M.m_local,sizeof(h)); memcpy(M.m_local,h,sizeof(h));
+      mp_field = (q==NULL) ? m_local : q;
+      M.mp_field = (p==NULL) ? M.m_local : p;
+      int n=m_array_size; m_array_size=M.m_array_size; M.m_array_size=n;
+      n=m_rows; m_rows=M.m_rows; M.m_rows=n;
+    }
   void write(ostream& os) const
     { matrix_write_dim(os,*this,StandardIO<T>()); }
   void read(istream& is)
@@ -145,10 +207,15 @@ public:
 
 protected:
   int m_array_size; ///< Groesse des allokierten Feldes
-  T *mp_field; ///< Zeiger auf dynamisch allokiertes Feld
+  T *mp_field; ///< Zeiger auf dynamisch allokiertes Feld (oder m_local)
   int m_rows; ///< Groesse des Vektors
+  T m_local[local_size]; ///< interner Puffer fuer kurze Vektoren
 };
 
+template <class T>
+inline void swap(DynTuple<T>& a,DynTuple<T>& b)
+  { a.swap(b); }
+
 template <class T>
 inline istream& operator>>(istream &is,DynTuple<T>& a_var) 
   { a_var.read(is); return is; }
@@ -225,39 +292,41 @@ inline ostream& operator<<(ostream &os,const StatTuple<ROWS,T>& a_var)
   { a_var.write(os); return os; }
 
 /** Matrix mit dynamischer Groesse. Einmal allokierter Speicher wird
-    erst im Destruktor wieder freigegeben. */
+    erst im Destruktor wieder freigegeben (siehe matvec_new()). Kleine
+    Matrizen liegen im Objekt selbst (vgl. DynTuple). */
 
 template <class T>
 class DynMatrix
 {
 public:
   typedef T value_type;
+  enum { local_size = (sizeof(T)<MATVEC_LOCAL_BYTES) ? MATVEC_LOCAL_BYTES/sizeof(T) : 1 };
 
   DynMatrix() 
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0) {}
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0) {}
   DynMatrix(const DynMatrix& M)
-    : m_array_size(M.m_array_size), mp_field(new T[M.size()]), m_rows(M.m_rows)
-    , m_cols(M.m_cols) { memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); }
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
+    { alloc(M.m_rows,M.m_cols); if (M.size()>0) memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); }
   explicit DynMatrix(const T a)
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
     { matrix_set_vector(*this,a); }
   explicit DynMatrix(const T a,const T b)
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
     { matrix_set_track(*this,a,b); }
   explicit DynMatrix(const T a,const T b,const T c)
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
     { matrix_set_track(*this,a,b,c); }
   explicit DynMatrix(const T a,const T b,const T c,const T d)
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
     { matrix_set_track(*this,a,b,c,d); }
   explicit DynMatrix(const T a,const T b,const T c,const T d,const T e)
-    : m_array_size(0), mp_field(NULL), m_rows(0), m_cols(0)
+    : m_array_size(local_size), mp_field(m_local), m_rows(0), m_cols(0)
     { matrix_set_track(*this,a,b,c,d,e); }
   ~DynMatrix()
-    { if (mp_field!=NULL) { delete[] mp_field; mp_field=NULL; } }
+    { if (mp_field!=m_local) matvec_delete(mp_field,m_array_size); }
 
   const DynMatrix& operator=(const DynMatrix& M)
-    { alloc(M.m_rows,M.m_cols); memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); return *this; }
+    { alloc(M.m_rows,M.m_cols); if (M.size()>0) memcpy(mp_field,M.mp_field,sizeof(T)*M.size()); return *this; }
   bool operator<(const DynMatrix& M) const
     { return matrix_lexico_less(*this,M); }
   bool operator==(const DynMatrix& M) const
@@ -276,12 +345,29 @@ public:
   inline int cols() const { return m_cols; }
   inline int size() const { return m_rows*m_cols; }
   inline int capacity() const { return m_array_size; }
+  /// Direkter Zugriff auf die Werte (zeilenweise, ohne Bereichspruefung)
+  inline const T* data() const { return mp_field; }
+  inline T* data() { return mp_field; }
 
   void alloc(int r,int c=1)
-    { if (r*c>m_array_size) { if (mp_field!=NULL) delete[] mp_field; mp_field=new T[r*c]; m_array_size=r*c; }
+    { if (r*c>m_array_size) { if (mp_field!=m_local) matvec_delete(mp_field,m_array_size); 
+	m_array_size=r*c; mp_field=matvec_new<T>(m_array_size); }
       m_rows=r; m_cols=c; } 
   void adjust(int r,int c=1)
-    { mp_field = ::adjust(mp_field,m_rows,m_cols,m_array_size,r,c); }
+    { mp_field = ::adjust(mp_field,m_rows,m_cols,m_array_size,r,c,m_local); }
+  /// Inhalt tauschen (ohne Kopie der allokierten Felder)
+  void swap(DynMatrix& M)
+    { 
+      T *p = (mp_field==m_local) ? NULL : mp_field;
+      T *q = (M.mp_field==M.m_local) ? NULL : M.mp_field;
+      T h[local_size];
+      memcpy(h,m_local,sizeof(h)); memcpy(m_local,M.m_local,sizeof(h)); memcpy(M.m_local,h,sizeof(h));
+      mp_field = (q==NULL) ? m_local : q;
+      M.mp_field = (p==NULL) ? M.m_local : p;
+      int n=m_array_size; m_array_size=M.m_array_size; M.m_array_size=n;
+      n=m_rows; m_rows=M.m_rows; M.m_rows=n;
+      n=m_cols; m_cols=M.m_cols; M.m_cols=n;
+    }
   void write(ostream& os) const
     { matrix_write_dim(os,*this,StandardIO<T>()); }
   void read(istream& is)
@@ -289,11 +375,16 @@ public:
 
 protected:
   int m_array_size; ///< Groesse des allokierten Feldes
-  T *mp_field; ///< Zeiger auf das allokierte Feld
+  T *mp_field; ///< Zeiger auf das allokierte Feld (oder m_local)
   int m_rows; ///< Anzahl der Zeilen der Matrix
   int m_cols; ///< Anzahl der Spalten der Matrix
+  T m_local[local_size]; ///< interner Puffer fuer kleine Matrizen
 };
 
+template <class T>
+inline void swap(DynMatrix<T>& a,DynMatrix<T>& b)
+  { a.swap(b); }
+
 template <class T>
 inline istream& operator>>(istream &is,DynMatrix<T>& a_var) 
   { a_var.read(is); return is; }
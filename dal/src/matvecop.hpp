@@ -724,7 +724,7 @@ template <class T>
 class StandardIO
   {
   public:
-    inline void read(istream& is,T& val,const char* = NULL) const { is >> val; }
+    inline void read(istream& is,T& val,const char* = NULL) const { scan_number(is,val); }
     inline void write(ostream& os,const T& val) const { os << val; }
     inline bool symbolic() const { return false; }
   };
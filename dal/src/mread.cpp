@@ -13,6 +13,8 @@
 #include "logtrace.h"
 #include "matvecop.hpp"
 #include <ctype.h> // isspace
+#include <stdio.h> // EOF
+#include <stdlib.h> // strtod, strtol
 
 /* matrix_read_dim => hier wird durch Angabe der Dimensionen die
 Reihenfolge und Lage der Daten in der Matrix eindeutig, bevor wir die
@@ -30,7 +32,226 @@ erlaubt auch das benutzerseitige Einstellen der separatoren.
 mglw noch T fuer transponierten Vektor (einzelne zeile)
 */
 
-# define MV_SKIP(c) if ((!is_followed_by(is,c,false)) && (!isspace(c))) ERROR("missing "<<#c<<" "<<c);
+# define MV_SKIP(c) if ((!mv_followed_by(is,c,false)) && (!isspace(c))) ERROR("missing "<<#c<<" "<<c);
+
+/// maximale Laenge einer einzelnen Zahl im Eingabestrom
+# define MV_NUMLEN 128
+
+/** Wie is_followed_by(istream&,char,...), arbeitet aber direkt auf
+    dem streambuf. Statt get()/putback() wird das naechste Zeichen
+    nur angesehen und bei Erfolg verbraucht. */
+
+static inline bool mv_followed_by
+(
+  istream& is,
+  char a_letter,
+  bool put_back_if_found = true
+)
+{
+  if (is.eof() || !is.good()) return false;
+  streambuf *sb = is.rdbuf();
+  int c = sb->sgetc();
+  if (c==EOF) { is.clear(is.rdstate()|ios::eofbit|ios::failbit); return false; }
+  bool match = (toupper(c)==toupper(a_letter));
+  if ((match) && (!put_back_if_found)) sb->sbumpc();
+  return match;
+}
+
+/** Whitespaces ueberlesen (direkt auf dem streambuf), liefert das
+    naechste Zeichen (ohne es zu entfernen) oder EOF. */
+
+static inline int mv_skip_white
+(
+  istream& is
+)
+{
+  if (is.eof() || !is.good()) return EOF;
+  streambuf *sb = is.rdbuf();
+  int c = sb->sgetc();
+  while ((c!=EOF) && (isspace(c))) c = sb->snextc();
+  if (c==EOF) is.clear(is.rdstate()|ios::eofbit);
+  return c;
+}
+
+/** Die Zeichen einer Zahl aus dem Strom in den Puffer \c p kopieren
+    (ohne Interpretation, [+-]ziffern[.ziffern][e[+-]ziffern]). Bei
+    \c real==false nur Vorzeichen und Ziffern. Rueckgabe ist die
+    Anzahl der Zeichen, 0 wenn keine Zahl folgt oder der Puffer nicht
+    ausreicht. */
+
+static int mv_gather
+(
+  istream& is,
+  char *p,
+  bool real
+)
+{
+  int c = mv_skip_white(is);
+  if (c==EOF) return 0;
+  streambuf *sb = is.rdbuf();
+  int n = 0, state = 0; // 0 Vorzeichen, 1 Ziffern, 2 Nachkomma, 3 Exp-Vorzeichen, 4 Exponent
+  while ((c!=EOF) && (n<MV_NUMLEN-1))
+  {
+    if (isdigit(c)) { if (state==0) state=1; else if (state==3) state=4; }
+    else if (((c=='-')||(c=='+')) && ((state==0)||(state==3))) 
+      { if (state==0) state=1; else state=4; }
+    else if ((real) && (c=='.') && (state<=1)) state=2;
+    else if ((real) && ((c=='e')||(c=='E')) && (state>=1) && (state<=2)) state=3;
+    else break;
+    p[n++] = c;
+    c = sb->snextc();
+  }
+  if (c==EOF) is.clear(is.rdstate()|ios::eofbit);
+  else if (n==MV_NUMLEN-1) return 0;
+  p[n] = '\0';
+  return n;
+}
+
+/** Prueft, ob im Strom (nach Whitespaces) eine Zahl folgt, also eine
+    Ziffer, ein Punkt oder ein Minuszeichen. Die Whitespaces werden
+    entfernt, das erste Zeichen verbleibt im Strom. */
+
+bool number_follows
+(
+  istream& is
+)
+{
+  int c = mv_skip_white(is);
+  return (c!=EOF) && ((isdigit(c))||(c=='.')||(c=='-'));
+}
+
+/** Locale-unabhaengige Umwandlung einer Zahl im Bereich [p,e) nach
+    double. Rueckgabe ist der Zeiger hinter das letzte verwendete
+    Zeichen (\c p, falls keine Zahl gefunden wurde).
+
+    Solange die Mantisse hoechstens 15 signifikante Stellen hat und
+    der Zehnerexponent betragsmaessig nicht groesser als 22 ist, sind
+    Mantisse und Zehnerpotenz exakt als double darstellbar, so dass
+    eine einzige Multiplikation bzw. Division den korrekt gerundeten
+    Wert liefert. Alle anderen (seltenen) Faelle gehen an strtod(). */
+
+const char* parse_number
+(
+  const char *p,
+  const char *e,
+  double& a_value
+)
+{
+  static const double pow10[] = 
+    { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+      1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22 };
+
+  const char *start = p;
+  bool neg = false, exact = true, any = false;
+  if ((p<e) && ((*p=='-')||(*p=='+'))) { neg = (*p=='-'); ++p; }
+
+  double mantissa = 0;
+  int digits = 0, exp10 = 0;
+  for (;(p<e) && (isdigit(*p));++p)
+  {
+    any = true;
+    if ((digits==0) && (*p=='0')) continue;
+    if (digits<15) mantissa = mantissa*10 + (*p-'0'); else { exact = false; ++exp10; }
+    ++digits;
+  }
+  if ((p<e) && (*p=='.'))
+  {
+    for (++p;(p<e) && (isdigit(*p));++p)
+    {
+      any = true;
+      if ((digits==0) && (*p=='0')) { --exp10; continue; }
+      if (digits<15) { mantissa = mantissa*10 + (*p-'0'); --exp10; } else exact = false;
+      ++digits;
+    }
+  }
+  if (!any) return start;
+
+  if ((p<e) && ((*p=='e')||(*p=='E')))
+  {
+    const char *q = p+1;
+    bool eneg = false;
+    if ((q<e) && ((*q=='-')||(*q=='+'))) { eneg = (*q=='-'); ++q; }
+    if ((q<e) && (isdigit(*q)))
+    {
+      int x = 0;
+      for (;(q<e) && (isdigit(*q));++q) if (x<100000) x = x*10 + (*q-'0');
+      exp10 += (eneg)?-x:x;
+      p = q;
+    }
+  }
+
+  if (mantissa==0) 
+    a_value = 0;
+  else if ((exact) && (exp10>=-22) && (exp10<=22))
+    a_value = (exp10<0) ? mantissa/pow10[-exp10] : mantissa*pow10[exp10];
+  else
+  { // seltener Fall, strtod braucht eine 0-terminierte Zeichenkette
+    string text(start,p);
+    a_value = strtod(text.c_str(),NULL);
+    return p;
+  }
+  if (neg) a_value = -a_value;
+  return p;
+}
+
+/** Schnelles Einlesen einer reellen Zahl aus einem Strom. Anders als
+    operator>> arbeitet die Funktion direkt auf dem streambuf und ist
+    unabhaengig vom eingestellten locale. Bei Misserfolg wird das
+    failbit gesetzt. */
+
+bool scan_number
+(
+  istream& is,
+  double& a_value
+)
+{
+  char buffer[MV_NUMLEN];
+  int n = mv_gather(is,buffer,true);
+  if ((n==0) || (parse_number(buffer,buffer+n,a_value)!=buffer+n))
+    { is.clear(is.rdstate()|ios::failbit); return false; }
+  return true;
+}
+
+bool scan_number
+(
+  istream& is,
+  float& a_value
+)
+{
+  double x;
+  if (!scan_number(is,x)) return false;
+  a_value = x;
+  return true;
+}
+
+/** Schnelles Einlesen einer ganzen Zahl, siehe scan_number(istream&,double&). */
+
+bool scan_number
+(
+  istream& is,
+  long& a_value
+)
+{
+  char buffer[MV_NUMLEN];
+  char *end = buffer;
+  int n = mv_gather(is,buffer,false);
+  if (n>0) a_value = strtol(buffer,&end,10);
+  if ((n==0) || (end!=buffer+n))
+    { is.clear(is.rdstate()|ios::failbit); return false; }
+  return true;
+}
+
+bool scan_number
+(
+  istream& is,
+  int& a_value
+)
+{
+  long x;
+  if (!scan_number(is,x)) return false;
+  a_value = x;
+  return true;
+}
 
 /** Struktur zur Spezifizierung der Ein/Ausgabesymbole.
 
@@ -190,7 +411,7 @@ matrix_read
 
   read_white(is);
 
-  if (!is_followed_by(is,p->m_seq_begin,false))
+  if (!mv_followed_by(is,p->m_seq_begin,false))
   { // einzelne Zahl als 1x1 Matrix lesen
     A.alloc(1,1);
     io.read(is,A(0,0),breakchars);
@@ -202,13 +423,13 @@ matrix_read
     // Matrix. Zunaechst machen wir aus A einen Vektor:
     A.alloc(A.capacity());
 
-    if (is_followed_by(is,p->m_seq_begin))
+    if (mv_followed_by(is,p->m_seq_begin))
     { // Matrix einlesen
       int r = 0, lastcols = 0, i = 0;
-      while (is_followed_by(is,p->m_seq_begin,false))
+      while (mv_followed_by(is,p->m_seq_begin,false))
       {
         int c = 0;
-        while (!is_followed_by(is,p->m_seq_end))
+        while (!mv_followed_by(is,p->m_seq_end))
         {
           if (c!=0) MV_SKIP(p->m_val_sep);
           // anfangs um einen Wert, spaeter um eine Zeile vergroessern
@@ -219,7 +440,7 @@ matrix_read
         if (lastcols==0) lastcols=c;
         if (c!=lastcols) ERROR("matrix with varying row size");
         ++r;
-        if (!is_followed_by(is,p->m_seq_end,false)) ERROR(p->m_seq_end);
+        if (!mv_followed_by(is,p->m_seq_end,false)) ERROR(p->m_seq_end);
       }
       // Und jetzt aus dem Vektor per alloc() eine Matrix machen
       A.alloc(r,lastcols);
@@ -227,7 +448,7 @@ matrix_read
     else
     { // Vector einlesen (Spaltenvektor)
       int r(0);
-      while (!is_followed_by(is,p->m_seq_end))
+      while (!mv_followed_by(is,p->m_seq_end))
       {
         if (r!=0) MV_SKIP(p->m_val_sep);
         // hier erhoehen wir immer um 2 Felder
@@ -266,7 +487,7 @@ void matrix_read_dim
 
   // Vorspann bearbeiten ? (wenn kein Vorspann, dann rufen wir die
   // Routine ohne Dimensionbetrachtungen auf)
-  if ((!p->m_eval_hdr) || (!is_followed_by(is,p->m_dim_begin))) 
+  if ((!p->m_eval_hdr) || (!mv_followed_by(is,p->m_dim_begin))) 
     { matrix_read(is,matrix,io,p); return; }
 
   // Wann soll das Lesen eines (symbolischen) Labels abgebrochen
@@ -281,10 +502,10 @@ void matrix_read_dim
   // Dimensionen einlesen
   int rows,cols; 
   MV_SKIP(p->m_dim_begin);
-  is >> rows;
-  if (!is_followed_by(is,p->m_cross,false)) cols=1; else is >> cols;
+  scan_number(is,rows);
+  if (!mv_followed_by(is,p->m_cross,false)) cols=1; else scan_number(is,cols);
   // Modifikator einlesen
-  if (is_followed_by(is,p->m_colon,false)) is >> mod;
+  if (mv_followed_by(is,p->m_colon,false)) is >> mod;
   MV_SKIP(p->m_dim_end);
   // Matrix initialisieren
   matrix.adjust(rows,cols); 
@@ -347,11 +568,11 @@ void matrix_read_dim
   { // Duenn besetzte Matrix auslesen
     MV_SKIP(p->m_seq_begin);
     int r,c; typename M::value_type v;
-    while (is_followed_by(is,p->m_seq_begin,false))
+    while (mv_followed_by(is,p->m_seq_begin,false))
     { 
-      is >> r; MV_SKIP(p->m_val_sep);
-      is >> c; MV_SKIP(p->m_val_sep);
-      is >> v; MV_SKIP(p->m_seq_end);
+      scan_number(is,r); MV_SKIP(p->m_val_sep);
+      scan_number(is,c); MV_SKIP(p->m_val_sep);
+      scan_number(is,v); MV_SKIP(p->m_seq_end);
       if (r>rows) ERROR("row exceeds dimensions in sparse matrix");
       if (c>cols) ERROR("col exceeds dimensions in sparse matrix");
       matrix(r-1,c-1)=v;
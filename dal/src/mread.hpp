@@ -35,6 +35,18 @@ extern matrix_separators g_matrix_table_separators;
 extern matrix_separators g_matrix_colon_separators;
 extern matrix_separators g_matrix_readable_separators;
 
+bool number_follows(istream&);
+const char* parse_number(const char*,const char*,double&);
+bool scan_number(istream&,double&);
+bool scan_number(istream&,float&);
+bool scan_number(istream&,long&);
+bool scan_number(istream&,int&);
+
+/** Fallback fuer alle uebrigen Typen: Einlesen per operator>>. */
+template <class T> inline 
+bool scan_number(istream& is,T& a_value)
+  { is >> a_value; return !is.fail(); }
+
 template <class M> 
 char matrix_get_type(const M& A,matrix_separators const * p = NULL);
 
@@ -1,12 +1,17 @@
 
 /** \file nnc.cpp
     \author Frank Hoppner <frank.hoeppner@ieee.org>
-    \brief Simple 1-Nearest Neighbour Classificator.
+    \brief Simple k-Nearest Neighbour Classificator.
 
     The examples \c <classified/value> with class label \c
     <classified/class> are used to predict the class of the examples
     \c <unclassified/value>. The predicted class is taken from the
-    nearest classified example (using the Euclidean distance).
+    \c k nearest classified examples (using the Euclidean distance) by
+    majority vote. The classified examples are read only once and kept
+    in a k-d tree, the unclassified examples are classified blockwise
+    by several threads (see BlockNearestNeighbour). For
+    high-dimensional data the distances of a block to all classified
+    examples are computed at once like a matrix product.
 
     Recognized fields:
     <ul>
@@ -22,8 +27,34 @@
     <li> \c <unclassified/class> (labels, out) : Predicted
     class. </li>
 
+    <li> \c <args/k> (count, in) : Number of nearest neighbours,
+    default 1. </li>
+
+    <li> \c <args/weighted> (boolean, in) : If true, votes are
+    weighted by the inverse squared distance, default false. </li>
+
+    <li> \c <args/threads> (count, in) : Number of threads, default 0
+    (number of processors). </li>
+
+    <li> \c <args/blocksize> (count, in) : Number of unclassified
+    examples per thread that are classified at once, default
+    1024. </li>
+
+    <li> \c <args/blockwise> (boolean, in) : If true, the distances
+    of high-dimensional examples (16 or more coordinates) are computed
+    blockwise instead of searching the k-d tree, default true. The
+    result is the same. </li>
+
+    <li> \c <args/reorder> (boolean, in) : If true, the coordinates
+    are compared in order of decreasing variance, such that distance
+    calculations in the k-d tree can be abandoned early, default
+    true. </li>
+
     </ul>
 
+    Example:
+    nnc "classified<train.csv unclassified<data.ddl>x.ddl args/k=5"
+
 */
 
 #ifndef EXCLUDE_FROM_TUTORIAL
@@ -47,26 +78,39 @@ int main(
     tuple_type value(&data,cREADOUT,"value",gp_dm_numeric);
     int_type predclass(&data,cWRITEBACK,"class",gp_dm_labels);
     
-    /*B*/MasterTable train(cMASTER,"classified");      // table "training data"
+    CMasterTable train(cMASTER,"classified");  // training data, column-wise
     tuple_type trainvalue(&train,cREADOUT,"value",gp_dm_numeric);
     int_type trainclass(&train,cREADOUT,"class",gp_dm_labels);
     
     real_type dist(NULL,cVOID,"distance");                         // temporary
     
+    /*B*/MasterTable args(cMASTER,"args");                       // parameters
+    int_type k(&args,cREADOUT,"k",gp_dm_count);
+    int_type weighted(&args,cREADOUT,"weighted",gp_dm_boolean);
+    int_type threads(&args,cREADOUT,"threads",gp_dm_count);
+    int_type reorder(&args,cREADOUT,"reorder",gp_dm_boolean);
+    int_type blocksize(&args,cREADOUT,"blocksize",gp_dm_count);
+    int_type blockwise(&args,cREADOUT,"blockwise",gp_dm_boolean);
+    
+    k.set_context_default("1");                            // default settings
+    weighted.set_context_default("false");
+    threads.set_context_default("0");
+    reorder.set_context_default("true");
+    blocksize.set_context_default("1024");
+    blockwise.set_context_default("true");
     evaluate_cmdline(argc,argv);
     
     Algorithm *p =
-	seq(fetch(&data),
-	    embed_loop(fetch(&train),
-		       euclidsqdist(&dist,&trainvalue,&value),
-		       selectmin(&dist,&trainclass,&predclass,
-				 writeback(&data))));
+	knearest(&data,&train,&trainvalue,&trainclass,&value,&dist,&predclass,
+		 &k,&weighted,&threads,writeback(&data),false,&reorder,
+		 &blocksize,&blockwise);
 
 
-    data.init(); train.init();
+    data.init(); train.init(); args.init();
     iterate_algorithm(&p);
     p->loop();
     /*data.submit();*/ data.close(); /*train.submit();*/ train.close();
+    args.close();
 }
 
 #endif // EXCLUDE_FROM_TUTORIAL
@@ -68,7 +68,7 @@ int main(
 
     Algorithm *p = 
 	seq(embed_loop_ifndef(&total,          // if <summ/total> not specified
-			      fetch(&data,&total)),       // then count records
+			      count_records(&data,&total)), // then count records
 	    embed_loop(fetch(&data),
 		       koutofn(&writesubsetonly,&count,&total,&included,
 			       writeback(&data))));
@@ -0,0 +1,592 @@
+/** \file selftest.cpp
+    \author Frank Hoppner <frank.hoeppner@ieee.org>
+    \brief Checks of library internals that are not visible in the
+    output of the other programs.
+
+    Usage: selftest <check> [<commands>], the exit status is 0 if the check
+    passes. Failed conditions are reported on stderr. Recognized
+    checks:
+    <ul>
+    <li> \c swap : DynTuple/DynMatrix swap() exchanges the allocated
+    fields without copying them (heap and local buffer). </li>
+    <li> \c slots : several threads create fields of the same data
+    types at once, each in its own RepositoryContext (slot assignment
+    and creation of the repositories race). </li>
+    <li> \c spill "data<file" : a BufferedTable with a small memory
+    budget (DAL_BUFFER_BYTES) keeps its records in order over several
+    passes, including those in the temporary files. The file must
+    hold the values 1..n in the field \c value. With a small
+    DAL_CHUNK_BYTES the same check covers the chunked bulk load (see
+    Chunked<T>). </li>
+    <li> \c cow "data<file buf<file" : after hold() (MasterTable
+    \c data) and push() (BufferedTable \c buf) the fields share their
+    entries with the held or pushed record; var() copies only the
+    field that is written, the shared original keeps its value. The
+    file must start with the value 1 in the field \c value. </li>
+    <li> \c pipelines "file" : several BufferedTables, each with its
+    own RepositoryContext, read and rewrite the same file in parallel
+    threads (created in the main thread, see RepositoryContext). The
+    file must hold the values 1..n in the field \c value. </li>
+    <li> \c kernels : the distance kernels of the selected set (see
+    kernel.hpp, \c DAL_KERNEL) agree with plain loops for all lengths
+    up to 40, i.e.\ including all remainders of the vector
+    loops. </li>
+    <li> \c distances : the algorithms dotdist(), seuclidsqdist() and
+    matdist() on a few vectors with known results. </li>
+    <li> \c slab : the size classes of slab_alloc(), and slab_trim()
+    returns the blocks of freed vectors, also those of an exited
+    thread (prints the resident memory before and after). </li>
+    </ul>
+    The checks are called from test/selftest/selftest.script. */
+
+#ifndef EXCLUDE_FROM_TUTORIAL
+
+#include "dal.hpp"
+#include "algorithm.hpp"
+#include <deque>
+#include <math.h>
+#include <stdio.h> // sprintf
+#include <float.h> // DBL_EPSILON
+#include <unistd.h> // sysconf
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+using namespace Data_Access_Library;
+using namespace Data_Analysis_Library;
+
+/// number of failed conditions
+static int g_failed = 0;
+
+#define CHECK(cond) \
+  if (!(cond)) { cerr << __FILE__ << ':' << __LINE__ << ": check failed: " << #cond << endl; ++g_failed; }
+
+/** swap() must hand over the allocated fields (the data pointer
+    moves with the contents), small vectors are exchanged within the
+    local buffers. The free swap() is used by the standard algorithms
+    and by SortedTableIteration. */
+
+static void
+check_swap()
+{
+  // heap allocated tuple vs. short (local) tuple
+  DynTuple<double> a,b;
+  a.alloc(100); for (int i=0;i<100;++i) a[i]=i;
+  b.alloc(3); b[0]=-1; b[1]=-2; b[2]=-3;
+  const double *pa = a.data();
+  swap(a,b);
+  CHECK(b.data()==pa);        // no copy of the 100 values
+  CHECK(b.size()==100 && b[99]==99);
+  CHECK(a.size()==3 && a[0]==-1 && a[2]==-3);
+  CHECK(a.data()!=pa);
+  swap(a,b);
+  CHECK(a.data()==pa && a.size()==100 && b.size()==3 && b[1]==-2);
+
+  // both heap allocated
+  DynTuple<double> c; c.alloc(50); c[49]=7;
+  const double *pc = c.data();
+  a.swap(c);
+  CHECK(a.data()==pc && c.data()==pa && a[49]==7 && c[99]==99);
+
+  // matrices
+  DynMatrix<double> m,n;
+  m.alloc(20,10); m(19,9)=5;
+  n.alloc(2,2); n(1,1)=3;
+  const double *pm = m.data();
+  swap(m,n);
+  CHECK(n.data()==pm && n.rows()==20 && n.cols()==10 && n(19,9)==5);
+  CHECK(m.rows()==2 && m.cols()==2 && m(1,1)==3);
+
+  // container elements are moved, not copied
+  std::deque< DynTuple<double> > d;
+  d.push_back(DynTuple<double>());
+  swap(d.back(),c);
+  CHECK(d.back().data()==pa && d.back().size()==100 && c.size()==0);
+}
+
+/// number of threads and rounds in check_slots()
+#define SLOT_THREADS 8
+#define SLOT_ROUNDS 200
+
+/** Create fields of all data types in a new RepositoryContext, set
+    their values and check that they keep them and that the other
+    fields still have their defaults. */
+
+static void*
+slot_worker(void *ap_id)
+{
+  const long id = (long)ap_id;
+  for (int round=0;round<SLOT_ROUNDS;++round)
+    {
+    RepositoryContext rc;
+    RepositoryContext::set_current(&rc);
+    {
+    int_type i(NULL,cVOID,"i"); index_type x(NULL,cVOID,"x"); 
+    long_type l(NULL,cVOID,"l"); real_type r(NULL,cVOID,"r"); 
+    string_type s(NULL,cVOID,"s"); 
+    int_tuple_type it(NULL,cVOID,"it"); tuple_type t(NULL,cVOID,"t");
+    int_matrix_type im(NULL,cVOID,"im"); matrix_type m(NULL,cVOID,"m");
+    abstract_data_type *fields[] = { &i,&x,&l,&r,&s,&it,&t,&im,&m };
+    const int n = sizeof(fields)/sizeof(fields[0]);
+    for (int k=0;k<n;++k) CHECK(fields[(k+id)%n]->repositories()==&rc);
+    CHECK(i()==0 && r()==0 && s().empty() && t().size()==0);
+
+    i.var() = id; x.var() = round; l.var() = id*round; r.var() = 0.5*id;
+    s.var() = "label"; t.var().alloc(20); t.var()[19] = id; 
+    m.var().alloc(3,3); m.var()(2,2) = round;
+    CHECK(i()==id && x()==(ix_type)round && l()==id*round && r()==0.5*id);
+    CHECK(s()=="label" && t()[19]==id && m()(2,2)==round);
+    CHECK(it().size()==0 && im().size()==0);
+    }
+    RepositoryContext::set_current(NULL);
+    }
+  return NULL;
+}
+
+/** Several threads create their fields at once. Without a lock on
+    the slot assignment and the lookup of repository entries, two
+    data types may get the same slot or a thread may see a half
+    initialized entry. */
+
+static void
+check_slots()
+{
+#ifdef HAVE_LIBPTHREAD
+  pthread_t threads[SLOT_THREADS];
+  for (long k=0;k<SLOT_THREADS;++k)
+    CHECK(pthread_create(&threads[k],NULL,&slot_worker,(void*)k)==0);
+  for (int k=0;k<SLOT_THREADS;++k)
+    pthread_join(threads[k],NULL);
+#else
+  for (long k=0;k<SLOT_THREADS;++k) slot_worker((void*)k);
+#endif
+
+  // the global context got its repositories and defaults as well
+  real_type r(NULL,cVOID,"r"); tuple_type t(NULL,cVOID,"t");
+  CHECK(r.repositories()==RepositoryContext::global());
+  CHECK(r()==0 && t().size()==0);
+}
+
+/** Read the table three times: the first pass doubles the values, the
+    second adds 1 (both through push() and swap()), the third only
+    reads (after rewind()). With DAL_BUFFER_BYTES set, a part of the
+    input and of the output goes to the temporary files. */
+
+static void
+check_spill(int argc,char** argv)
+{
+  BMasterTable data(cMASTER,"data");
+  real_type value(&data,cREADOUT|cWRITEBACK,"value");
+  evaluate_cmdline(argc,argv);                          // process user demands
+  data.init();
+  const long inspilled = data.spilled();
+
+  data.rewind();
+  long n=0;
+  while (!data.done())
+    { data.pop(); ++n; CHECK(value()==n); value.var()=2*value(); data.push(); }
+  const long records = n;
+  CHECK(records>0);
+  if (getenv("DAL_BUFFER_BYTES")!=NULL)
+    { // the full input must not push all output into the file
+    CHECK(inspilled>0);
+    CHECK(data.spilled()>inspilled && data.spilled()-inspilled<records);
+    }
+  cout << records << " records, " << data.spilled() << " in temporary files" << endl;
+
+  data.swap(); data.rewind(); n=0;
+  while (!data.done())
+    { data.pop(); ++n; CHECK(value()==2*n); value.var()=value()+1; data.push(); }
+  CHECK(n==records);
+
+  data.swap();
+  for (int pass=0;pass<2;++pass)
+    {
+    data.rewind(); n=0;
+    while (!data.done()) { data.pop(); ++n; CHECK(value()==2*n+1); }
+    CHECK(n==records);
+    }
+  data.close();
+}
+
+/// number of concurrent pipelines in check_pipelines()
+#define PIPELINES 4
+
+/// a table with its own repositories, run by pipeline_worker()
+struct pipeline_type
+{
+  RepositoryContext m_rc;
+  BMasterTable *mp_data;
+  real_type *mp_value;
+  long m_id;
+  long m_records;
+};
+
+/** Two passes over the table: the first checks the values 1..n and
+    multiplies them by the number of the pipeline, the second checks
+    the products. */
+
+static void*
+pipeline_worker(void *ap_pipeline)
+{
+  pipeline_type *p = (pipeline_type*)ap_pipeline;
+  BMasterTable& data = *p->mp_data;
+  real_type& value = *p->mp_value;
+  const long factor = p->m_id+2;
+  data.init();
+  data.rewind();
+  long n=0;
+  while (!data.done())
+    { data.pop(); ++n; CHECK(value()==n); value.var() = factor*value(); data.push(); }
+  data.swap(); data.rewind();
+  p->m_records = n; n=0;
+  while (!data.done()) { data.pop(); ++n; CHECK(value()==factor*n); }
+  CHECK(n==p->m_records);
+  data.close();
+  return NULL;
+}
+
+/** Pipelines in parallel threads. Tables and fields are created in
+    the main thread (the table names go into a shared Domain), each
+    in its own RepositoryContext; the threads only read and write
+    their values. */
+
+static void
+check_pipelines(const char *ap_file)
+{
+  pipeline_type pipelines[PIPELINES];
+  for (int k=0;k<PIPELINES;++k)
+    {
+    pipeline_type& p = pipelines[k];
+    char name[32]; sprintf(name,"pipe%d",k);
+    RepositoryContext::set_current(&p.m_rc);
+    p.mp_data = new BMasterTable(cMASTER,name);
+    p.mp_value = new real_type(p.mp_data,cREADOUT|cWRITEBACK,"value");
+    p.mp_data->context()->infile() = ap_file;
+    p.m_id = k; p.m_records = 0;
+    CHECK(p.mp_value->repositories()==&p.m_rc);
+    }
+  RepositoryContext::set_current(NULL);
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_t threads[PIPELINES];
+  for (int k=0;k<PIPELINES;++k)
+    CHECK(pthread_create(&threads[k],NULL,&pipeline_worker,&pipelines[k])==0);
+  for (int k=0;k<PIPELINES;++k)
+    pthread_join(threads[k],NULL);
+#else
+  for (int k=0;k<PIPELINES;++k) pipeline_worker(&pipelines[k]);
+#endif
+
+  for (int k=0;k<PIPELINES;++k)
+    {
+    CHECK(pipelines[k].m_records>0 && pipelines[k].m_records==pipelines[0].m_records);
+    delete pipelines[k].mp_value;
+    delete pipelines[k].mp_data;
+    }
+}
+
+/** Copy on write of shared field entries (see data_type<T>::share()):
+    writing one field after hold() or push() gives it a new entry,
+    the other field keeps the shared one. */
+
+static void
+check_cow(int argc,char** argv)
+{
+  MasterTable data(cMASTER,"data");
+  real_type value(&data,cREADOUT,"value");
+  tuple_type vec(&data,cVOID,"vec");
+  BMasterTable buf(cMASTER,"buf");
+  real_type bvalue(&buf,cREADOUT|cWRITEBACK,"value");
+  tuple_type bvec(&buf,cVOID,"vec");
+  evaluate_cmdline(argc,argv);
+
+  // hold(): the record and the fields share the entries
+  data.init(); data.pop();
+  CHECK(value()==1);
+  vec.var().alloc(3); vec.var()[0] = 4;
+  ix_type held = data.hold();
+  const ix_type ivalue = value.get_ix(), ivec = vec.get_ix();
+  value.var() = 10;
+  CHECK(value.get_ix()!=ivalue && vec.get_ix()==ivec);
+  CHECK(value()==10 && vec()[0]==4);
+  data.restore(held); // the held record is unchanged
+  CHECK(value()==1 && vec()[0]==4);
+  data.close();
+
+  // push(): the pushed record and the fields share the entries
+  buf.init(); buf.rewind(); buf.pop();
+  CHECK(bvalue()==1);
+  bvec.var().alloc(3); bvec.var()[0] = 4;
+  buf.push();
+  const ix_type ibvalue = bvalue.get_ix(), ibvec = bvec.get_ix();
+  bvec.var()[0] = 7;
+  CHECK(bvec.get_ix()!=ibvec && bvalue.get_ix()==ibvalue);
+  buf.push();
+  buf.swap(); buf.rewind();
+  buf.pop();
+  CHECK(bvalue()==1 && bvec()[0]==4);
+  buf.pop();
+  CHECK(bvalue()==1 && bvec()[0]==7);
+  buf.close();
+}
+
+/// longest vector in check_kernels()
+#define KERNEL_LENGTH 40
+
+/// small integers in [-8,8] (exact sums in any order) or reals in [-1,1]
+static double
+sample(bool a_integer)
+{
+  int r = rand();
+  return a_integer ? (r%17)-8 : 2.0*r/RAND_MAX-1;
+}
+
+/** Compare the kernels with plain loops. On integer vectors all
+    kernels must be exact (every partial sum is an integer), on real
+    vectors they may differ by rounding. The vectors start at odd
+    addresses (offset 1), such that unaligned loads are needed. */
+
+static void
+check_kernels()
+{
+  cout << "kernel set " << kernel_name() << endl;
+  const int L = KERNEL_LENGTH;
+  srand(23);
+  for (int pass=0;pass<2;++pass)
+    {
+    const bool integer = (pass==0);
+    vector<double> xbuf(L+1),ybuf(L+1),abuf(L*L+1);
+    double *x=&xbuf[1],*y=&ybuf[1],*A=&abuf[1];
+    for (int n=0;n<=L;++n)
+      {
+      for (int i=0;i<n;++i) { x[i]=sample(integer); y[i]=sample(integer); }
+      if (n>0) y[0] = 1+fabs(y[0]); // y!=0 for the scaled distance
+      for (int i=0;i<n*n;++i) A[i]=sample(integer);
+
+      double dd=0,dot=0,xx=0,yy=0;
+      for (int i=0;i<n;++i) 
+	{ dd+=(x[i]-y[i])*(x[i]-y[i]); dot+=x[i]*y[i]; xx+=x[i]*x[i]; yy+=y[i]*y[i]; }
+      double q=0;
+      for (int i=0;i<n;++i)
+	for (int j=0;j<n;++j) q+=(x[i]-y[i])*A[i*n+j]*(x[j]-y[j]);
+      const double tol = integer ? 0 : 4*(n+1)*DBL_EPSILON*(xx+yy);
+      const double qtol = integer ? 0 : 4*(n+1)*(n+1)*DBL_EPSILON*(xx+yy);
+
+      double d = kernel_square_distance(x,y,n);
+      CHECK(fabs(d-dd)<=tol);
+      CHECK(kernel_square_distance_bounded(x,y,n,DBL_MAX)==d);
+      if (d>0)
+	{ // abandoned or not, the result must exceed the bound
+	CHECK(kernel_square_distance_bounded(x,y,n,0.5*d)>0.5*d);
+	CHECK(kernel_square_distance_bounded(x,y,n,2*d)==d);
+	}
+      CHECK(fabs(kernel_dot_product(x,y,n)-dot)<=tol);
+      CHECK(fabs(kernel_quadratic_form(x,y,A,n)-q)<=qtol);
+      if (n>0)
+	{
+	double s, e = kernel_scaled_distance(x,y,n,s), ee = 0;
+	for (int i=0;i<n;++i) ee+=(x[i]-s*y[i])*(x[i]-s*y[i]);
+	CHECK(fabs(s-dot/yy)<=4*(n+1)*DBL_EPSILON*(fabs(dot/yy)+1));
+	CHECK(fabs(e-ee)<=4*(n+1)*DBL_EPSILON*(xx+s*s*yy));
+	}
+      }
+
+    // blocks: all combinations of 4x4 blocks and remainders, and more
+    // than one tile of 64 reference vectors
+    const int sizes[] = { 1,3,4,5,8,9,70 };
+    const int ns = sizeof(sizes)/sizeof(sizes[0]);
+    for (int n=1;n<=L;n+=(n<9) ? 1 : 7)
+      for (int a=0;a<ns;++a)
+	for (int b=0;b<ns;++b)
+	  {
+	  const int m=sizes[a],l=sizes[b];
+	  vector<double> X(m*n+1),Y(l*n+1),xn(m),yn(l),D(m*l);
+	  for (int i=0;i<m*n;++i) X[i+1]=sample(integer);
+	  for (int i=0;i<l*n;++i) Y[i+1]=sample(integer);
+	  for (int i=0;i<m;++i) xn[i]=kernel_dot_product(&X[1+i*n],&X[1+i*n],n);
+	  for (int j=0;j<l;++j) yn[j]=kernel_dot_product(&Y[1+j*n],&Y[1+j*n],n);
+	  kernel_square_distance_block(&X[1],&xn[0],m,&Y[1],&yn[0],l,n,&D[0]);
+	  int wrong = 0;
+	  for (int i=0;i<m;++i)
+	    for (int j=0;j<l;++j)
+	      {
+	      double dd=0;
+	      for (int k=0;k<n;++k) dd+=(X[1+i*n+k]-Y[1+j*n+k])*(X[1+i*n+k]-Y[1+j*n+k]);
+	      double tol = integer ? 0 : 2*(n+2)*DBL_EPSILON*(xn[i]+yn[j]);
+	      if (fabs(D[i*l+j]-dd)>tol) ++wrong;
+	      }
+	  CHECK(wrong==0);
+	  }
+    }
+}
+
+/// counts the calls of step()
+class StepCounter
+  : public Algorithm
+{
+public:
+  StepCounter() : m_calls(0) {}
+  virtual term_type step() { ++m_calls; return UNKNOWN; }
+  int m_calls;
+};
+
+/** The distance algorithms on vectors with hand computed results
+    (dimension 5, i.e. with a remainder for every kernel set). The
+    successor must be called once per step(). */
+
+static void
+check_distances()
+{
+  real_type dist(NULL,cVOID,"dist"),output(NULL,cVOID,"output"),scale(NULL,cVOID,"scale");
+  tuple_type x(NULL,cVOID,"x"),y(NULL,cVOID,"y");
+  matrix_type A(NULL,cVOID,"A");
+  const double xv[] = { 1,2,3,4,5 }, yv[] = { 2,0,1,0,-1 };
+  x.var().alloc(5); y.var().alloc(5);
+  for (int i=0;i<5;++i) { x.var()[i]=xv[i]; y.var()[i]=yv[i]; }
+  // x.y = 2+3-5 = 0, |y|^2 = 6, |x|^2 = 55, |x-y|^2 = 1+4+4+16+36 = 61
+
+  // scalar product: (output - x.y)^2, accumulated with inc
+  StepCounter count;
+  Algorithm *p = dotdist(&dist,&x,&y,&output,false,&count);
+  output.var() = 7; p->step();
+  CHECK(dist()==49);
+  y.var()[4] = 1; p->step(); // x.y = 10
+  CHECK(dist()==9);
+  delete p;
+  p = dotdist(&dist,&x,&y,&output,true,&count);
+  p->step(); p->step();
+  CHECK(dist()==27);
+  delete p;
+  // relaxed dimensions: x = (1 2 3) against the first rows of y, x.y = 5
+  x.var().alloc(3); for (int i=0;i<3;++i) x.var()[i]=xv[i];
+  p = dotdist(&dist,&x,&y,&output);
+  p->step();
+  CHECK(dist()==4);
+  delete p;
+  CHECK(count.m_calls==4);
+  x.var().alloc(5); for (int i=0;i<5;++i) x.var()[i]=xv[i];
+  y.var()[4] = -1;
+
+  // scaled distance: orthogonal vectors (s=0), then y parallel to x
+  p = seuclidsqdist(&dist,&x,&y,&scale,&count);
+  p->step();
+  CHECK(scale()==0 && dist()==55);
+  for (int i=0;i<5;++i) y.var()[i]=-2*xv[i];
+  y.var()[1] += 1; // y = (-2 -3 -6 -8 -10), x.y = -108, |y|^2 = 213
+  p->step();
+  double s = -108.0/213, e = 0;
+  for (int i=0;i<5;++i) e += (x()[i]-s*y()[i])*(x()[i]-s*y()[i]);
+  CHECK(fabs(scale()-s)<1E-14 && fabs(dist()-e)<1E-12);
+  delete p;
+  CHECK(count.m_calls==6);
+  for (int i=0;i<5;++i) y.var()[i]=yv[i];
+
+  // Mahalanobis distance: no matrix (Euclidean), diagonal, full
+  p = matdist(&dist,&x,&y,&A,&count);
+  p->step();
+  CHECK(dist()==61);
+  A.var().alloc(5,5);
+  for (int i=0;i<5;++i) for (int j=0;j<5;++j) A.var()(i,j) = (i==j) ? i+1 : 0;
+  p->step(); // diff = (-1 2 2 4 6)
+  CHECK(dist()==1+8+12+64+180);
+  A.var()(0,1) = A.var()(1,0) = 1;
+  p->step(); // + 2*(-1)*2
+  CHECK(dist()==265-4);
+  delete p;
+  CHECK(count.m_calls==9);
+}
+
+/// number of vectors in check_slab()
+#define SLAB_VECTORS 100000
+
+/// resident memory in KB (0 if unknown)
+static long
+resident_kb()
+{
+  ifstream is("/proc/self/statm");
+  long size=0,resident=0;
+  if (!(is >> size >> resident)) return 0;
+  return resident*(sysconf(_SC_PAGESIZE)/1024);
+}
+
+/// allocate and free SLAB_VECTORS vectors of 20 doubles
+static void*
+slab_worker(void*)
+{
+  DynTuple<double> *p = new DynTuple<double>[SLAB_VECTORS];
+  for (int i=0;i<SLAB_VECTORS;++i) { p[i].alloc(20); p[i][19] = i; }
+  delete[] p;
+  return NULL;
+}
+
+/** Size classes are multiples of 16 bytes up to 256 bytes, powers of
+    two above. 100000 vectors of 20 doubles (160 bytes each, 16 MB)
+    must give their blocks back after slab_trim(), and so must a
+    thread that frees its vectors and exits (its free lists are handed
+    over at exit). */
+
+static void
+check_slab()
+{
+  const size_t sizes[][2] = { {1,16}, {100,112}, {160,160}, {256,256}, {257,512}, {5000,8192} };
+  for (size_t i=0;i<sizeof(sizes)/sizeof(sizes[0]);++i)
+    {
+    size_t bytes = sizes[i][0];
+    void *p = slab_alloc(bytes);
+    CHECK(bytes==sizes[i][1]);
+    slab_free(p,bytes);
+    }
+  slab_trim();
+  const long before = slab_bytes();
+
+  DynTuple<double> *p = new DynTuple<double>[SLAB_VECTORS];
+  for (int i=0;i<SLAB_VECTORS;++i) { p[i].alloc(20); p[i][19] = i; }
+  const long used = slab_bytes(), rss_used = resident_kb();
+  CHECK(used-before>=SLAB_VECTORS*160L);
+  delete[] p;
+  slab_trim();
+  const long freed = slab_bytes(), rss_freed = resident_kb();
+  CHECK(freed<=before+256*1024);
+  cout << "slabs " << used/1024 << " KB -> " << freed/1024 << " KB, resident "
+       << rss_used << " KB -> " << rss_freed << " KB" << endl;
+  if (rss_used>0) CHECK(rss_used-rss_freed>=8*1024);
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_t thread;
+  CHECK(pthread_create(&thread,NULL,&slab_worker,NULL)==0);
+  pthread_join(thread,NULL);
+  slab_trim();
+  CHECK(slab_bytes()<=freed+256*1024);
+  cout << "after thread exit " << slab_bytes()/1024 << " KB" << endl;
+#endif
+}
+
+int
+main
+  (
+  int argc,
+  char** argv
+  )
+  {
+  LOGTRACE_INIT("dal.log","dal.id");                    // initialize debugging
+  init_global();                                 // initialize global variables
+
+  if (argc<2) { cerr << "usage: selftest <check> [<commands>]" << endl; return 2; }
+  const string check(argv[1]);
+
+  if (check=="swap") check_swap();
+  else if (check=="slots") check_slots();
+  else if (check=="spill") check_spill(argc-1,argv+1);
+  else if (check=="cow") check_cow(argc-1,argv+1);
+  else if ((check=="pipelines")&&(argc>2)) check_pipelines(argv[2]);
+  else if (check=="kernels") check_kernels();
+  else if (check=="distances") check_distances();
+  else if (check=="slab") check_slab();
+  else { cerr << "selftest: unknown check " << check << endl; return 2; }
+
+  if (g_failed>0) cerr << "selftest " << check << ": " << g_failed << " failed" << endl;
+  return (g_failed==0) ? 0 : 1;
+  }
+
+#endif // EXCLUDE_FROM_TUTORIAL
@@ -24,6 +24,8 @@
 #define TABLE_SOURCE
 
 #include <fstream>
+#include <stdlib.h> // getenv, mkstemp
+#include <unistd.h> // unlink, ftruncate
 #include "dal.hpp"
 #include "table.hpp"
 #include "access.hpp"
@@ -146,8 +148,10 @@ record_type::load(ix_type a_ix)
 }
 
 /** Copy a record. The \a a_ix index is the index in the record_type
-    repository that shall be copied. New entries in the repositories
-    are allocated for all non-default fields. */
+    repository that shall be copied. A new record entry is allocated,
+    but the non-default fields only share their repository entries
+    with the original record (see data_type<T>::share()); a field is
+    copied when it is written via var(). */
 
 void
 record_type::copy(ix_type a_ix)
@@ -170,7 +174,7 @@ record_type::copy(ix_type a_ix)
 	// refers to the final output only]
 	if ((*f)->get_default_ix() != m_repository[a_ix][i])  
 	{
-	    (*f)->copy( m_repository[a_ix][i] ); 
+	    (*f)->share( m_repository[a_ix][i] ); 
 	    var()[i] = (*f)->get_ix();
 	    (*f)->info(*gp_trace);
 	}
@@ -187,7 +191,9 @@ record_type::copy(ix_type a_ix)
     fields may have default values. In the meantime, they may have
     different values and thus there are new repository-indices
     associated with these fields. Thus, to keep the reference up to
-    date, we have to reload the vector from the field indices. */
+    date, we have to reload the vector from the field indices. Fields
+    bound to a column of a ColumnTable are copied into their
+    repository first (see data_type<T>::detach()). */
 
 void
 record_type::store()
@@ -198,6 +204,7 @@ record_type::store()
     var().alloc(m_size);
     for (f=m_fields.begin(),i=0;f!=m_fields.end();++f,++i)
     {
+	(*f)->detach(); // Werte aus Spalten haben keinen Repository-Index
 	var()[i] = (*f)->get_ix(); 
 	(*f)->info(*gp_trace);
     }
@@ -290,12 +297,15 @@ BaseTable::BaseTable(
     // globales Feld, Anmeldung im record_type
     attach(mp_input_key);
     attach(mp_output_key);
+
+    Metrics::enlist(&m_metrics,Metrics::TABLE,name,string());
 }
 
 /** Destruktor. */
 
 BaseTable::~BaseTable()
 {
+    Metrics::remove(&m_metrics);
     delete mp_record;
     //delete mp_record->mp_context; <- wird vom array_type<> Destruktor gemacht
     if (mp_input_key!=NULL) { delete mp_input_key; mp_input_key=NULL; }
@@ -332,6 +342,13 @@ inline Context*
 BaseTable::context() 
   { return mp_record->context(); }
 
+/** Repositories der Tabelle (die Felder der Tabelle legen ihre Werte
+    dort ab, siehe RepositoryContext). */
+
+RepositoryContext* 
+BaseTable::repositories() const
+  { return mp_record->repositories(); }
+
 /** Feld-Anmeldung. Ein Feld wird beim record_type angemeldet, die
     Anmeldung bzw. Verteilung auf die Reader/Writer erfolgt erst bei
     ::init. */
@@ -385,6 +402,54 @@ BaseTable::free
   mp_record->free();
   }
 
+/** Anzahl der Records der Tabelle, sofern sie ohne Auslesen bekannt
+    ist (aus dem Index der Eingabedatei, siehe Tabellen-Modifier \c
+    :x), sonst -1. */
+
+long
+BaseTable::record_count
+  (
+  )
+  {
+  return -1;
+  }
+
+/** Festhalten des aktuellen Records im Repository, z.B. um mehrere
+    Records zu lesen und spaeter in derselben Reihenfolge
+    zurueckzuschreiben. Die Felder werden nicht kopiert, sondern nur
+    geteilt (wie in BufferedTable<T>::push()). Der zurueckgegebene
+    Index muss genau einmal an restore() uebergeben werden. */
+
+ix_type
+BaseTable::hold
+  (
+  )
+  {
+  LOG_METHOD("Table","BaseTable","hold",'<'<<context()->name()<<'>')
+
+  mp_record->store();
+  ix_type ix = mp_record->get_ix();
+  mp_record->copy(ix);
+  return ix;
+  }
+
+/** Laden eines mit hold() festgehaltenen Records \a a_ix als
+    aktuellen Record. Der festgehaltene Eintrag wird dabei
+    freigegeben. */
+
+void
+BaseTable::restore
+  (
+  ix_type a_ix
+  )
+  {
+  LOG_METHOD("Table","BaseTable","restore",'<'<<context()->name()<<'>'<<a_ix)
+
+  mp_record->free();
+  mp_record->copy(a_ix);
+  mp_record->free(a_ix);
+  }
+
 /** Charakterisierung der Tabellen
 
     MasterTable: (im Sinne von: "keine Detailtabelle")
@@ -534,7 +599,11 @@ SimpleTable::push()
     if (!context()->is_writeback()) return;
     
     // Schreiben
+    double t = Metrics::clock();
     mp_writer->operate();
+    Metrics::lap(m_metrics.m_parse,t);
+    ++m_metrics.m_pushes;
+    Metrics::poll(m_metrics);
     
     // Alten Werte sind nun ungueltig und werden freigegeben.
 // warum? free() in pop()!!    free();
@@ -562,6 +631,8 @@ SimpleTable::pop()
     // Reader aufrufen
     if (!mp_reader->operate()) SET_TAG(context()->mode(),Context::ENDOFDATA);
     
+    ++m_metrics.m_records;
+    Metrics::poll(m_metrics);
     return true;
 }
 
@@ -592,6 +663,15 @@ SimpleTable::close
   if (mp_writer!=NULL) { delete mp_writer; mp_writer=NULL; }
   }
 
+long
+SimpleTable::record_count
+  (
+  )
+  {
+  if (!context()->is_initialized()) init();
+  return (mp_reader==NULL) ? -1 : mp_reader->index_size();
+  }
+
 void 
 SimpleTable::setrpos(const marker_type& m) 
 {
@@ -663,6 +743,8 @@ SyncTable::init_reader()
 			// neuen Datei- & Collectionnamen setzen
 			Context *p = new Context(*(*f)->context());
 			p->intag() = p->outtag() = (*f)->context()->coll();
+			if (context()->is_indexed()) SET_TAG(p->mode(),cINDEXED);
+			if (context()->is_lazy()) SET_TAG(p->mode(),cLAZY);
 			r = mp_reader->insert(mp_reader->end(),get_sub_reader(p));
 		    }
 		}
@@ -780,9 +862,13 @@ SyncTable::push()
     if (!context()->is_writeback()) return;
     
     // Ausgabe
+    double t = Metrics::clock();
     list<Writer*>::iterator w;
     for (w=mp_writer->begin();w!=mp_writer->end();++w) 
     { (*w)->operate(); }
+    Metrics::lap(m_metrics.m_parse,t);
+    ++m_metrics.m_pushes;
+    Metrics::poll(m_metrics);
     
     // Alten Werte sind nun ungueltig und werden freigegeben.
 //    free();
@@ -809,9 +895,27 @@ SyncTable::pop()
 	if (!ok) SET_TAG(context()->mode(),Context::ENDOFDATA);
     }
     
+    ++m_metrics.m_records;
+    Metrics::poll(m_metrics);
     return true;
 }
 
+/** Der Mainreader bestimmt die Anzahl der Records (siehe pop()).
+    Der Index zaehlt alle Records der Eingabedatei, das ist nur dann
+    die Anzahl der Tabelle, wenn sie ab dem ersten Record liest (siehe
+    mark()) und keine Detailtabelle ist; sonst -1. */
+
+long
+SyncTable::record_count()
+{
+    if (!context()->is_initialized()) init();
+    if ((!context()->is_readout())||(context()->is_detail())) return -1;
+    if (mp_reader->empty()) return -1;
+    
+    Reader *p = mp_reader->front();
+    return (m_rstart[0].m_spos==p->index_start()) ? p->index_size() : -1;
+}
+
 /** Liefert true wenn Tabellenende erreicht. Im Fall einer
     Detailtabelle bezieht sich das Tabellenende darauf, dass es keinen
     weiteren Eintrag zum aktuellen Masterschluessel gibt. */
@@ -838,6 +942,7 @@ SyncTable::close()
     for (list<Writer*>::iterator w=mp_writer->begin();w!=mp_writer->end();++w)
     { delete (*w); }
     mp_writer->clear();
+    slab_trim();
 }
 
 
@@ -1086,6 +1191,17 @@ HMasterTable::pop()
     return ok;
 }
 
+/** Bei hierarchischen Daten werden Tabellen meist nur ueber einen
+    Teilbaum iteriert, die Anzahl aus dem Index gilt dann nicht. */
+
+long
+HMasterTable::record_count()
+{
+    if (!context()->is_initialized()) init();
+    
+    return (m_rhier) ? -1 : SyncTable::record_count();
+}
+
 /** Schreiben von Records. Zur Vereinfachung der Erstellung von
     Hierarchien (und wegen Abwaertskompatibilitaet mit frueheren
     Versionen) wird inc_level() und dec_level() bereitgestellt, womit
@@ -1200,6 +1316,151 @@ void SubSetTable::rewind()
     HMasterTable::rewind();
 }
 
+/** Mit Auswahl eines Teilbaums (m_hmask) ist die Anzahl nicht
+    bekannt. */
+
+long SubSetTable::record_count()
+{
+    for (int i=0;i<m_hmask.rows();++i)
+	if (m_hmask(i)!=g_illegal_ix) return -1;
+    return HMasterTable::record_count();
+}
+
+///////////////////////////////////////////////////////////////////
+
+/** \class SpillFile
+    \brief Temporary record file of a BufferedTable.
+
+    Each record is stored with its length in front. The stdio buffer is
+    large, so that writing and reading back proceed at sequential disk
+    speed. */
+
+static const size_t g_spill_buffer = 1L<<20;
+
+SpillFile::SpillFile()
+    : mp_file(NULL)
+    , mp_buffer(NULL)
+    , m_records(0)
+    , m_reading(false)
+{
+}
+
+SpillFile::~SpillFile()
+{
+    if (mp_file!=NULL) fclose(mp_file);
+    delete[] mp_buffer;
+}
+
+/** Create the (already unlinked) temporary file. */
+
+void
+SpillFile::open()
+{
+    const char *p_dir = getenv("TMPDIR");
+    string name = (p_dir!=NULL) ? p_dir : "/tmp";
+    name += "/dalspillXXXXXX";
+    char *p_name = new char[name.length()+1];
+    strcpy(p_name,name.c_str());
+    int fd = mkstemp(p_name);
+    if (fd>=0) 
+    {
+	unlink(p_name);
+	mp_file = fdopen(fd,"w+b");
+    }
+    if (mp_file==NULL)
+    {
+	ERROR("cannot create temporary file '"<<p_name<<"'");
+	exit(-1);
+    }
+    delete[] p_name;
+    mp_buffer = new char[g_spill_buffer];
+    setvbuf(mp_file,mp_buffer,_IOFBF,g_spill_buffer);
+}
+
+/** Append record \a a_record at the end of the file. */
+
+void
+SpillFile::append(
+    const string& a_record
+    )
+{
+    if (mp_file==NULL) open();
+    if (m_reading) { fseek(mp_file,0,SEEK_END); m_reading=false; }
+    int n = a_record.length();
+    if ((fwrite(&n,sizeof(n),1,mp_file)!=1)||
+	(fwrite(a_record.data(),1,n,mp_file)!=(size_t)n))
+    {
+	ERROR("cannot write temporary file (disk full?)");
+	exit(-1);
+    }
+    ++m_records;
+}
+
+/** Read the next record into \a a_record, false at the end of the
+    file. */
+
+bool
+SpillFile::read(
+    string& a_record
+    )
+{
+    if (mp_file==NULL) return false;
+    if (!m_reading) rewind();
+    int n;
+    if (fread(&n,sizeof(n),1,mp_file)!=1) return false;
+    a_record.resize(n);
+    if ((n>0)&&(fread(&a_record[0],1,n,mp_file)!=(size_t)n))
+    {
+	ERROR("cannot read temporary file");
+	exit(-1);
+    }
+    return true;
+}
+
+/** Restart reading with the first record. */
+
+void
+SpillFile::rewind()
+{
+    if (mp_file==NULL) return;
+    fseek(mp_file,0,SEEK_SET);
+    m_reading = true;
+}
+
+/** Remove all records. */
+
+void
+SpillFile::clear()
+{
+    if (mp_file==NULL) return;
+    fflush(mp_file);
+    if (ftruncate(fileno(mp_file),0)!=0)
+    { WARNING("cannot truncate temporary file"); }
+    fseek(mp_file,0,SEEK_SET);
+    m_reading = false;
+    m_records = 0;
+}
+
+/** Memory budget for each BufferedTable in bytes (0: unlimited), from
+    the environment variable DAL_BUFFER_BYTES (bytes) or, if that is
+    not set, DAL_BUFFER_MB (megabytes). A small DAL_BUFFER_BYTES
+    forces small tables to spill (used by the tests). */
+
+static long
+buffer_budget()
+{
+    const char *p_bytes = getenv("DAL_BUFFER_BYTES");
+    if (p_bytes!=NULL) 
+    {
+	long bytes = atol(p_bytes);
+	return (bytes>0) ? bytes : 0;
+    }
+    const char *p_mb = getenv("DAL_BUFFER_MB");
+    if (p_mb==NULL) return 0;
+    long mb = atol(p_mb);
+    return (mb>0) ? (mb<<20) : 0;
+}
+
 ///////////////////////////////////////////////////////////////////
 
 /** \class BufferedTable
@@ -1213,7 +1474,15 @@ void SubSetTable::rewind()
     The push() method writes the records into memory rather than into
     the output file. The final result can be written into a file by
     means of submit() . Calling swap() makes the output generated so
-    far being the input for the next read loop. */
+    far being the input for the next read loop. 
+
+    If a memory budget is given (DAL_BUFFER_MB or DAL_BUFFER_BYTES),
+    the records read or pushed once the budget is exhausted are
+    written to a SpillFile (input or output) and are read back from
+    there sequentially after the records kept in memory. Input and
+    output have a budget each: a full input (read by init_reader() or
+    taken over by swap()) does not force every push() of the next
+    pass into the SpillFile. */
 
 template <class T>
 BufferedTable<T>::BufferedTable(
@@ -1226,6 +1495,12 @@ BufferedTable<T>::BufferedTable(
     , mp_output(new list<ix_type>)
     , m_inpos(mp_input->end())
     , mp_temp_writer(new list<Writer*>)
+    , m_budget(buffer_budget())
+    , m_inbytes(0)
+    , m_outbytes(0)
+    , mp_inspill(new SpillFile)
+    , mp_outspill(new SpillFile)
+    , m_spillpos(0)
 {
 }
 
@@ -1239,6 +1514,46 @@ BufferedTable<T>::~BufferedTable()
 
     delete mp_input; mp_input=NULL;
     delete mp_output; mp_output=NULL;
+    delete mp_inspill; mp_inspill=NULL;
+    delete mp_outspill; mp_outspill=NULL;
+}
+
+/** Current record in binary form into m_record (a flag byte per
+    field, followed by the value if it is not the default). The
+    return value estimates the memory the record occupies if it is
+    kept in the repositories. */
+
+template <class T>
+long
+BufferedTable<T>::encode()
+{
+    m_record.erase();
+    for (adtp_list::const_iterator f=mp_record->m_fields.begin();f!=mp_record->m_fields.end();++f)
+    {
+	if ((*f)->is_default()) { m_record+='\0'; continue; }
+	m_record+='\1';
+	(*f)->write_binary(m_record);
+    }
+    // Verwaltung im Repository: Index und Eintrag je Feld, Record selbst
+    return m_record.length()+mp_record->m_size*(sizeof(ix_type)+16)+32;
+}
+
+/** Load the next record of \a a_spill into the fields (which must
+    have default values), false at the end of the file. */
+
+template <class T>
+bool
+BufferedTable<T>::decode(SpillFile& a_spill)
+{
+    if (!a_spill.read(m_record)) return false;
+    const char *p = m_record.data();
+    for (adtp_list::const_iterator f=mp_record->m_fields.begin();f!=mp_record->m_fields.end();++f)
+    {
+	if (*p++=='\0') continue;
+	p = (*f)->read_binary(p);
+    }
+    INVARIANT(p==m_record.data()+m_record.length(),"record size");
+    return true;
 }
 
 /** We do not only initialize the reader but read out the whole table
@@ -1251,16 +1566,30 @@ BufferedTable<T>::init_reader()
 {
     LOG_METHOD("Table","BufferedTable","init_reader",context()->name());
 
-    // Alle Daten auslesen
+    // Alle Daten auslesen (der Reader darf dazu parallel zerlegen)
+    SET_TAG(context()->mode(),cBULKREAD);
     T::init_reader();
+    CLEAR_TAG(context()->mode(),cBULKREAD);
     while (!T::done())
     {
 	mp_record->load_default();
 	T::pop();
+	if (over_budget(m_inbytes))
+	{ // in die temporaere Datei, Felder wieder freigeben
+	    encode();
+	    mp_inspill->append(m_record);
+	    mp_record->free();
+	    continue;
+	}
+	if (m_budget>0) m_inbytes += encode();
 	mp_record->store(); // eingelesene Daten konservieren
 	mp_input->push_back(mp_record->get_ix());
     }
     m_inpos = mp_input->end();
+    m_spillpos = mp_inspill->records();
+    if (mp_inspill->records()>0)
+	INFO(context()->name()<<": "<<mp_inspill->records()
+	     <<" records beyond memory budget in temporary file");
     CLEAR_TAG(context()->mode(),Context::ENDOFDATA);
     TRACE_VAR(*mp_input);
 
@@ -1313,7 +1642,8 @@ template <class T>
 bool
 BufferedTable<T>::done()
 {
-    return (T::done())&&(m_inpos==mp_input->end());
+    return (T::done())&&(m_inpos==mp_input->end())
+	&&(m_spillpos==mp_inspill->records());
 }
 
 /** Turn output into input of next loop. */
@@ -1332,8 +1662,12 @@ BufferedTable<T>::swap()
 	    mp_record->free(*i);
 	mp_input->clear();
     }
+    mp_inspill->clear();
     list<ix_type> *h=mp_output; mp_output=mp_input; mp_input=h; // swap
+    SpillFile *s=mp_outspill; mp_outspill=mp_inspill; mp_inspill=s;
+    m_inbytes = m_outbytes; m_outbytes = 0;
     m_inpos = mp_input->begin();
+    mp_inspill->rewind(); m_spillpos = 0;
 }
 
 /** Restart input. */
@@ -1354,6 +1688,7 @@ BufferedTable<T>::rewind()
 
     TRACE_VAR(mp_input->size());
     m_inpos = mp_input->begin();
+    mp_inspill->rewind(); m_spillpos = 0;
     CLEAR_TAG(context()->mode(),Context::ENDOFDATA);
 }
 
@@ -1371,6 +1706,10 @@ void BufferedTable<T>::clear()
     for (list<ix_type>::iterator i=mp_output->begin();i!=mp_output->end();++i)
 	mp_record->free(*i);
     mp_output->clear();
+
+    mp_inspill->clear(); mp_outspill->clear();
+    m_inbytes = m_outbytes = 0;
+    m_spillpos = 0;
 }
 
 /** Read next record. In the first run the data is read from the file
@@ -1389,12 +1728,19 @@ BufferedTable<T>::pop()
     // mehr!)
     mp_record->free(); // load_default();
 
-    if (m_inpos==mp_input->end()) return false;
-
-    mp_record->copy(*m_inpos); // aus Hauptspeicher auslesen
+    if (m_inpos!=mp_input->end())
+    {
+	mp_record->copy(*m_inpos); // aus Hauptspeicher auslesen
+	++m_inpos;
+    }
+    else if (m_spillpos<mp_inspill->records())
+    {
+	decode(*mp_inspill); // aus temporaerer Datei auslesen
+	++m_spillpos;
+    }
+    else return false;
     T::pop(); // nicht wirklich lesen (NULL_Reader), aber Hierarchie nachziehen
-    ++m_inpos;
-    if (m_inpos==mp_input->end()) 
+    if ((m_inpos==mp_input->end())&&(m_spillpos==mp_inspill->records())) 
 	SET_TAG(context()->mode(),Context::ENDOFDATA);
 
     TRACE_VAR(mp_input->size());
@@ -1413,13 +1759,22 @@ BufferedTable<T>::push()
 
     T::push();
 
+    if (over_budget(m_outbytes))
+    { // in die temporaere Datei (Felder behalten ihre Werte)
+	encode();
+	mp_outspill->append(m_record);
+	return;
+    }
+    if (m_budget>0) m_outbytes += encode();
+
     // mglw. geaenderte Felderindizes aktualisieren
     mp_record->store();
     // record speichern
     mp_output->push_back(mp_record->get_ix());
     // fuer eventuelle weitere push()s den alten Inhalt kopieren (und
     // damit Operationen auf dem gepush()ten Record vermeiden
-    // (alternativ: load_default)
+    // (alternativ: load_default). Die Felder werden nur geteilt und
+    // erst bei Schreibzugriff kopiert.
     mp_record->copy(mp_record->get_ix());
 
     TRACE_VAR(mp_input->size());
@@ -1444,6 +1799,19 @@ BufferedTable<T>::submit()
 	for (w=mp_writer->begin();w!=mp_writer->end();++w) 
 	{ (*w)->operate(); }
     }
+    // die Felder halten keine Referenz auf die Ausgabe-Records, sie
+    // duerfen diese also auch nicht spaeter per free() freigeben
+    mp_record->load_default();
+
+    // Records aus der temporaeren Datei
+    mp_outspill->rewind();
+    while (decode(*mp_outspill))
+    {
+	list<Writer*>::iterator w;
+	for (w=mp_writer->begin();w!=mp_writer->end();++w) 
+	{ (*w)->operate(); }
+	mp_record->free();
+    }
 
     h = mp_writer; mp_writer=mp_temp_writer; mp_temp_writer=h;
 }
@@ -1458,6 +1826,7 @@ BufferedTable<T>::close()
     for (list<Writer*>::iterator w=mp_temp_writer->begin();w!=mp_temp_writer->end();++w)
     { delete (*w); }
     mp_temp_writer->clear();
+    slab_trim(); // freie Slab-Bloecke der Records zurueckgeben
 }
 
 template BufferedTable<MasterTable>;
@@ -1465,6 +1834,278 @@ template BufferedTable<HMasterTable>;
 
 //////////////////////////////////////////////////////////////
 
+/** \class ColumnTable
+    \brief Table I/O is done in memory, stored column by column.
+
+    Same interface and usage as BufferedTable, but the records are not
+    kept as record_type entries in the repositories. Instead, each
+    attached field has one column (column_type<T>) holding its values
+    for all records. pop() does not copy a record but binds the fields
+    to the next row; only a field that is modified via var() is copied
+    into its repository (so the input is never changed). push()
+    appends the current field values to the output columns.
+
+    Algorithms may access a whole input column directly by means of
+    values(); its data() is contiguous, also for tuple fields. A bound
+    field that is kept beyond the current row (hold(), push() into a
+    BufferedTable) is copied into its repository first (see
+    data_type<T>::detach()). */
+
+template <class T>
+ColumnTable<T>::ColumnTable(
+    int mode,
+    const string& name,
+    Domain *d
+    )
+    : T(mode,name,d)
+    , m_rows(0)
+    , m_outrows(0)
+    , m_row(0)
+    , mp_temp_writer(new list<Writer*>)
+{
+}
+
+template <class T>
+ColumnTable<T>::~ColumnTable()
+{
+    // kein submit(), siehe ~BufferedTable()
+    for (size_t i=0;i<m_input.size();++i) delete m_input[i];
+    for (size_t i=0;i<m_output.size();++i) delete m_output[i];
+    delete mp_temp_writer; mp_temp_writer=NULL;
+}
+
+/** Creates the columns of fields attached since the last call. New
+    columns are filled up with default values. */
+
+template <class T>
+void
+ColumnTable<T>::make_columns()
+{
+    adtp_list::const_iterator f = mp_record->m_fields.begin();
+    for (size_t i=0;f!=mp_record->m_fields.end();++f,++i)
+    {
+	if (i<m_input.size()) continue;
+	m_input.push_back((*f)->new_column()); m_input.back()->resize(m_rows);
+	m_output.push_back((*f)->new_column()); m_output.back()->resize(m_outrows);
+    }
+}
+
+/** Releases all fields bound to a row (they get their default value),
+    before the columns are changed. */
+
+template <class T>
+void
+ColumnTable<T>::unbind()
+{
+    mp_record->free();
+}
+
+/** As in BufferedTable, the whole table is read at once, but the
+    values are appended to the columns and the repository entries are
+    released after each record. */
+
+template <class T>
+void
+ColumnTable<T>::init_reader()
+{
+    LOG_METHOD("Table","ColumnTable","init_reader",context()->name());
+
+    SET_TAG(context()->mode(),cBULKREAD);
+    T::init_reader();
+    CLEAR_TAG(context()->mode(),cBULKREAD);
+    make_columns();
+    while (!T::done())
+    {
+	T::pop();
+	adtp_list::const_iterator f = mp_record->m_fields.begin();
+	for (size_t i=0;f!=mp_record->m_fields.end();++f,++i)
+	{ m_input[i]->append(**f); }
+	++m_rows;
+	mp_record->free(); // Werte stehen nun in den Spalten
+    }
+    m_row = m_rows;
+    CLEAR_TAG(context()->mode(),Context::ENDOFDATA);
+    TRACE_VAR(m_rows);
+
+    // Reader wieder loeschen
+    for (list<Reader*>::iterator r=mp_reader->begin();r!=mp_reader->end();++r)
+    { delete (*r); }
+    mp_reader->clear();
+  
+    // NULL_Reader einsetzen
+    context()->infile() = "null";
+    mp_reader->push_back( get_main_reader() );
+    (*mp_reader->begin())->init();
+}
+
+/** Only a NULL_Writer is instantiated, see BufferedTable. */
+
+template <class T>
+void
+ColumnTable<T>::init_writer()
+{
+    T::init_writer();
+    list<Writer*> *h = mp_writer; mp_writer=mp_temp_writer; mp_temp_writer=h;
+
+    context()->outfile() = "null";
+    mp_writer->push_back( get_main_writer() );
+    (*mp_writer->begin())->init();
+    make_columns();
+}
+
+/** Nothing to release: bound fields are released by pop(). */
+
+template <class T>
+void
+ColumnTable<T>::free()
+{
+    LOG_METHOD("Table","ColumnTable<T>","free",'<'<<context()->name()<<'>');
+}
+
+template <class T>
+bool
+ColumnTable<T>::done()
+{
+    return (T::done())&&(m_row==m_rows);
+}
+
+/** Turn output into input of next loop. */
+
+template <class T>
+void
+ColumnTable<T>::swap()
+{
+    LOG_METHOD("Table","ColumnTable","swap",context()->name());
+    TRACE_VAR(m_rows);
+    TRACE_VAR(m_outrows);
+
+    unbind();
+    for (size_t i=0;i<m_input.size();++i) m_input[i]->clear();
+    m_input.swap(m_output);
+    m_rows = m_outrows; m_outrows = 0;
+    m_row = 0;
+}
+
+/** Restart input. */
+
+template <class T>
+void
+ColumnTable<T>::rewind()
+{
+    LOG_METHOD("DAL","ColumnTable<T>","rewind",context()->name());
+
+    if (!context()->is_initialized()) init();
+    unbind();
+    m_row = 0;
+    CLEAR_TAG(context()->mode(),Context::ENDOFDATA);
+}
+
+/** Restart (thereby deleting input and output). */
+
+template <class T>
+void 
+ColumnTable<T>::clear()
+{
+    LOG_METHOD("DAL","ColumnTable<T>","clear",context()->name());
+
+    unbind();
+    for (size_t i=0;i<m_input.size();++i) m_input[i]->clear();
+    for (size_t i=0;i<m_output.size();++i) m_output[i]->clear();
+    m_rows = m_outrows = m_row = 0;
+}
+
+/** Read next record: all fields are bound to the next row. */
+
+template <class T>
+bool
+ColumnTable<T>::pop()
+{
+    LOG_METHOD("DAL","ColumnTable<T>","pop",context()->name());
+
+    if (m_row==m_rows) { unbind(); return false; }
+
+    make_columns();
+    adtp_list::const_iterator f = mp_record->m_fields.begin();
+    for (size_t i=0;f!=mp_record->m_fields.end();++f,++i)
+    { m_input[i]->bind(**f,m_row); }
+    T::pop(); // nicht wirklich lesen (NULL_Reader), aber Hierarchie nachziehen
+    ++m_row;
+    if (m_row==m_rows) SET_TAG(context()->mode(),Context::ENDOFDATA);
+
+    return true;
+}
+
+/** Write record into memory (append to output columns). */
+
+template <class T>
+void
+ColumnTable<T>::push()
+{
+    LOG_METHOD("DAL","ColumnTable<T>","push",context()->name());
+
+    T::push();
+
+    make_columns();
+    adtp_list::const_iterator f = mp_record->m_fields.begin();
+    for (size_t i=0;f!=mp_record->m_fields.end();++f,++i)
+    { m_output[i]->append(**f); }
+    ++m_outrows;
+}
+
+/** Finally write buffered output into file. */
+
+template <class T>
+void
+ColumnTable<T>::submit()
+{
+    list<Writer*> *h = mp_writer; mp_writer=mp_temp_writer; mp_temp_writer=h;
+
+    for (long r=0;r<m_outrows;++r)
+    {
+	adtp_list::const_iterator f = mp_record->m_fields.begin();
+	for (size_t i=0;f!=mp_record->m_fields.end();++f,++i)
+	{ m_output[i]->bind(**f,r); }
+	list<Writer*>::iterator w;
+	for (w=mp_writer->begin();w!=mp_writer->end();++w) 
+	{ (*w)->operate(); }
+    }
+    unbind();
+
+    h = mp_writer; mp_writer=mp_temp_writer; mp_temp_writer=h;
+}
+
+template <class T>
+void
+ColumnTable<T>::close()
+{
+    T::close();
+    clear();
+
+    for (list<Writer*>::iterator w=mp_temp_writer->begin();w!=mp_temp_writer->end();++w)
+    { delete (*w); }
+    mp_temp_writer->clear();
+    slab_trim(); // freie Slab-Bloecke der Records zurueckgeben
+}
+
+/** Input column of field \a ap_field (NULL if not attached). */
+
+template <class T>
+const abstract_column*
+ColumnTable<T>::column(const abstract_data_type* ap_field) const
+{
+    if (!context()->is_initialized()) ((ColumnTable<T>*)this)->init();
+
+    adtp_list::const_iterator f = mp_record->m_fields.begin();
+    for (size_t i=0;(f!=mp_record->m_fields.end())&&(i<m_input.size());++f,++i)
+    { if ((*f)==ap_field) return m_input[i]; }
+    return NULL;
+}
+
+template ColumnTable<MasterTable>;
+template ColumnTable<HMasterTable>;
+
+//////////////////////////////////////////////////////////////
+
 BaseTable* get_table(
     const string& name
     )